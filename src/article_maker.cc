@@ -3,6 +3,7 @@
 
 #include "article_maker.hh"
 #include "config.hh"
+#include "dict/btreeidx.hh"
 #include "folding.hh"
 #include "gddebug.hh"
 #include "globalbroadcaster.hh"
@@ -13,8 +14,10 @@
 #include "wstring_qt.hh"
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QTextDocumentFragment>
 #include <QUrl>
+#include <QtConcurrent>
 
 #include "fmt/core.h"
 #include "fmt/compile.h"
@@ -37,11 +40,65 @@ ArticleMaker::ArticleMaker( vector< sptr< Dictionary::Class > > const & dictiona
   groups( groups_ ),
   cfg( cfg_ )
 {
+  auto dropHeaderTemplate = [ this ]() {
+    QMutexLocker _( &headerMutex );
+    headerTemplate.valid = false;
+  };
+
+  connect( &styleWatcher, &QFileSystemWatcher::fileChanged, this, dropHeaderTemplate );
+  connect( &styleWatcher, &QFileSystemWatcher::directoryChanged, this, dropHeaderTemplate );
 }
 
 
 std::string ArticleMaker::makeHtmlHeader( QString const & word, QString const & icon, bool expandOptionalParts ) const
 {
+  QMutexLocker _( &headerMutex );
+
+  if ( !headerTemplate.valid || headerTemplate.displayStyle != cfg.displayStyle
+       || headerTemplate.addonStyle != cfg.addonStyle
+       || headerTemplate.darkReaderMode != GlobalBroadcaster::instance()->getPreference()->darkReaderMode ) {
+    makeHeaderTemplate();
+  }
+
+  string result = headerTemplate.screenCss;
+
+  // Turn on/off expanding of article optional parts
+  if ( expandOptionalParts ) {
+    result += R"(<!-- Expand optional parts css -->
+                   <style type="text/css" media="all">
+                    .dsl_opt{
+                      display: inline;
+                     }
+                    .hidden_expand_opt{  display: none;}
+                    </style>)";
+  }
+
+  result += headerTemplate.printCss;
+
+  result += "<title>" + Html::escape( word.toStdString() ) + "</title>";
+
+  // This doesn't seem to be much of influence right now, but we'll keep
+  // it anyway.
+  if ( icon.size() ) {
+    result +=
+      R"(<link rel="icon" type="image/png" href="qrc:///flags/)" + Html::escape( icon.toUtf8().data() ) + "\" >\n";
+  }
+
+  result += headerTemplate.tail;
+
+  return result;
+}
+
+void ArticleMaker::makeHeaderTemplate() const
+{
+  HeaderTemplate & tmpl = headerTemplate;
+
+  tmpl.displayStyle   = cfg.displayStyle;
+  tmpl.addonStyle     = cfg.addonStyle;
+  tmpl.darkReaderMode = GlobalBroadcaster::instance()->getPreference()->darkReaderMode;
+
+  QString const stylesDir = cfg.addonStyle.isEmpty() ? QString() : Config::getStylesDir();
+
   string result = R"(<!DOCTYPE html>
 <html><head>
 <meta charset="utf-8">
@@ -90,23 +147,15 @@ std::string ArticleMaker::makeHtmlHeader( QString const & word, QString const &
     result += readCssFile( Config::getUserCssFileName(), "all" );
 
     if ( !cfg.addonStyle.isEmpty() ) {
-      QString name = Config::getStylesDir() + cfg.addonStyle + QDir::separator() + "article-style.css";
+      QString name = stylesDir + cfg.addonStyle + QDir::separator() + "article-style.css";
 
       result += readCssFile( name, "all" );
     }
-
-    // Turn on/off expanding of article optional parts
-    if ( expandOptionalParts ) {
-      result += R"(<!-- Expand optional parts css -->
-                   <style type="text/css" media="all">
-                    .dsl_opt{
-                      display: inline;
-                     }
-                    .hidden_expand_opt{  display: none;}
-                    </style>)";
-    }
   }
 
+  tmpl.screenCss = std::move( result );
+  result.clear();
+
   // Add print-only css
   {
     result += R"(<link href="qrc:///article-style-print.css"  media="print" rel="stylesheet" type="text/css">)";
@@ -114,19 +163,13 @@ std::string ArticleMaker::makeHtmlHeader( QString const & word, QString const &
     result += readCssFile( Config::getUserCssPrintFileName(), "print" );
 
     if ( !cfg.addonStyle.isEmpty() ) {
-      QString name = Config::getStylesDir() + cfg.addonStyle + QDir::separator() + "article-style-print.css";
+      QString name = stylesDir + cfg.addonStyle + QDir::separator() + "article-style-print.css";
       result += readCssFile( name, "print" );
     }
   }
 
-  result += "<title>" + Html::escape( word.toStdString() ) + "</title>";
-
-  // This doesn't seem to be much of influence right now, but we'll keep
-  // it anyway.
-  if ( icon.size() ) {
-    result +=
-      R"(<link rel="icon" type="image/png" href="qrc:///flags/)" + Html::escape( icon.toUtf8().data() ) + "\" >\n";
-  }
+  tmpl.printCss = std::move( result );
+  result.clear();
 
   result += QString::fromUtf8( R"(
 <script>
@@ -207,7 +250,30 @@ body { background: #242525; }
 
   result += "</head><body>";
 
-  return result;
+  tmpl.tail  = std::move( result );
+  tmpl.valid = true;
+
+  // Watch the files read above, and the directories they might appear in
+  QStringList paths{ Config::getConfigDir() };
+
+  if ( !cfg.addonStyle.isEmpty() ) {
+    paths.append( stylesDir + cfg.addonStyle );
+  }
+
+  for ( QString const & dir : QStringList( paths ) ) {
+    for ( char const * name : { "article-style.css", "article-style-print.css" } ) {
+      QString const fileName = QDir( dir ).filePath( name );
+      if ( QFileInfo::exists( fileName ) ) {
+        paths.append( fileName );
+      }
+    }
+  }
+
+  QStringList const watched = styleWatcher.files() + styleWatcher.directories();
+  if ( !watched.isEmpty() ) {
+    styleWatcher.removePaths( watched );
+  }
+  styleWatcher.addPaths( paths );
 }
 
 std::string ArticleMaker::readCssFile( QString const & fileName, std::string media ) const
@@ -457,6 +523,10 @@ ArticleRequest::ArticleRequest( QString const & word,
   //clear founded dicts.
   emit GlobalBroadcaster::instance() -> dictionaryClear( ActiveDictIds{ group.id, word } );
 
+  if ( activeDicts.size() <= 1 ) {
+    articleSizeLimit = -1; // Don't collapse article if only one dictionary presented
+  }
+
   // Accumulate main forms
   for ( const auto & activeDict : activeDicts ) {
     auto const s = activeDict->findHeadwordsForSynonym( gd::removeTrailingZero( word ) );
@@ -466,6 +536,11 @@ ArticleRequest::ArticleRequest( QString const & word,
     altSearches.push_back( s );
   }
 
+  // Don't wait for the main forms to start looking up bodies. Once the forms
+  // are known, only the dictionaries they lead to new articles in are asked
+  // again, for the word along with the forms.
+  requestBodies();
+
   altSearchFinished(); // Handle any ones which have already finished
 }
 
@@ -479,8 +554,10 @@ void ArticleRequest::altSearchFinished()
   for ( auto i = altSearches.begin(); i != altSearches.end(); ) {
     if ( ( *i )->isFinished() ) {
       // This one's finished
-      for ( size_t count = ( *i )->matchesCount(), x = 0; x < count; ++x ) {
-        alts.insert( ( **i )[ x ].word );
+      for ( auto const & span : ( *i )->matchesFrom( 0 ) ) {
+        for ( auto const & match : span ) {
+          alts.insert( match.word );
+        }
       }
 
       altSearches.erase( i++ );
@@ -491,38 +568,218 @@ void ArticleRequest::altSearchFinished()
   }
 
   if ( altSearches.empty() ) {
+    altsDone = true; // So any pending signals in queued mode won't mess us up
 
-    // They all've finished! Now we can look up bodies
+    checkAlts();
+  }
 
-    altsDone = true; // So any pending signals in queued mode won't mess us up
+  altCheckFinished(); // Handle any ones which have already finished
+}
+
+void ArticleRequest::requestBodies()
+{
+  wstring wordStd = gd::toWString( word );
+
+  bodyRequests.resize( activeDicts.size() );
+  altChecks.resize( activeDicts.size() );
+  altBodyRequests.resize( activeDicts.size() );
+
+  for ( size_t x = 0; x < activeDicts.size(); ++x ) {
+    sptr< Dictionary::Class > const & activeDict = activeDicts[ x ];
+
+    try {
+      sptr< Dictionary::DataRequest > r = activeDict->getArticle(
+        wordStd,
+        vector< wstring >(),
+        gd::removeTrailingZero( contexts.value( QString::fromStdString( activeDict->getId() ) ) ),
+        ignoreDiacritics );
+
+      connect( r.get(), &Dictionary::Request::finished, this, &ArticleRequest::bodyFinished, Qt::QueuedConnection );
+
+      bodyRequests[ x ] = r;
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "getArticle request error (%s) in \"%s\"\n", e.what(), activeDict->getName().c_str() );
+    }
+  }
+}
+
+namespace {
+
+/// Finds which of the given forms of a word lead to articles the word itself
+/// doesn't lead to, reporting them as its matches. Only the dictionaries
+/// searched by their btree indices alone can tell, so with any other one all
+/// the forms are found. It runs off the main thread, since the index is read.
+class NewArticleFormsRequest: public Dictionary::WordSearchRequest
+{
+  sptr< Dictionary::Class > dictionary;
+  wstring word;
+  vector< wstring > forms;
+  bool ignoreDiacritics;
+
+  QAtomicInt isCancelled;
+  QFuture< void > f;
+
+public:
+
+  NewArticleFormsRequest( sptr< Dictionary::Class > const & dictionary_,
+                          wstring const & word_,
+                          vector< wstring > const & forms_,
+                          bool ignoreDiacritics_ ):
+    dictionary( dictionary_ ),
+    word( word_ ),
+    forms( forms_ ),
+    ignoreDiacritics( ignoreDiacritics_ )
+  {
+    f = QtConcurrent::run( [ this ]() {
+      this->run();
+    } );
+  }
+
+  void run();
+
+  void cancel() override
+  {
+    isCancelled.ref();
+  }
+
+  ~NewArticleFormsRequest() override
+  {
+    isCancelled.ref();
+    f.waitForFinished();
+  }
+};
+
+void NewArticleFormsRequest::run()
+{
+  if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+    finish();
+    return;
+  }
+
+  vector< wstring > found = forms;
 
-    vector< wstring > altsVector( alts.begin(), alts.end() );
+  auto btreeDictionary = dynamic_cast< BtreeIndexing::BtreeDictionary * >( dictionary.get() );
 
-    wstring wordStd = gd::toWString( word );
+  if ( btreeDictionary && btreeDictionary->matchesOnlyIndexedWords() && btreeDictionary->ensureInitDone().empty() ) {
+    try {
+      set< uint32_t > offsets;
+
+      for ( auto const & link : btreeDictionary->findArticles( word, ignoreDiacritics ) ) {
+        offsets.insert( link.articleOffset );
+      }
+
+      found.clear();
+
+      for ( auto const & form : forms ) {
+        if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+          break;
+        }
+
+        for ( auto const & link : btreeDictionary->findArticles( form, ignoreDiacritics ) ) {
+          if ( !offsets.count( link.articleOffset ) ) {
+            found.push_back( form );
+            break;
+          }
+        }
+      }
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "Checking the forms of a word failed (%s) in \"%s\"\n", e.what(), dictionary->getName().c_str() );
+
+      found = forms;
+    }
+  }
+
+  {
+    QMutexLocker _( &dataMutex );
+
+    for ( auto const & form : found ) {
+      matches.emplace_back( form );
+    }
+  }
+
+  finish();
+}
+
+} // namespace
+
+void ArticleRequest::checkAlts()
+{
+  wstring wordStd = gd::toWString( word );
+
+  vector< wstring > forms;
+
+  for ( auto const & alt : alts ) {
+    if ( alt != wordStd ) {
+      forms.push_back( alt );
+    }
+  }
+
+  if ( forms.empty() ) {
+    return;
+  }
+
+  for ( size_t x = 0; x < activeDicts.size(); ++x ) {
+    sptr< Dictionary::Class > const & activeDict = activeDicts[ x ];
+
+    if ( activeDict->getFeatures() & Dictionary::ArticlesIgnoreAlts ) {
+      continue; // Nothing would change
+    }
+
+    altChecks[ x ] = std::make_shared< NewArticleFormsRequest >( activeDict, wordStd, forms, ignoreDiacritics );
+
+    connect( altChecks[ x ].get(),
+             &Dictionary::Request::finished,
+             this,
+             &ArticleRequest::altCheckFinished,
+             Qt::QueuedConnection );
+  }
+}
+
+void ArticleRequest::altCheckFinished()
+{
+  if ( bodyDone ) {
+    return;
+  }
+
+  wstring wordStd = gd::toWString( word );
 
-    if ( activeDicts.size() <= 1 ) {
-      articleSizeLimit = -1; // Don't collapse article if only one dictionary presented
+  for ( size_t x = bodiesDone; x < altChecks.size(); ++x ) {
+    if ( !altChecks[ x ] || !altChecks[ x ]->isFinished() ) {
+      continue;
     }
 
-    for ( const auto & activeDict : activeDicts ) {
+    if ( altChecks[ x ]->matchesCount() ) {
+      // The articles are requested for the word along with all the alts, like
+      // when the alts are known right away, so that the dictionary merges
+      // them and leaves out the repeated ones
+      sptr< Dictionary::Class > const & activeDict = activeDicts[ x ];
+
       try {
         sptr< Dictionary::DataRequest > r = activeDict->getArticle(
           wordStd,
-          altsVector,
+          vector< wstring >( alts.begin(), alts.end() ),
           gd::removeTrailingZero( contexts.value( QString::fromStdString( activeDict->getId() ) ) ),
           ignoreDiacritics );
 
         connect( r.get(), &Dictionary::Request::finished, this, &ArticleRequest::bodyFinished, Qt::QueuedConnection );
 
-        bodyRequests.push_back( r );
+        altBodyRequests[ x ] = r;
+
+        if ( bodyRequests[ x ] ) {
+          bodyRequests[ x ]->cancel();
+        }
       }
       catch ( std::exception & e ) {
         gdWarning( "getArticle request error (%s) in \"%s\"\n", e.what(), activeDict->getName().c_str() );
       }
     }
 
-    bodyFinished(); // Handle any ones which have already finished
+    altChecks[ x ].reset();
   }
+
+  bodyFinished();
 }
 
 int ArticleRequest::findEndOfCloseDiv( const QString & str, int pos )
@@ -589,135 +846,148 @@ bool ArticleRequest::isCollapsable( Dictionary::DataRequest & req, QString const
   return collapse;
 }
 
-void ArticleRequest::bodyFinished()
+void ArticleRequest::appendArticle( size_t dictIndex, Dictionary::DataRequest & req, QStringList & dictIds )
 {
-  if ( bodyDone ) {
-    return;
-  }
+  QString errorString = req.getErrorString();
 
-  GD_DPRINTF( "some body finished" );
+  sptr< Dictionary::Class > const & activeDict = activeDicts[ dictIndex ];
 
-  bool wasUpdated = false;
+  string dictId = activeDict->getId();
 
-  QStringList dictIds;
-  while ( bodyRequests.size() ) {
-    // Since requests should go in order, check the first one first
-    if ( bodyRequests.front()->isFinished() ) {
-      // Good
+  dictIds << QString::fromStdString( dictId );
+  string head;
 
-      GD_DPRINTF( "one finished." );
+  string gdFrom = "gdfrom-" + Html::escape( dictId );
 
-      Dictionary::DataRequest & req = *bodyRequests.front();
+  if ( closePrevSpan ) {
+    head += R"(</div></div><div style="clear:both;"></div><span class="gdarticleseparator"></span>)";
+  }
 
-      QString errorString = req.getErrorString();
+  bool collapse = isCollapsable( req, QString::fromStdString( dictId ) );
+
+  string jsVal = Html::escapeForJavaScript( dictId );
+
+  fmt::format_to( std::back_inserter( head ),
+                  FMT_COMPILE(
+                    R"( <div class="gdarticle {0} {1}" id="{2}"
+                        onClick="if(typeof gdMakeArticleActive !='undefined')  gdMakeArticleActive( '{3}', false );"
+                        onContextMenu="if(typeof gdMakeArticleActive !='undefined') gdMakeArticleActive( '{3}', false );">)" ),
+                  closePrevSpan ? "" : " gdactivearticle",
+                  collapse ? " gdcollapsedarticle" : "",
+                  gdFrom,
+                  jsVal );
+
+  closePrevSpan = true;
+
+  fmt::format_to(
+    std::back_inserter( head ),
+    FMT_COMPILE(
+      R"(<div class="gddictname" onclick="gdExpandArticle('{0}');"  {1}  id="gddictname-{0}" title="{2}">
+                <span class="gddicticon"><img src="gico://{0}/dicticon.png"></span>
+                <span class="gdfromprefix">{3}</span>
+                <span class="gddicttitle">{4}</span>
+                <span class="collapse_expand_area"><img class="{5}" id="expandicon-{0}" title="{6}" ></span>
+               </div>)" ),
+    dictId,
+    collapse ? R"(style="cursor:pointer;")" : "",
+    collapse ? tr( "Expand article" ).toStdString() : "",
+    Html::escape( tr( "From " ).toStdString() ),
+    Html::escape( activeDict->getName() ),
+    collapse ? "gdexpandicon" : "gdcollapseicon",
+    collapse ? "" : tr( "Collapse article" ).toStdString() );
+
+  head += R"(<div class="gddictnamebodyseparator"></div>)";
+
+  // If the user has enabled Anki integration in settings,
+  // Show a (+) button that lets the user add a new Anki card.
+  if ( ankiConnectEnabled() ) {
+    QString link{ R"EOF(
+    <a href="ankicard:%1" class="ankibutton" title="%2" >
+    <img src="qrc:///icons/add-anki-icon.svg">
+    </a>
+    )EOF" };
+    head += link.arg( Html::escape( dictId ).c_str(), tr( "Make a new Anki note" ) ).toStdString();
+  }
 
-      if ( req.dataSize() >= 0 || errorString.size() ) {
-        sptr< Dictionary::Class > const & activeDict = activeDicts[ activeDicts.size() - bodyRequests.size() ];
+  fmt::format_to(
+    std::back_inserter( head ),
+    FMT_COMPILE(
+      R"(<div class="gdarticlebody gdlangfrom-{}" lang="{}" style="display:{}" id="gdarticlefrom-{}">)" ),
+    LangCoder::intToCode2( activeDict->getLangFrom() ).toStdString(),
+    LangCoder::intToCode2( activeDict->getLangTo() ).toStdString(),
+    collapse ? "none" : "inline",
+    dictId );
+
+  if ( errorString.size() ) {
+    head += "<div class=\"gderrordesc\">"
+      + Html::escape( tr( "Query error: %1" ).arg( errorString ).toUtf8().data() ) + "</div>";
+  }
 
-        string dictId = activeDict->getId();
+  appendString( head );
 
+  try {
+    if ( req.dataSize() > 0 ) {
+      auto d = req.getFullData();
+      appendDataSlice( &d.front(), d.size() );
+    }
+  }
+  catch ( std::exception & e ) {
+    gdWarning( "getDataSlice error: %s\n", e.what() );
+  }
 
-        dictIds << QString::fromStdString( dictId );
-        string head;
+  foundAnyDefinitions = true;
 
-        string gdFrom = "gdfrom-" + Html::escape( dictId );
+  //signal finished dictionary for pronounciation
+  GlobalBroadcaster::instance()->pronounce_engine.finishDictionary( dictId );
+}
 
-        if ( closePrevSpan ) {
-          head += R"(</div></div><div style="clear:both;"></div><span class="gdarticleseparator"></span>)";
-        }
+void ArticleRequest::bodyFinished()
+{
+  if ( bodyDone ) {
+    return;
+  }
 
-        bool collapse = isCollapsable( req, QString::fromStdString( dictId ) );
-
-        string jsVal = Html::escapeForJavaScript( dictId );
-
-        fmt::format_to( std::back_inserter( head ),
-                        FMT_COMPILE(
-                          R"( <div class="gdarticle {0} {1}" id="{2}"
-                              onClick="if(typeof gdMakeArticleActive !='undefined')  gdMakeArticleActive( '{3}', false );"
-                              onContextMenu="if(typeof gdMakeArticleActive !='undefined') gdMakeArticleActive( '{3}', false );">)" ),
-                        closePrevSpan ? "" : " gdactivearticle",
-                        collapse ? " gdcollapsedarticle" : "",
-                        gdFrom,
-                        jsVal );
-
-        closePrevSpan = true;
-
-        fmt::format_to(
-          std::back_inserter( head ),
-          FMT_COMPILE(
-            R"(<div class="gddictname" onclick="gdExpandArticle('{0}');"  {1}  id="gddictname-{0}" title="{2}">
-                      <span class="gddicticon"><img src="gico://{0}/dicticon.png"></span>
-                      <span class="gdfromprefix">{3}</span>
-                      <span class="gddicttitle">{4}</span>
-                      <span class="collapse_expand_area"><img class="{5}" id="expandicon-{0}" title="{6}" ></span>
-                     </div>)" ),
-          dictId,
-          collapse ? R"(style="cursor:pointer;")" : "",
-          collapse ? tr( "Expand article" ).toStdString() : "",
-          Html::escape( tr( "From " ).toStdString() ),
-          Html::escape( activeDict->getName() ),
-          collapse ? "gdexpandicon" : "gdcollapseicon",
-          collapse ? "" : tr( "Collapse article" ).toStdString() );
-
-        head += R"(<div class="gddictnamebodyseparator"></div>)";
-
-        // If the user has enabled Anki integration in settings,
-        // Show a (+) button that lets the user add a new Anki card.
-        if ( ankiConnectEnabled() ) {
-          QString link{ R"EOF(
-          <a href="ankicard:%1" class="ankibutton" title="%2" >
-          <img src="qrc:///icons/add-anki-icon.svg">
-          </a>
-          )EOF" };
-          head += link.arg( Html::escape( dictId ).c_str(), tr( "Make a new Anki note" ) ).toStdString();
-        }
+  GD_DPRINTF( "some body finished" );
 
-        fmt::format_to(
-          std::back_inserter( head ),
-          FMT_COMPILE(
-            R"(<div class="gdarticlebody gdlangfrom-{}" lang="{}" style="display:{}" id="gdarticlefrom-{}">)" ),
-          LangCoder::intToCode2( activeDict->getLangFrom() ).toStdString(),
-          LangCoder::intToCode2( activeDict->getLangTo() ).toStdString(),
-          collapse ? "none" : "inline",
-          dictId );
-
-        if ( errorString.size() ) {
-          head += "<div class=\"gderrordesc\">"
-            + Html::escape( tr( "Query error: %1" ).arg( errorString ).toUtf8().data() ) + "</div>";
-        }
+  bool wasUpdated = false;
 
-        appendString( head );
+  QStringList dictIds;
 
-        try {
-          if ( req.dataSize() > 0 ) {
-            auto d = bodyRequests.front()->getFullData();
-            appendDataSlice( &d.front(), d.size() );
-          }
-        }
-        catch ( std::exception & e ) {
-          gdWarning( "getDataSlice error: %s\n", e.what() );
-        }
+  // The articles go in the group's order, each one as soon as every earlier
+  // dictionary is done. Until the alts are known, neither is a dictionary
+  // which may have articles for them.
+  while ( bodiesDone < bodyRequests.size() ) {
+    if ( !altsDone && !( activeDicts[ bodiesDone ]->getFeatures() & Dictionary::ArticlesIgnoreAlts ) ) {
+      break;
+    }
 
-        wasUpdated = true;
+    if ( altChecks[ bodiesDone ] ) {
+      break; // The alts are still being checked
+    }
 
-        foundAnyDefinitions = true;
+    sptr< Dictionary::DataRequest > const & req =
+      altBodyRequests[ bodiesDone ] ? altBodyRequests[ bodiesDone ] : bodyRequests[ bodiesDone ];
 
-        //signal finished dictionary for pronounciation
-        GlobalBroadcaster::instance()->pronounce_engine.finishDictionary( dictId );
-      }
-      GD_DPRINTF( "erasing.." );
-      bodyRequests.pop_front();
-      GD_DPRINTF( "erase done.." );
-    }
-    else {
+    // Since requests should go in order, check the first one first. An empty
+    // one means the dictionary failed to make a request at all.
+    if ( req && !req->isFinished() ) {
       GD_DPRINTF( "one not finished." );
       break;
     }
+
+    if ( req && ( req->dataSize() >= 0 || req->getErrorString().size() ) ) {
+      GD_DPRINTF( "one finished." );
+
+      appendArticle( bodiesDone, *req, dictIds );
+      wasUpdated = true;
+    }
+
+    ++bodiesDone;
   }
 
   ActiveDictIds hittedWord{ group.id, word, dictIds };
 
-  if ( bodyRequests.empty() ) {
+  if ( bodiesDone == bodyRequests.size() ) {
     // No requests left, end the article
 
     bodyDone = true;
@@ -1086,9 +1356,19 @@ void ArticleRequest::cancel()
       ( *i )->cancel();
     }
   }
-  if ( !bodyRequests.empty() ) {
-    for ( list< sptr< Dictionary::DataRequest > >::iterator i = bodyRequests.begin(); i != bodyRequests.end(); ++i ) {
-      ( *i )->cancel();
+  for ( auto const & bodyRequest : bodyRequests ) {
+    if ( bodyRequest ) {
+      bodyRequest->cancel();
+    }
+  }
+  for ( auto const & altCheck : altChecks ) {
+    if ( altCheck ) {
+      altCheck->cancel();
+    }
+  }
+  for ( auto const & altBodyRequest : altBodyRequests ) {
+    if ( altBodyRequest ) {
+      altBodyRequest->cancel();
     }
   }
   if ( stemmedWordFinder.get() ) {
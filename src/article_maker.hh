@@ -5,7 +5,9 @@
 #define __ARTICLE_MAKER_HH_INCLUDED__
 
 #include <QObject>
+#include <QFileSystemWatcher>
 #include <QMap>
+#include <QMutex>
 #include <set>
 #include <list>
 #include "config.hh"
@@ -68,9 +70,35 @@ public:
   string makeBlankHtml() const;
 
 private:
+
+  /// The parts of the html header which only depend on the preferences and
+  /// the user's style files. They are put together once and reused until any
+  /// of those change; only the title and the icon differ between the pages.
+  struct HeaderTemplate
+  {
+    bool valid = false;
+
+    // The preferences the template was made for
+    QString displayStyle, addonStyle;
+    bool darkReaderMode = false;
+
+    std::string screenCss; // Everything before the optional parts css
+    std::string printCss;  // The rest before the title
+    std::string tail;      // After the icon, up to and including <body>
+  };
+
+  mutable QMutex headerMutex;
+  mutable HeaderTemplate headerTemplate;
+  /// Watches the style files and their directories, to drop the template
+  /// when they change. It's only used from the main thread.
+  mutable QFileSystemWatcher styleWatcher;
+
   std::string readCssFile( QString const & fileName, std::string type ) const;
   /// Makes everything up to and including the opening body tag.
   std::string makeHtmlHeader( QString const & word, QString const & icon, bool expandOptionalParts ) const;
+  /// Rebuilds the headerTemplate for the current preferences. Requires the
+  /// headerMutex to be locked.
+  void makeHeaderTemplate() const;
 
   /// Makes the html body for makeNotFoundTextFor()
   static std::string makeNotFoundBody( QString const & word, QString const & group );
@@ -91,7 +119,18 @@ class ArticleRequest: public Dictionary::DataRequest
 
   std::set< gd::wstring, std::less<> > alts; // Accumulated main forms
   std::list< sptr< Dictionary::WordSearchRequest > > altSearches;
-  std::list< sptr< Dictionary::DataRequest > > bodyRequests;
+  /// The article requests for the word itself, one per active dictionary in
+  /// the same order, made without waiting for the alts. An entry is empty if
+  /// the dictionary failed to make a request.
+  std::vector< sptr< Dictionary::DataRequest > > bodyRequests;
+  /// Once the alts are known, the checks of which of them lead a dictionary to
+  /// articles the word itself doesn't. An entry is empty once it's handled.
+  std::vector< sptr< Dictionary::WordSearchRequest > > altChecks;
+  /// The requests for the word along with the alts, made for the dictionaries
+  /// the alts add articles in. Each one takes the place of the dictionary's
+  /// request in bodyRequests.
+  std::vector< sptr< Dictionary::DataRequest > > altBodyRequests;
+  size_t bodiesDone{ 0 }; // The number of leading dictionaries already handled
   bool altsDone{ false };
   bool bodyDone{ false };
   bool foundAnyDefinitions{ false };
@@ -134,6 +173,7 @@ public:
 private slots:
 
   void altSearchFinished();
+  void altCheckFinished();
   void bodyFinished();
   void stemmedSearchFinished();
   void individualWordFinished();
@@ -141,6 +181,17 @@ private slots:
 private:
   int htmlTextSize( QString html );
 
+  /// Requests the articles for the word itself from all the active
+  /// dictionaries.
+  void requestBodies();
+
+  /// Starts the altChecks of the dictionaries which use the alts.
+  void checkAlts();
+
+  /// Appends the article of the given dictionary made from the given request,
+  /// adding the dictionary's id to dictIds.
+  void appendArticle( size_t dictIndex, Dictionary::DataRequest &, QStringList & dictIds );
+
   /// Uses stemmedWordFinder to perform the next step of looking up word
   /// combinations.
   void compoundSearchNextStep( bool lastSearchSucceeded );
@@ -201,12 +201,46 @@ string ArticleNetworkAccessManager::getHtml( ResourceType resourceType )
   }
 }
 
-sptr< Dictionary::DataRequest > ArticleNetworkAccessManager::getResource( QUrl const & url, QString & contentType )
+void ArticleNetworkAccessManager::dictionariesChanged()
 {
-  qDebug() << "getResource:" << url.toString();
-  qDebug() << "scheme:" << url.scheme();
-  qDebug() << "host:" << url.host();
+  dictionaryPositions.clear();
+  dictionaryPositionsValid = false;
+  encodedIcons.clear();
+}
+
+sptr< Dictionary::Class > ArticleNetworkAccessManager::findDictionary( string const & id )
+{
+  for ( int attempt = 0; attempt < 2; ++attempt ) {
+    if ( !dictionaryPositionsValid ) {
+      dictionaryPositions.clear();
+      dictionaryPositions.reserve( dictionaries.size() );
+
+      for ( size_t x = 0; x < dictionaries.size(); ++x ) {
+        dictionaryPositions.emplace( dictionaries[ x ]->getId(), x );
+      }
+
+      dictionaryPositionsValid = true;
+    }
+
+    auto i = dictionaryPositions.find( id );
+
+    if ( i == dictionaryPositions.end() ) {
+      return {};
+    }
+
+    // Guard against the dictionaries having changed without notice
+    if ( i->second < dictionaries.size() && dictionaries[ i->second ]->getId() == id ) {
+      return dictionaries[ i->second ];
+    }
+
+    dictionariesChanged();
+  }
+
+  return {};
+}
 
+sptr< Dictionary::DataRequest > ArticleNetworkAccessManager::getResource( QUrl const & url, QString & contentType )
+{
   if ( url.scheme() == "gdlookup" ) {
     if ( !url.host().isEmpty() && url.host() != "localhost" ) {
       // Strange request - ignore it
@@ -258,31 +292,39 @@ sptr< Dictionary::DataRequest > ArticleNetworkAccessManager::getResource( QUrl c
     contentType        = mineType.name();
     string id          = url.host().toStdString();
 
-    bool search = ( id == "search" );
-
-    if ( !search ) {
-      for ( const auto & dictionary : dictionaries ) {
-        if ( dictionary->getId() == id ) {
-          if ( url.scheme() == "gico" ) {
-            QByteArray bytes;
-            QBuffer buffer( &bytes );
-            buffer.open( QIODevice::WriteOnly );
-            dictionary->getIcon().pixmap( 64 ).save( &buffer, "PNG" );
-            buffer.close();
-            sptr< Dictionary::DataRequestInstant > ico = std::make_shared< Dictionary::DataRequestInstant >( true );
-            ico->getData().resize( bytes.size() );
-            memcpy( &( ico->getData().front() ), bytes.data(), bytes.size() );
-            return ico;
-          }
-          try {
-            return dictionary->getResource( Utils::Url::path( url ).mid( 1 ).toUtf8().data() );
-          }
-          catch ( std::exception & e ) {
-            gdWarning( "getResource request error (%s) in \"%s\"\n", e.what(), dictionary->getName().c_str() );
-            return {};
-          }
-        }
+    if ( id == "search" ) {
+      return {};
+    }
+
+    sptr< Dictionary::Class > dictionary = findDictionary( id );
+
+    if ( !dictionary ) {
+      return {};
+    }
+
+    if ( url.scheme() == "gico" ) {
+      auto icon = encodedIcons.find( id );
+
+      if ( icon == encodedIcons.end() ) {
+        QByteArray bytes;
+        QBuffer buffer( &bytes );
+        buffer.open( QIODevice::WriteOnly );
+        dictionary->getIcon().pixmap( 64 ).save( &buffer, "PNG" );
+        buffer.close();
+        icon = encodedIcons.emplace( id, bytes ).first;
       }
+
+      sptr< Dictionary::DataRequestInstant > ico = std::make_shared< Dictionary::DataRequestInstant >( true );
+      ico->getData().assign( icon->second.begin(), icon->second.end() );
+      return ico;
+    }
+
+    try {
+      return dictionary->getResource( Utils::Url::path( url ).mid( 1 ).toUtf8().data() );
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "getResource request error (%s) in \"%s\"\n", e.what(), dictionary->getName().c_str() );
+      return {};
     }
   }
 
@@ -11,6 +11,7 @@
 #include <QWebEngineUrlRequestJob>
 #include <QNetworkAccessManager>
 
+#include <unordered_map>
 #include <utility>
 
 #include "dict/dictionary.hh"
@@ -140,6 +141,17 @@ class ArticleNetworkAccessManager: public QNetworkAccessManager
   bool const & hideGoldenDictHeader;
   QMimeDatabase db;
 
+  /// The positions of the dictionaries in 'dictionaries', by their ids. It's
+  /// rebuilt on the first lookup after the dictionaries change.
+  std::unordered_map< std::string, size_t > dictionaryPositions;
+  bool dictionaryPositionsValid = false;
+
+  /// The PNG-encoded dictionary icons served for gico:// urls, by dictionary id
+  std::unordered_map< std::string, QByteArray > encodedIcons;
+
+  /// Returns the dictionary with the given id, or an empty pointer
+  sptr< Dictionary::Class > findDictionary( std::string const & id );
+
 public:
 
   ArticleNetworkAccessManager( QObject * parent,
@@ -161,6 +173,10 @@ public:
   /// The function can optionally set the Content-Type header correspondingly.
   sptr< Dictionary::DataRequest > getResource( QUrl const & url, QString & contentType );
 
+  /// Must be called whenever the set of dictionaries changes, so that the
+  /// resource urls are routed to the new ones.
+  void dictionariesChanged();
+
   virtual QNetworkReply * getArticleReply( QNetworkRequest const & req );
   string getHtml( ResourceType resourceType );
 };
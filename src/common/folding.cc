@@ -7,6 +7,10 @@
 #include "globalregex.hh"
 #include "inc_case_folding.hh"
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+  #include <emmintrin.h>
+#endif
+
 namespace Folding {
 
 /// Tests if the given char is one of the Unicode combining marks. Some are
@@ -18,41 +22,135 @@ bool isCombiningMark( wchar ch )
   return QChar::isMark( ch );
 }
 
-wstring apply( wstring const & in, bool preserveWildcards )
+namespace {
+
+/// Tests if all the chars of the given string are ASCII ones. The chars are
+/// or'ed together several at a time, so this is cheap even for long strings.
+bool isAscii( wchar const * in, size_t size )
 {
-  //remove space and accent;
-  auto withPunc = QString::fromStdU32String( in )
-                    .normalized( QString::NormalizationForm_KD )
-                    .remove( RX::markSpace )
-                    .toStdU32String();
+  wchar const * end = in + size;
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+  __m128i acc = _mm_setzero_si128();
+
+  for ( ; end - in >= 4; in += 4 ) {
+    acc = _mm_or_si128( acc, _mm_loadu_si128( reinterpret_cast< __m128i const * >( in ) ) );
+  }
+
+  if ( _mm_movemask_epi8( _mm_cmpeq_epi32( _mm_and_si128( acc, _mm_set1_epi32( ~0x7F ) ), _mm_setzero_si128() ) )
+       != 0xFFFF ) {
+    return false;
+  }
+#endif
+
+  wchar bits = 0;
 
-  //First, strip diacritics and apply ws/punctuation removal
-  wstring withoutDiacritics;
+  for ( ; in != end; ++in ) {
+    bits |= *in;
+  }
 
-  withoutDiacritics.reserve( withPunc.size() );
+  return bits < 0x80;
+}
 
+/// The result of folding each of the ASCII chars, or zero for the ones which
+/// get removed: controls, space and punctuation.
+struct AsciiFoldTable
+{
+  char chars[ 0x80 ];
 
-  for ( auto const & ch : withPunc ) {
+  constexpr AsciiFoldTable():
+    chars()
+  {
+    for ( int ch = 0x21; ch < 0x7F; ++ch ) {
+      chars[ ch ] = ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : ch;
+    }
 
-    if ( !isPunct( ch )
-         || ( preserveWildcards && ( ch == '\\' || ch == '?' || ch == '*' || ch == '[' || ch == ']' ) ) ) {
-      withoutDiacritics.push_back( ch );
+    for ( char const * p = "!\"#%&'()*,-./:;?@[\\]_{}"; *p; ++p ) {
+      chars[ (int)*p ] = 0;
     }
   }
+};
+
+constexpr AsciiFoldTable asciiFoldTable;
 
+inline bool isWildcard( wchar ch )
+{
+  return ch == '\\' || ch == '?' || ch == '*' || ch == '[' || ch == ']';
+}
+
+/// Tests if the given char is a mark, a separator or an invisible one. Such
+/// chars are removed by the main folding algorithm.
+inline bool isMarkSpace( wchar ch )
+{
+  switch ( QChar::category( ch ) ) {
+    case QChar::Mark_NonSpacing:
+    case QChar::Mark_SpacingCombining:
+    case QChar::Mark_Enclosing:
+    case QChar::Separator_Space:
+    case QChar::Separator_Line:
+    case QChar::Separator_Paragraph:
+    case QChar::Other_Control:
+    case QChar::Other_Format:
+    case QChar::Other_Surrogate:
+    case QChar::Other_PrivateUse:
+    case QChar::Other_NotAssigned:
+      return true;
+    default:
+      return false;
+  }
+}
 
-  // Now, fold the case
+} // namespace
 
+wstring apply( wstring const & in, bool preserveWildcards )
+{
   wstring caseFolded;
 
-  caseFolded.reserve( withoutDiacritics.size() * foldCaseMaxOut );
+  if ( isAscii( in.data(), in.size() ) ) {
+    // NFKD doesn't change ASCII, and neither of its chars folds to more than
+    // one char, so there's just the table lookup left.
+    caseFolded.reserve( in.size() );
+
+    for ( wchar ch : in ) {
+      char folded = asciiFoldTable.chars[ ch ];
+
+      if ( folded ) {
+        caseFolded.push_back( folded );
+      }
+      else if ( preserveWildcards && isWildcard( ch ) ) {
+        caseFolded.push_back( ch );
+      }
+    }
+
+    return caseFolded;
+  }
+
+  // Decompose the chars, then drop marks, whitespace, invisible chars and
+  // punctuation, and fold the case of the rest, all in a single pass.
+  QString const decomposed = QString::fromStdU32String( in ).normalized( QString::NormalizationForm_KD );
+
+  caseFolded.reserve( decomposed.size() * foldCaseMaxOut );
 
-  wchar const * nextChar = withoutDiacritics.data();
+  QChar const * nextChar = decomposed.constData();
+  QChar const * end      = nextChar + decomposed.size();
 
   wchar buf[ foldCaseMaxOut ];
 
-  for ( size_t left = withoutDiacritics.size(); left--; ) {
-    caseFolded.append( buf, foldCase( *nextChar++, buf ) );
+  while ( nextChar != end ) {
+    wchar ch = nextChar->unicode();
+
+    ++nextChar;
+
+    if ( QChar::isHighSurrogate( ch ) && nextChar != end && nextChar->isLowSurrogate() ) {
+      ch = QChar::surrogateToUcs4( ch, nextChar->unicode() );
+      ++nextChar;
+    }
+
+    if ( isMarkSpace( ch ) || ( isPunct( ch ) && !( preserveWildcards && isWildcard( ch ) ) ) ) {
+      continue;
+    }
+
+    caseFolded.append( buf, foldCase( ch, buf ) );
   }
 
   return caseFolded;
@@ -25,25 +25,12 @@ public:
 class Mdx
 {
 public:
-  static QRegularExpression allLinksRe;
-  static QRegularExpression wordCrossLink;
   static QRegularExpression anchorIdRe;
   static QRegularExpression anchorIdReWord;
   static QRegularExpression anchorIdRe2;
   static QRegularExpression anchorLinkRe;
-  const static QRegularExpression audioRe;
-  const static QRegularExpression stylesRe;
-  static QRegularExpression stylesRe2;
-  static QRegularExpression inlineScriptRe;
-  static QRegularExpression closeScriptTagRe;
-  static QRegularExpression srcRe;
-  static QRegularExpression srcRe2;
-  static QRegularExpression srcset;
-  static QRegularExpression objectdata;
 
   static QRegularExpression links;
-  static QRegularExpression fontFace;
-  static QRegularExpression styleElement;
 };
 
 namespace Zim {
@@ -72,8 +59,6 @@ const static QRegularExpression accentMark( R"(\p{M})", QRegularExpression::UseU
 //contain unicode space mark,invisible, and punctuation
 const static QRegularExpression markPuncSpace( R"([\p{M}\p{Z}\p{C}\p{P}])",
                                                QRegularExpression::UseUnicodePropertiesOption );
-//contain unicode space and mark.invisible
-const static QRegularExpression markSpace( R"([\p{M}\p{Z}\p{C}])", QRegularExpression::UseUnicodePropertiesOption );
 
 const static QRegularExpression whiteSpace( "\\s+" );
 
@@ -0,0 +1,279 @@
+#include "htmlrewriter.hh"
+
+namespace Html {
+
+namespace {
+
+inline bool isSpace( char ch )
+{
+  return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f';
+}
+
+inline bool isAlpha( char ch )
+{
+  return ( ch >= 'a' && ch <= 'z' ) || ( ch >= 'A' && ch <= 'Z' );
+}
+
+inline char toLower( char ch )
+{
+  return ( ch >= 'A' && ch <= 'Z' ) ? ch + ( 'a' - 'A' ) : ch;
+}
+
+bool equalsIgnoreCase( std::string_view text, std::string_view lowercase )
+{
+  return text.size() == lowercase.size() && startsWithIgnoreCase( text, lowercase );
+}
+
+/// Finds the "</name" which ends a raw text element, starting from the given
+/// position. Returns the size of the html if there's none.
+size_t findEndTag( std::string_view html, size_t pos, std::string_view lowercaseName )
+{
+  for ( ;; ) {
+    pos = html.find( "</", pos );
+
+    if ( pos == std::string_view::npos ) {
+      return html.size();
+    }
+
+    if ( startsWithIgnoreCase( html.substr( pos + 2 ), lowercaseName ) ) {
+      return pos;
+    }
+
+    pos += 2;
+  }
+}
+
+} // namespace
+
+bool startsWithIgnoreCase( std::string_view text, std::string_view prefix )
+{
+  if ( text.size() < prefix.size() ) {
+    return false;
+  }
+
+  for ( size_t x = 0; x < prefix.size(); ++x ) {
+    if ( toLower( text[ x ] ) != toLower( prefix[ x ] ) ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool hasSchemeSlashes( std::string_view text )
+{
+  size_t x = 0;
+
+  while ( x < text.size()
+          && ( isAlpha( text[ x ] ) || ( text[ x ] >= '0' && text[ x ] <= '9' ) || text[ x ] == '_' ) ) {
+    ++x;
+  }
+
+  return x && text.substr( x, 3 ) == "://";
+}
+
+bool Rewriter::Tag::is( std::string_view lowercaseName ) const
+{
+  return equalsIgnoreCase( name, lowercaseName );
+}
+
+Rewriter::Attribute * Rewriter::Tag::find( std::string_view lowercaseName )
+{
+  for ( auto & attribute : attributes ) {
+    if ( equalsIgnoreCase( attribute.name, lowercaseName ) ) {
+      return &attribute;
+    }
+  }
+
+  return nullptr;
+}
+
+void Rewriter::handleStyle( std::string_view css, std::string & out )
+{
+  out.append( css );
+}
+
+void Rewriter::rewrite( std::string_view html, std::string & out )
+{
+  // Links usually get somewhat longer
+  out.reserve( out.size() + html.size() + html.size() / 8 );
+
+  size_t const size = html.size();
+  size_t copied     = 0; // Everything before this is already in 'out'
+  size_t pos        = 0;
+
+  Tag tag;
+
+  while ( ( pos = html.find( '<', pos ) ) != std::string_view::npos ) {
+    if ( html.substr( pos, 4 ) == "<!--" ) {
+      size_t end = html.find( "-->", pos + 4 );
+      pos        = end == std::string_view::npos ? size : end + 3;
+      continue;
+    }
+
+    // Some dictionaries put spaces after the '<'
+    size_t p = pos + 1;
+    while ( p < size && isSpace( html[ p ] ) ) {
+      ++p;
+    }
+
+    if ( p == size || !isAlpha( html[ p ] ) ) {
+      // An end tag, a doctype or just a stray '<'
+      pos = p;
+      continue;
+    }
+
+    size_t const nameBegin = p;
+    while ( p < size && !isSpace( html[ p ] ) && html[ p ] != '>' && html[ p ] != '/' ) {
+      ++p;
+    }
+
+    tag.name = html.substr( nameBegin, p - nameBegin );
+    tag.attributes.clear();
+    tag.selfClosing = false;
+    tag.slash       = std::string_view::npos;
+    tag.before.clear();
+    tag.after.clear();
+    tag.begin = pos;
+
+    bool terminated = false;
+
+    while ( p < size ) {
+      size_t const attributeBegin = p;
+
+      while ( p < size && isSpace( html[ p ] ) ) {
+        ++p;
+      }
+
+      if ( p == size ) {
+        break;
+      }
+
+      if ( html[ p ] == '>' ) {
+        terminated = true;
+        break;
+      }
+
+      if ( html[ p ] == '/' ) {
+        if ( p + 1 < size && html[ p + 1 ] == '>' ) {
+          tag.selfClosing = true;
+          tag.slash       = p;
+        }
+        ++p;
+        continue;
+      }
+
+      Attribute attribute;
+      attribute.begin = attributeBegin;
+
+      size_t const attributeNameBegin = p++; // The name may start with '='
+      while ( p < size && !isSpace( html[ p ] ) && html[ p ] != '>' && html[ p ] != '/' && html[ p ] != '=' ) {
+        ++p;
+      }
+
+      attribute.name    = html.substr( attributeNameBegin, p - attributeNameBegin );
+      attribute.nameEnd = p;
+
+      size_t q = p;
+      while ( q < size && isSpace( html[ q ] ) ) {
+        ++q;
+      }
+
+      if ( q < size && html[ q ] == '=' ) {
+        ++q;
+        while ( q < size && isSpace( html[ q ] ) ) {
+          ++q;
+        }
+
+        if ( q < size && ( html[ q ] == '"' || html[ q ] == '\'' ) ) {
+          size_t const valueEnd = html.find( html[ q ], q + 1 );
+
+          if ( valueEnd == std::string_view::npos ) {
+            break;
+          }
+
+          attribute.value = html.substr( q + 1, valueEnd - q - 1 );
+          p               = valueEnd + 1;
+        }
+        else {
+          size_t const valueBegin = q;
+          while ( q < size && !isSpace( html[ q ] ) && html[ q ] != '>' ) {
+            ++q;
+          }
+
+          attribute.value = html.substr( valueBegin, q - valueBegin );
+          p               = q;
+        }
+      }
+
+      attribute.end = p;
+      tag.attributes.push_back( std::move( attribute ) );
+    }
+
+    if ( !terminated ) {
+      break; // The rest is a truncated tag, leave it alone
+    }
+
+    tag.end = p + 1;
+
+    handleTag( tag );
+
+    out.append( html.substr( copied, tag.begin - copied ) );
+    writeTag( html, tag, out );
+    copied = pos = tag.end;
+
+    // The contents of these aren't html
+    bool const isScript = tag.is( "script" );
+
+    if ( ( isScript || tag.is( "style" ) ) && !tag.selfClosing ) {
+      size_t const end = findEndTag( html, pos, isScript ? "script" : "style" );
+
+      if ( isScript ) {
+        out.append( html.substr( pos, end - pos ) );
+      }
+      else {
+        handleStyle( html.substr( pos, end - pos ), out );
+      }
+
+      copied = pos = end;
+    }
+  }
+
+  out.append( html.substr( copied ) );
+}
+
+void Rewriter::writeTag( std::string_view html, Tag const & tag, std::string & out )
+{
+  out.append( tag.before );
+
+  size_t copied = tag.begin;
+
+  for ( auto const & attribute : tag.attributes ) {
+    if ( attribute.removed ) {
+      out.append( html.substr( copied, attribute.begin - copied ) );
+      copied = attribute.end;
+    }
+    else if ( attribute.changed ) {
+      char const quote = attribute.newValue.find( '"' ) == std::string::npos ? '"' : '\'';
+
+      out.append( html.substr( copied, attribute.nameEnd - copied ) );
+      out.push_back( '=' );
+      out.push_back( quote );
+      out.append( attribute.newValue );
+      out.push_back( quote );
+      copied = attribute.end;
+    }
+  }
+
+  // Tags which were self-closing but aren't anymore lose their slash
+  if ( !tag.selfClosing && tag.slash != std::string_view::npos ) {
+    out.append( html.substr( copied, tag.slash - copied ) );
+    copied = tag.slash + 1;
+  }
+
+  out.append( html.substr( copied, tag.end - copied ) );
+
+  out.append( tag.after );
+}
+
+} // namespace Html
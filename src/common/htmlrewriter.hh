@@ -0,0 +1,89 @@
+#ifndef __HTMLREWRITER_HH_INCLUDED__
+#define __HTMLREWRITER_HH_INCLUDED__
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Html {
+
+/// Returns true if the text starts with the given ASCII prefix, ignoring case
+bool startsWithIgnoreCase( std::string_view text, std::string_view prefix );
+
+/// Returns true if the text starts with an URL scheme followed by "://"
+bool hasSchemeSlashes( std::string_view text );
+
+/// Rewrites the start tags of an utf8 html document in a single pass. Only the
+/// changed attributes are reformatted; everything else, including comments,
+/// end tags and the contents of <script> elements, is copied as is.
+/// Subclasses decide what to change by implementing handleTag().
+class Rewriter
+{
+public:
+
+  struct Attribute
+  {
+    std::string_view name;  // As written in the source
+    std::string_view value; // Without the quotes, entities are left as they are
+
+    /// The new value, used if 'changed' is set. It's written in double quotes,
+    /// or in single ones if it contains a double quote.
+    std::string newValue;
+    bool changed = false;
+    bool removed = false;
+
+    void set( std::string value )
+    {
+      newValue = std::move( value );
+      changed  = true;
+    }
+
+    // The position of the attribute in the source, including the whitespace
+    // before it, and the end of its name
+    size_t begin, nameEnd, end;
+  };
+
+  struct Tag
+  {
+    std::string_view name; // As written in the source
+    std::vector< Attribute > attributes;
+
+    /// Set if the tag ends with "/>". Clearing it drops the slash.
+    bool selfClosing = false;
+
+    /// Inserted before and after the tag
+    std::string before, after;
+
+    /// Compares the tag name with the given lowercase one, ignoring case
+    bool is( std::string_view lowercaseName ) const;
+
+    /// Returns the first attribute with the given lowercase name, or nullptr
+    Attribute * find( std::string_view lowercaseName );
+
+    // The position of the tag in the source, and of its closing slash if
+    // it has one
+    size_t begin, end, slash;
+  };
+
+  virtual ~Rewriter() = default;
+
+  /// Rewrites the given html, appending the result to 'out'
+  void rewrite( std::string_view html, std::string & out );
+
+protected:
+
+  /// Called for each start tag. The tag can be changed in place.
+  virtual void handleTag( Tag & ) = 0;
+
+  /// Called for the contents of each <style> element. Appends them to 'out'
+  /// as they are by default.
+  virtual void handleStyle( std::string_view css, std::string & out );
+
+private:
+
+  void writeTag( std::string_view html, Tag const &, std::string & out );
+};
+
+} // namespace Html
+
+#endif
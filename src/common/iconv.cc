@@ -2,10 +2,11 @@
  * Part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
 
 #include "iconv.hh"
+#include <map>
 #include <vector>
 #include <errno.h>
+#include <stdint.h>
 #include <string.h>
-#include "wstring_qt.hh"
 
 char const * const Iconv::GdWchar = "UTF-32LE";
 char const * const Iconv::Utf16Le = "UTF-16LE";
@@ -80,6 +81,329 @@ QString Iconv::convert( void const *& inBuf, size_t & inBytesLeft )
   return QString::fromUtf8( &outBuf.front(), datasize );
 }
 
+namespace {
+
+/// The iconv states opened by the current thread, by their target and source
+/// encodings. Opening a state is costly, while each thread only ever uses a
+/// few of them, so they're kept open until the thread exits. The target is
+/// always one of the Iconv constants, so it's told apart by its address.
+class IconvStates
+{
+public:
+
+  ~IconvStates()
+  {
+    for ( auto const & i : states ) {
+      iconv_close( i.second );
+    }
+  }
+
+  /// Returns the state, reset to its initial shift state.
+  iconv_t get( char const * to, char const * from )
+  {
+    // A thread mostly converts from the same encoding over and over again,
+    // so the state used last is checked first, without making any key
+    if ( to != lastTo || lastFrom != from ) {
+      auto i = states.find( Key( to, from ) );
+
+      if ( i == states.end() ) {
+        iconv_t state = iconv_open( to, from );
+
+        if ( state == (iconv_t)-1 ) {
+          throw Iconv::exCantInit( strerror( errno ) );
+        }
+
+        i = states.emplace( Key( to, from ), state ).first;
+      }
+
+      lastState = i->second;
+      lastTo    = to;
+      lastFrom  = from;
+    }
+
+    iconv( lastState, nullptr, nullptr, nullptr, nullptr );
+
+    return lastState;
+  }
+
+private:
+
+  typedef std::pair< char const *, std::string > Key;
+
+  std::map< Key, iconv_t > states;
+
+  iconv_t lastState   = (iconv_t)-1;
+  char const * lastTo = nullptr;
+  std::string lastFrom;
+};
+
+thread_local IconvStates iconvStates;
+
+/// Converts the data with the given state, appending the result to 'out',
+/// which is a string of either chars or char32_t. Like Iconv::convert(), it
+/// stops at the first invalid or incomplete sequence.
+template< typename String >
+void convertWith( iconv_t state, void const * inBuf, size_t inBytesLeft, String & out )
+{
+  size_t const charSize = sizeof( typename String::value_type );
+
+  char * inPtr   = (char *)inBuf;
+  size_t outUsed = out.size();
+  bool flushing  = false;
+
+  out.resize( outUsed + inBytesLeft + 16 );
+
+  for ( ;; ) {
+    char * outPtr  = (char *)( out.data() + outUsed );
+    size_t outLeft = ( out.size() - outUsed ) * charSize;
+
+    size_t result = flushing ? iconv( state, nullptr, nullptr, &outPtr, &outLeft ) :
+                               iconv( state, &inPtr, &inBytesLeft, &outPtr, &outLeft );
+
+    outUsed = ( outPtr - (char *)out.data() ) / charSize;
+
+    if ( result == (size_t)-1 ) {
+      if ( errno == E2BIG ) {
+        out.resize( out.size() * 2 );
+        continue;
+      }
+
+      break; // Keep what's converted so far
+    }
+
+    if ( flushing ) {
+      break;
+    }
+
+    flushing = true;
+  }
+
+  out.resize( outUsed );
+}
+
+/// The encodings which are decoded without iconv
+enum class BuiltIn {
+  None,
+  Utf8,
+  Utf16Le,
+  Utf16Be,
+  Utf32Le,
+  Latin1
+};
+
+BuiltIn builtInFor( char const * encoding )
+{
+  if ( !qstricmp( encoding, "UTF-8" ) || !qstricmp( encoding, "UTF8" ) ) {
+    return BuiltIn::Utf8;
+  }
+  if ( !qstricmp( encoding, "UTF-16LE" ) ) {
+    return BuiltIn::Utf16Le;
+  }
+  if ( !qstricmp( encoding, "UTF-16BE" ) ) {
+    return BuiltIn::Utf16Be;
+  }
+  if ( !qstricmp( encoding, "UTF-32LE" ) ) {
+    return BuiltIn::Utf32Le;
+  }
+  if ( !qstricmp( encoding, "ISO-8859-1" ) || !qstricmp( encoding, "LATIN1" ) ) {
+    return BuiltIn::Latin1;
+  }
+
+  return BuiltIn::None;
+}
+
+inline bool isValidChar( char32_t ch )
+{
+  return ch < 0xD800 || ( ch > 0xDFFF && ch <= 0x10FFFF );
+}
+
+/// Returns the length of the leading part of the data which is valid utf8.
+/// ASCII runs are skipped several bytes at a time.
+size_t validUtf8Size( unsigned char const * data, size_t size )
+{
+  size_t pos = 0;
+
+  while ( pos < size ) {
+    uint64_t block;
+
+    if ( size - pos >= sizeof( block ) ) {
+      memcpy( &block, data + pos, sizeof( block ) );
+
+      if ( !( block & 0x8080808080808080ull ) ) {
+        pos += sizeof( block );
+        continue;
+      }
+    }
+
+    unsigned char lead = data[ pos ];
+    size_t length;
+    char32_t ch;
+
+    if ( lead < 0x80 ) {
+      ++pos;
+      continue;
+    }
+    else if ( lead >= 0xC2 && lead <= 0xDF ) {
+      length = 2;
+      ch     = lead & 0x1F;
+    }
+    else if ( lead >= 0xE0 && lead <= 0xEF ) {
+      length = 3;
+      ch     = lead & 0x0F;
+    }
+    else if ( lead >= 0xF0 && lead <= 0xF4 ) {
+      length = 4;
+      ch     = lead & 0x07;
+    }
+    else {
+      break;
+    }
+
+    if ( size - pos < length ) {
+      break;
+    }
+
+    size_t x = 1;
+
+    for ( ; x < length && ( data[ pos + x ] & 0xC0 ) == 0x80; ++x ) {
+      ch = ( ch << 6 ) | ( data[ pos + x ] & 0x3F );
+    }
+
+    // Reject truncated and overlong sequences, surrogates and chars beyond
+    // the Unicode range, just like iconv does
+    if ( x < length || ( length == 3 && ch < 0x800 ) || ( length == 4 && ch < 0x10000 ) || !isValidChar( ch ) ) {
+      break;
+    }
+
+    pos += length;
+  }
+
+  return pos;
+}
+
+/// Decodes the data in one of the built-in encodings, passing each char to
+/// the sink. Stops at the first invalid or incomplete sequence.
+template< typename Sink >
+void decodeBuiltIn( BuiltIn encoding, void const * data, size_t size, Sink & sink )
+{
+  unsigned char const * in = static_cast< unsigned char const * >( data );
+
+  switch ( encoding ) {
+    case BuiltIn::Utf8: {
+      size_t const validSize = validUtf8Size( in, size );
+
+      for ( size_t pos = 0; pos < validSize; ) {
+        unsigned char lead = in[ pos++ ];
+
+        if ( lead < 0x80 ) {
+          sink( lead );
+        }
+        else if ( lead < 0xE0 ) {
+          sink( ( char32_t( lead & 0x1F ) << 6 ) | ( in[ pos ] & 0x3F ) );
+          pos += 1;
+        }
+        else if ( lead < 0xF0 ) {
+          sink( ( char32_t( lead & 0x0F ) << 12 ) | ( char32_t( in[ pos ] & 0x3F ) << 6 ) | ( in[ pos + 1 ] & 0x3F ) );
+          pos += 2;
+        }
+        else {
+          sink( ( char32_t( lead & 0x07 ) << 18 ) | ( char32_t( in[ pos ] & 0x3F ) << 12 )
+                | ( char32_t( in[ pos + 1 ] & 0x3F ) << 6 ) | ( in[ pos + 2 ] & 0x3F ) );
+          pos += 3;
+        }
+      }
+      break;
+    }
+
+    case BuiltIn::Utf16Le:
+    case BuiltIn::Utf16Be: {
+      bool const bigEndian = encoding == BuiltIn::Utf16Be;
+      size_t const units   = size / 2;
+
+      auto unitAt = [ in, bigEndian ]( size_t x ) -> char32_t {
+        return bigEndian ? ( in[ x * 2 ] << 8 ) | in[ x * 2 + 1 ] : in[ x * 2 ] | ( in[ x * 2 + 1 ] << 8 );
+      };
+
+      for ( size_t x = 0; x < units; ++x ) {
+        char32_t ch = unitAt( x );
+
+        if ( ch >= 0xD800 && ch <= 0xDFFF ) {
+          if ( ch > 0xDBFF || x + 1 == units ) {
+            return; // A stray low surrogate, or a high one with nothing after it
+          }
+
+          char32_t low = unitAt( x + 1 );
+
+          if ( low < 0xDC00 || low > 0xDFFF ) {
+            return;
+          }
+
+          ch = 0x10000 + ( ( ch - 0xD800 ) << 10 ) + ( low - 0xDC00 );
+          ++x;
+        }
+
+        sink( ch );
+      }
+      break;
+    }
+
+    case BuiltIn::Utf32Le:
+      for ( size_t x = 0; x + 4 <= size; x += 4 ) {
+        char32_t ch = in[ x ] | ( in[ x + 1 ] << 8 ) | ( in[ x + 2 ] << 16 ) | ( char32_t( in[ x + 3 ] ) << 24 );
+
+        if ( !isValidChar( ch ) ) {
+          return;
+        }
+
+        sink( ch );
+      }
+      break;
+
+    case BuiltIn::Latin1:
+      for ( size_t x = 0; x < size; ++x ) {
+        sink( in[ x ] );
+      }
+      break;
+
+    case BuiltIn::None:
+      break;
+  }
+}
+
+/// Skips the byte order mark the utf8 data might start with. The decoders
+/// used before the built-in one dropped it as well.
+void skipUtf8Bom( void const *& data, size_t & size )
+{
+  if ( size >= 3 && !memcmp( data, "\xEF\xBB\xBF", 3 ) ) {
+    data = static_cast< char const * >( data ) + 3;
+    size -= 3;
+  }
+}
+
+void appendUtf8( char32_t ch, std::string & out )
+{
+  if ( ch < 0x80 ) {
+    out.push_back( ch );
+  }
+  else if ( ch < 0x800 ) {
+    out.push_back( 0xC0 | ( ch >> 6 ) );
+    out.push_back( 0x80 | ( ch & 0x3F ) );
+  }
+  else if ( ch < 0x10000 ) {
+    out.push_back( 0xE0 | ( ch >> 12 ) );
+    out.push_back( 0x80 | ( ( ch >> 6 ) & 0x3F ) );
+    out.push_back( 0x80 | ( ch & 0x3F ) );
+  }
+  else {
+    out.push_back( 0xF0 | ( ch >> 18 ) );
+    out.push_back( 0x80 | ( ( ch >> 12 ) & 0x3F ) );
+    out.push_back( 0x80 | ( ( ch >> 6 ) & 0x3F ) );
+    out.push_back( 0x80 | ( ch & 0x3F ) );
+  }
+}
+
+} // namespace
+
 gd::wstring Iconv::toWstring( char const * fromEncoding, void const * fromData, size_t dataSize )
 
 {
@@ -90,10 +414,29 @@ gd::wstring Iconv::toWstring( char const * fromEncoding, void const * fromData,
     return {};
   }
 
-  Iconv ic( fromEncoding );
+  gd::wstring result;
+
+  BuiltIn const builtIn = builtInFor( fromEncoding );
+
+  if ( builtIn == BuiltIn::Utf8 ) {
+    skipUtf8Bom( fromData, dataSize );
+  }
+
+  if ( builtIn != BuiltIn::None ) {
+    // No encoding takes less than a byte per char
+    result.reserve( dataSize );
 
-  QString outStr = ic.convert( fromData, dataSize );
-  return gd::toWString( outStr );
+    auto sink = [ &result ]( char32_t ch ) {
+      result.push_back( ch );
+    };
+
+    decodeBuiltIn( builtIn, fromData, dataSize, sink );
+  }
+  else {
+    convertWith( iconvStates.get( GdWchar, fromEncoding ), fromData, dataSize, result );
+  }
+
+  return result;
 }
 
 std::string Iconv::toUtf8( char const * fromEncoding, void const * fromData, size_t dataSize )
@@ -105,10 +448,30 @@ std::string Iconv::toUtf8( char const * fromEncoding, void const * fromData, siz
     return {};
   }
 
-  Iconv ic( fromEncoding );
+  std::string result;
+
+  BuiltIn const builtIn = builtInFor( fromEncoding );
+
+  if ( builtIn == BuiltIn::Utf8 ) {
+    skipUtf8Bom( fromData, dataSize );
+
+    result.assign( static_cast< char const * >( fromData ),
+                   validUtf8Size( static_cast< unsigned char const * >( fromData ), dataSize ) );
+  }
+  else if ( builtIn != BuiltIn::None ) {
+    result.reserve( dataSize + dataSize / 2 );
+
+    auto sink = [ &result ]( char32_t ch ) {
+      appendUtf8( ch, result );
+    };
+
+    decodeBuiltIn( builtIn, fromData, dataSize, sink );
+  }
+  else {
+    convertWith( iconvStates.get( Utf8, fromEncoding ), fromData, dataSize, result );
+  }
 
-  const QString outStr = ic.convert( fromData, dataSize );
-  return outStr.toStdString();
+  return result;
 }
 
 QString Iconv::toQString( char const * fromEncoding, void const * fromData, size_t dataSize )
@@ -117,6 +480,36 @@ QString Iconv::toQString( char const * fromEncoding, void const * fromData, size
     return {};
   }
 
-  Iconv ic( fromEncoding );
-  return ic.convert( fromData, dataSize );
+  BuiltIn const builtIn = builtInFor( fromEncoding );
+
+  if ( builtIn == BuiltIn::Utf8 ) {
+    skipUtf8Bom( fromData, dataSize );
+
+    return QString::fromUtf8( static_cast< char const * >( fromData ),
+                              validUtf8Size( static_cast< unsigned char const * >( fromData ), dataSize ) );
+  }
+
+  if ( builtIn != BuiltIn::None ) {
+    QString result;
+    result.reserve( dataSize );
+
+    auto sink = [ &result ]( char32_t ch ) {
+      if ( QChar::requiresSurrogates( ch ) ) {
+        result.append( QChar( QChar::highSurrogate( ch ) ) );
+        result.append( QChar( QChar::lowSurrogate( ch ) ) );
+      }
+      else {
+        result.append( QChar( char16_t( ch ) ) );
+      }
+    };
+
+    decodeBuiltIn( builtIn, fromData, dataSize, sink );
+
+    return result;
+  }
+
+  std::string utf8;
+  convertWith( iconvStates.get( Utf8, fromEncoding ), fromData, dataSize, utf8 );
+
+  return QString::fromUtf8( utf8.data(), utf8.size() );
 }
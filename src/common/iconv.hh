@@ -35,6 +35,11 @@ public:
 
   QString convert( void const *& inBuf, size_t & inBytesLeft );
 
+  // The static conversions below decode UTF-8, UTF-16LE/BE, UTF-32LE and
+  // Latin-1 on their own, and use iconv states cached per thread for the
+  // rest, so they're cheap to call for every single article or word. Like
+  // convert(), they stop at the first invalid sequence.
+
   // Converts a given block of data from the given encoding to a wide string.
   static gd::wstring toWstring( char const * fromEncoding, void const * fromData, size_t dataSize );
 
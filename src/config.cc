@@ -1070,6 +1070,29 @@ Class load()
         ( preferences.namedItem( "clearNetworkCacheOnExit" ).toElement().text() == "1" );
     }
 
+    if ( !preferences.namedItem( "maxBtreeNodeCacheSize" ).isNull() ) {
+      c.preferences.maxBtreeNodeCacheSize =
+        preferences.namedItem( "maxBtreeNodeCacheSize" ).toElement().text().toInt();
+    }
+
+    if ( !preferences.namedItem( "maxMdictBlockCacheSize" ).isNull() ) {
+      c.preferences.maxMdictBlockCacheSize =
+        preferences.namedItem( "maxMdictBlockCacheSize" ).toElement().text().toInt();
+    }
+
+    if ( !preferences.namedItem( "maxDictzipCacheSize" ).isNull() ) {
+      c.preferences.maxDictzipCacheSize = preferences.namedItem( "maxDictzipCacheSize" ).toElement().text().toInt();
+    }
+
+    if ( !preferences.namedItem( "maxSlobItemCacheSize" ).isNull() ) {
+      c.preferences.maxSlobItemCacheSize = preferences.namedItem( "maxSlobItemCacheSize" ).toElement().text().toInt();
+    }
+
+    if ( !preferences.namedItem( "enableGroupHeadwordIndex" ).isNull() ) {
+      c.preferences.enableGroupHeadwordIndex =
+        ( preferences.namedItem( "enableGroupHeadwordIndex" ).toElement().text() == "1" );
+    }
+
 
     if ( !preferences.namedItem( "removeInvalidIndexOnExit" ).isNull() ) {
       c.preferences.removeInvalidIndexOnExit =
@@ -1170,6 +1193,14 @@ Class load()
       if ( !fts.namedItem( "parallelThreads" ).isNull() ) {
         c.preferences.fts.parallelThreads = fts.namedItem( "parallelThreads" ).toElement().text().toUInt();
       }
+
+      if ( !fts.namedItem( "indexingThreads" ).isNull() ) {
+        c.preferences.fts.indexingThreads = fts.namedItem( "indexingThreads" ).toElement().text().toUInt();
+      }
+
+      if ( !fts.namedItem( "commitInterval" ).isNull() ) {
+        c.preferences.fts.commitInterval = fts.namedItem( "commitInterval" ).toElement().text().toUInt();
+      }
     }
   }
 
@@ -2097,6 +2128,26 @@ void save( Class const & c )
     opt.appendChild( dd.createTextNode( c.preferences.clearNetworkCacheOnExit ? "1" : "0" ) );
     preferences.appendChild( opt );
 
+    opt = dd.createElement( "maxBtreeNodeCacheSize" );
+    opt.appendChild( dd.createTextNode( QString::number( c.preferences.maxBtreeNodeCacheSize ) ) );
+    preferences.appendChild( opt );
+
+    opt = dd.createElement( "maxMdictBlockCacheSize" );
+    opt.appendChild( dd.createTextNode( QString::number( c.preferences.maxMdictBlockCacheSize ) ) );
+    preferences.appendChild( opt );
+
+    opt = dd.createElement( "maxDictzipCacheSize" );
+    opt.appendChild( dd.createTextNode( QString::number( c.preferences.maxDictzipCacheSize ) ) );
+    preferences.appendChild( opt );
+
+    opt = dd.createElement( "maxSlobItemCacheSize" );
+    opt.appendChild( dd.createTextNode( QString::number( c.preferences.maxSlobItemCacheSize ) ) );
+    preferences.appendChild( opt );
+
+    opt = dd.createElement( "enableGroupHeadwordIndex" );
+    opt.appendChild( dd.createTextNode( c.preferences.enableGroupHeadwordIndex ? "1" : "0" ) );
+    preferences.appendChild( opt );
+
     opt = dd.createElement( "removeInvalidIndexOnExit" );
     opt.appendChild( dd.createTextNode( c.preferences.removeInvalidIndexOnExit ? "1" : "0" ) );
     preferences.appendChild( opt );
@@ -2176,6 +2227,14 @@ void save( Class const & c )
       opt = dd.createElement( "parallelThreads" );
       opt.appendChild( dd.createTextNode( QString::number( c.preferences.fts.parallelThreads ) ) );
       hd.appendChild( opt );
+
+      opt = dd.createElement( "indexingThreads" );
+      opt.appendChild( dd.createTextNode( QString::number( c.preferences.fts.indexingThreads ) ) );
+      hd.appendChild( opt );
+
+      opt = dd.createElement( "commitInterval" );
+      opt.appendChild( dd.createTextNode( QString::number( c.preferences.fts.commitInterval ) ) );
+      hd.appendChild( opt );
     }
   }
 
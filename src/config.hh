@@ -198,6 +198,11 @@ struct FullTextSearch
 
   quint32 maxDictionarySize;
   quint32 parallelThreads = QThread::idealThreadCount() / 3 + 1;
+  /// The number of threads extracting the articles of a single dictionary
+  quint32 indexingThreads = QThread::idealThreadCount() / 3 + 1;
+  /// The number of documents added to the index between commits. Zero leaves
+  /// it to Xapian.
+  quint32 commitInterval = 10000;
   QByteArray dialogGeometry;
   QString disabledTypes;
 
@@ -383,6 +388,19 @@ struct Preferences
   bool clearNetworkCacheOnExit;
   bool removeInvalidIndexOnExit = false;
 
+  /// Memory limit for the decompressed btree nodes shared by all dictionaries, in MiB
+  int maxBtreeNodeCacheSize = 32;
+  /// Memory limit for the decompressed MDict record blocks, in MiB
+  int maxMdictBlockCacheSize = 32;
+  /// Memory limit for the decompressed dictzip chunks of all the .dz files, in MiB
+  int maxDictzipCacheSize = 32;
+  /// Memory limit for the decompressed items kept for each .slob file, in MiB
+  int maxSlobItemCacheSize = 16;
+
+  /// Merge the headwords of each group's dictionaries into a single index, so
+  /// the word search takes a single lookup for all of them
+  bool enableGroupHeadwordIndex = false;
+
   qreal zoomFactor;
   qreal helpZoomFactor;
   int wordsZoomLevel;
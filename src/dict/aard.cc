@@ -11,6 +11,7 @@
 #include "gddebug.hh"
 #include "ftshelpers.hh"
 #include "htmlescape.hh"
+#include "htmlrewriter.hh"
 
 #include <map>
 #include <set>
@@ -26,7 +27,6 @@
 #include <QAtomicInt>
 #include <QDomDocument>
 #include <QtEndian>
-#include <QRegularExpression>
 #include "ufile.hh"
 #include "wstring_qt.hh"
 #include "utils.hh"
@@ -338,6 +338,50 @@ void AardDictionary::loadIcon() noexcept
   dictionaryIconLoaded = true;
 }
 
+namespace {
+
+/// Turns the article links into bword: ones, or into lookups if they have an
+/// anchor, and closes the self-closing divs
+class AardLinkRewriter: public Html::Rewriter
+{
+protected:
+
+  void handleTag( Tag & tag ) override;
+};
+
+void AardLinkRewriter::handleTag( Tag & tag )
+{
+  if ( tag.is( "a" ) ) {
+    Attribute * href = tag.find( "href" );
+
+    if ( !href || href->value.empty() || href->value[ 0 ] == '#' || Html::hasSchemeSlashes( href->value ) ) {
+      return;
+    }
+
+    std::string_view word = href->value;
+
+    if ( word.substr( 0, 2 ) == "w:" || word.substr( 0, 2 ) == "s:" ) {
+      word.remove_prefix( 2 );
+    }
+
+    size_t const anchor = word.find( '#' );
+
+    if ( anchor != std::string_view::npos && anchor > 0 && anchor + 1 < word.size() ) {
+      href->set( "gdlookup://localhost/" + string( word.substr( 0, anchor ) ) + "?gdanchor="
+                 + string( word.substr( anchor + 1 ) ) );
+    }
+    else {
+      href->set( "bword:" + string( word ) );
+    }
+  }
+  else if ( tag.is( "div" ) && tag.selfClosing ) {
+    tag.selfClosing = false;
+    tag.after       = "</div>";
+  }
+}
+
+} // namespace
+
 string AardDictionary::convert( const string & in )
 {
   string inConverted;
@@ -369,28 +413,13 @@ string AardDictionary::convert( const string & in )
     inConverted.push_back( inCh );
   }
 
-  QString text = QString::fromUtf8( inConverted.c_str() );
-
-  text.replace( QRegularExpression( R"(<\s*a\s+href\s*=\s*\"(w:|s:){0,1}([^#](?!ttp://)[^\"]*)(.))",
-                                    QRegularExpression::DotMatchesEverythingOption ),
-                R"(<a href="bword:\2")" );
-  text.replace( QRegularExpression( R"(<\s*a\s+href\s*=\s*'(w:|s:){0,1}([^#](?!ttp://)[^']*)(.))",
-                                    QRegularExpression::DotMatchesEverythingOption ),
-                R"(<a href="bword:\2")" );
-
-  // Anchors
-  text.replace( QRegularExpression( R"(<a\s+href="bword:([^#"]+)#([^"]+))" ),
-                R"(<a href="gdlookup://localhost/\1?gdanchor=\2)" );
-
-  static QRegularExpression self_closing_divs( "(<div\\s+[^>]*)/>",
-                                               QRegularExpression::CaseInsensitiveOption ); // <div ... />
-  text.replace( self_closing_divs, "\\1></div>" );
-
+  string text;
+  AardLinkRewriter().rewrite( inConverted, text );
 
   // Fix outstanding elements
   text += "<br style=\"clear:both;\" />";
 
-  return text.toUtf8().data();
+  return text;
 }
 
 void AardDictionary::loadArticle( quint32 address, string & articleText, bool rawText )
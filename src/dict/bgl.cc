@@ -295,11 +295,11 @@ void BglDictionary::loadIcon() noexcept
 
       // Try loading icon now
 
-      vector< char > chunk;
+      ChunkedStorage::Reader::Chunk chunk;
 
       QMutexLocker _( &idxMutex );
 
-      char * iconData = chunks.getBlock( idxHeader.iconAddress, chunk );
+      char const * iconData = chunks.getBlock( idxHeader.iconAddress, chunk );
 
       QImage img;
 
@@ -334,11 +334,11 @@ void BglDictionary::loadIcon() noexcept
 
 void BglDictionary::loadArticle( uint32_t offset, string & headword, string & displayedHeadword, string & articleText )
 {
-  vector< char > chunk;
+  ChunkedStorage::Reader::Chunk chunk;
 
   QMutexLocker _( &idxMutex );
 
-  char * articleData = chunks.getBlock( offset, chunk );
+  char const * articleData = chunks.getBlock( offset, chunk );
 
   headword = articleData;
 
@@ -358,8 +358,8 @@ QString const & BglDictionary::getDescription()
   }
   else {
     QMutexLocker _( &idxMutex );
-    vector< char > chunk;
-    char * dictDescription = chunks.getBlock( idxHeader.descriptionAddress, chunk );
+    ChunkedStorage::Reader::Chunk chunk;
+    char const * dictDescription = chunks.getBlock( idxHeader.descriptionAddress, chunk );
     string str( dictDescription );
     if ( !str.empty() ) {
       dictionaryDescription += QObject::tr( "Copyright: %1%2" )
@@ -798,13 +798,5 @@ void Babylon::convertToUtf8( std::string & s, unsigned int type )
     return;
   }
 
-  Iconv conv_( charset.c_str() );
-
-  size_t inbufbytes = s.size();
-
-  char * inbuf      = (char *)s.data();
-  const void * test = inbuf;
-
-  const QString convStr = conv_.convert( test, inbufbytes );
-  s                     = convStr.toStdString();
+  s = Iconv::toUtf8( charset.c_str(), s.data(), s.size() );
 }
@@ -10,6 +10,7 @@
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#include <set>
 #include "gddebug.hh"
 #include "wstring_qt.hh"
 #include "utils.hh"
@@ -18,6 +19,7 @@
 #include "wildcard.hh"
 #include "globalbroadcaster.hh"
 
+#include <QDir>
 #include <QtConcurrent>
 #include <zlib.h>
 
@@ -34,7 +36,10 @@ enum {
 
 BtreeIndex::BtreeIndex():
   idxFile( nullptr ),
-  rootNodeLoaded( false )
+  indexId( 0 ),
+  idxFileMap( nullptr ),
+  idxFileMapSize( 0 ),
+  rootNodeLoaded( 0 )
 {
 }
 
@@ -57,8 +62,19 @@ void BtreeIndex::openIndex( IndexInfo const & indexInfo, File::Index & file, QMu
 
   idxFile      = &file;
   idxFileMutex = &mutex;
+  indexId      = NodeCache::instance().newIndexId();
 
-  rootNodeLoaded = false;
+  // The mapping stays valid until the file is closed. Several indices may
+  // share one file, each one gets its own mapping then.
+  idxFileMapSize = file.file().size();
+  idxFileMap     = file.map( 0, idxFileMapSize );
+
+  if ( !idxFileMap ) {
+    gdWarning( "Failed to map the index file %s, falling back to locked reads\n",
+               file.file().fileName().toUtf8().data() );
+  }
+
+  rootNodeLoaded = 0;
   rootNode.clear();
 }
 
@@ -77,7 +93,7 @@ BtreeIndex::findArticles( wstring const & search_word, bool ignoreDiacritics, ui
 
     bool exactMatch;
 
-    vector< char > leaf;
+    sptr< NodeCache::Node const > leaf;
     uint32_t nextLeaf;
 
     char const * leafEnd;
@@ -103,6 +119,85 @@ BtreeIndex::findArticles( wstring const & search_word, bool ignoreDiacritics, ui
 }
 
 
+namespace {
+
+/// Returns the position of the ']' closing the set which the '[' at the given
+/// position of the wildcard pattern opens, or npos if there's none. As in the
+/// conversion to a regexp, a ']' right after the '[' or the "[!" is a member
+/// of the set rather than its end.
+size_t setEnd( wstring const & pattern, size_t open )
+{
+  size_t x = open + 1;
+
+  if ( x < pattern.size() && pattern[ x ] == L'!' ) {
+    ++x;
+  }
+
+  if ( x < pattern.size() && pattern[ x ] == L']' ) {
+    ++x;
+  }
+
+  return pattern.find( L']', x );
+}
+
+/// Returns the folded literal runs of the given wildcard pattern. Each of them
+/// occurs in the folded form of any headword the pattern matches, so the
+/// chains lacking any of them can be skipped without running the regexp.
+vector< wstring > requiredFoldedRuns( wstring const & pattern )
+{
+  vector< wstring > runs;
+  wstring run;
+
+  auto endRun = [ & ]() {
+    wstring folded = Folding::apply( run );
+    if ( !folded.empty() ) {
+      runs.push_back( std::move( folded ) );
+    }
+    run.clear();
+  };
+
+  for ( size_t x = 0; x < pattern.size(); ++x ) {
+    wchar ch = pattern[ x ];
+
+    if ( ch == L'[' ) {
+      // Nothing is known about the chars of a set
+      endRun();
+      x = setEnd( pattern, x );
+      if ( x == wstring::npos ) {
+        break;
+      }
+    }
+    else if ( ch == L'\\' ) {
+      // Whether it escapes the next char or not, neither belongs to a run
+      endRun();
+      ++x;
+    }
+    else if ( ch == L'*' || ch == L'?' || ch == L']' ) {
+      endRun();
+    }
+    else {
+      run.push_back( ch );
+    }
+  }
+
+  endRun();
+
+  return runs;
+}
+
+bool containsAll( wstring const & str, vector< wstring > const & runs )
+{
+  for ( auto const & run : runs ) {
+    if ( str.find( run ) == wstring::npos ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace
+
 BtreeWordSearchRequest::BtreeWordSearchRequest( BtreeDictionary & dict_,
                                                 wstring const & str_,
                                                 unsigned minLength_,
@@ -149,6 +244,8 @@ void BtreeWordSearchRequest::findMatches()
 
   int minMatchLength = 0;
 
+  vector< wstring > requiredRuns;
+
   if ( useWildcards ) {
     regexp.setPattern( wildcardsToRegexp(
       QString::fromStdU32String( Folding::applyDiacriticsOnly( Folding::applySimpleCaseOnly( str ) ) ) ) );
@@ -156,6 +253,9 @@ void BtreeWordSearchRequest::findMatches()
       regexp.setPattern( QRegularExpression::escape( regexp.pattern() ) );
     }
     regexp.setPatternOptions( QRegularExpression::CaseInsensitiveOption );
+    regexp.optimize();
+
+    requiredRuns = requiredFoldedRuns( str );
 
     bool bNoLetters = folded.empty();
     wstring foldedWithWildcards;
@@ -169,27 +269,26 @@ void BtreeWordSearchRequest::findMatches()
 
     // Calculate minimum match length
 
-    bool insideSet = false;
-    bool escaped   = false;
-    for ( char32_t ch : foldedWithWildcards ) {
+    bool escaped = false;
+    for ( size_t x = 0; x < foldedWithWildcards.size(); ++x ) {
+      char32_t ch = foldedWithWildcards[ x ];
+
       if ( ch == L'\\' && !escaped ) {
         escaped = true;
         continue;
       }
 
       if ( ch == L']' && !escaped ) {
-        insideSet = false;
-        continue;
-      }
-
-      if ( insideSet ) {
-        escaped = false;
         continue;
       }
 
       if ( ch == L'[' && !escaped ) {
+        // The whole set stands for a single char
         minMatchLength += 1;
-        insideSet = true;
+        x = setEnd( foldedWithWildcards, x );
+        if ( x == wstring::npos ) {
+          break;
+        }
         continue;
       }
 
@@ -256,7 +355,7 @@ void BtreeWordSearchRequest::findMatches()
   try {
     for ( ;; ) {
       bool exactMatch;
-      vector< char > leaf;
+      sptr< NodeCache::Node const > leaf;
       uint32_t nextLeaf;
       char const * leafEnd;
 
@@ -268,7 +367,7 @@ void BtreeWordSearchRequest::findMatches()
             break;
           }
 
-          //GD_DPRINTF( "offset = %u, size = %u\n", chainOffset - &leaf.front(), leaf.size() );
+          //GD_DPRINTF( "offset = %u, size = %u\n", chainOffset - &leaf->data.front(), leaf->data.size() );
 
           vector< WordArticleLink > chain = dict.readChain( chainOffset );
 
@@ -285,16 +384,33 @@ void BtreeWordSearchRequest::findMatches()
 
             QMutexLocker _( &dataMutex );
 
+            // All the entries but the middle matches fold to the chain's word,
+            // which has to contain every literal part of the pattern
+            bool const mayMatch = !useWildcards || containsAll( resultFolded, requiredRuns );
+
             for ( auto & x : chain ) {
-              if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+              if ( Utils::AtomicInt::loadAcquire( isCancelled ) || !mayMatch ) {
                 break;
               }
+              if ( !acceptsLink( x ) ) {
+                continue;
+              }
               if ( useWildcards ) {
+                // The pattern is matched against the whole headword, which
+                // has a chain of its own, so the middle matches are just its
+                // duplicates
+                if ( !x.prefix.empty() && !Folding::apply( Utf8::decode( x.prefix ) ).empty() ) {
+                  continue;
+                }
+
                 wstring word   = Utf8::decode( x.prefix + x.word );
                 wstring result = Folding::applyDiacriticsOnly( word );
                 if ( result.size() >= (wstring::size_type)minMatchLength ) {
-                  QRegularExpressionMatch match = regexp.match( QString::fromStdU32String( result ) );
-                  if ( match.hasMatch() && match.capturedStart() == 0 ) {
+                  QRegularExpressionMatch match = regexp.match( QString::fromStdU32String( result ),
+                                                                0,
+                                                                QRegularExpression::NormalMatch,
+                                                                QRegularExpression::AnchorAtOffsetMatchOption );
+                  if ( match.hasMatch() ) {
                     addMatch( word );
                   }
                 }
@@ -334,15 +450,13 @@ void BtreeWordSearchRequest::findMatches()
             //GD_DPRINTF( "advancing\n" );
 
             if ( nextLeaf ) {
-              QMutexLocker _( dict.idxFileMutex );
-
-              dict.readNode( nextLeaf, leaf );
-              leafEnd = &leaf.front() + leaf.size();
+              leaf     = dict.readNode( nextLeaf );
+              nextLeaf = leaf->nextLeaf;
+              leafEnd  = &leaf->data.front() + leaf->data.size();
 
-              nextLeaf    = dict.idxFile->read< uint32_t >();
-              chainOffset = &leaf.front() + sizeof( uint32_t );
+              chainOffset = &leaf->data.front() + sizeof( uint32_t );
 
-              uint32_t leafEntries = *(uint32_t *)&leaf.front();
+              uint32_t leafEntries = *(uint32_t *)&leaf->data.front();
 
               if ( leafEntries == 0xffffFFFF ) {
                 //GD_DPRINTF( "bah!\n" );
@@ -417,39 +531,199 @@ sptr< Dictionary::WordSearchRequest > BtreeDictionary::stemmedMatch( wstring con
                                                      maxResults );
 }
 
-void BtreeIndex::readNode( uint32_t offset, vector< char > & out )
+NodeCache::NodeCache():
+  lastIndexId( 0 )
+{
+  setMaxSize( 32 * 1024 * 1024 );
+}
+
+NodeCache & NodeCache::instance()
+{
+  static NodeCache cache;
+  return cache;
+}
+
+NodeCache::Shard & NodeCache::shardFor( Key const & key )
+{
+  return shards[ qHash( key ) % ShardCount ];
+}
+
+quint32 NodeCache::newIndexId()
+{
+  return lastIndexId.fetchAndAddOrdered( 1 ) + 1;
+}
+
+sptr< NodeCache::Node const > NodeCache::get( quint32 indexId, uint32_t offset )
+{
+  Key key       = makeKey( indexId, offset );
+  Shard & shard = shardFor( key );
+
+  QMutexLocker _( &shard.mutex );
+
+  if ( sptr< Node const > * node = shard.nodes.object( key ) ) {
+    ++shard.hits;
+    return *node;
+  }
+
+  ++shard.misses;
+  return {};
+}
+
+void NodeCache::put( quint32 indexId, uint32_t offset, sptr< Node const > const & node )
+{
+  Key key       = makeKey( indexId, offset );
+  Shard & shard = shardFor( key );
+
+  QMutexLocker _( &shard.mutex );
+
+  // QCache takes the ownership and drops the entry right away if it exceeds the budget
+  shard.nodes.insert( key, new sptr< Node const >( node ), node->data.size() );
+}
+
+void NodeCache::setMaxSize( size_t bytes )
+{
+  for ( auto & shard : shards ) {
+    QMutexLocker _( &shard.mutex );
+    shard.nodes.setMaxCost( bytes / ShardCount );
+  }
+}
+
+quint64 NodeCache::getHits()
+{
+  quint64 result = 0;
+
+  for ( auto & shard : shards ) {
+    QMutexLocker _( &shard.mutex );
+    result += shard.hits;
+  }
+
+  return result;
+}
+
+quint64 NodeCache::getMisses()
+{
+  quint64 result = 0;
+
+  for ( auto & shard : shards ) {
+    QMutexLocker _( &shard.mutex );
+    result += shard.misses;
+  }
+
+  return result;
+}
+
+void NodeCache::logStatistics()
+{
+  quint64 hits   = getHits();
+  quint64 misses = getMisses();
+
+  gdDebug( "Btree node cache: %llu hits, %llu misses (%.1f%% hit rate)\n",
+           (unsigned long long)hits,
+           (unsigned long long)misses,
+           hits + misses ? 100.0 * hits / ( hits + misses ) : 0.0 );
+}
+
+void BtreeIndex::readIndexData( qint64 offset, void * buf, size_t size )
+{
+  if ( idxFileMap ) {
+    if ( offset < 0 || offset + (qint64)size > idxFileMapSize ) {
+      throw File::exReadError();
+    }
+
+    memcpy( buf, idxFileMap + offset, size );
+  }
+  else {
+    QMutexLocker _( idxFileMutex );
+
+    idxFile->seek( offset );
+    idxFile->read( buf, size );
+  }
+}
+
+sptr< NodeCache::Node const > BtreeIndex::readNode( uint32_t offset )
 {
-  idxFile->seek( offset );
+  sptr< NodeCache::Node const > node = NodeCache::instance().get( indexId, offset );
+
+  if ( !node ) {
+    auto loaded = std::make_shared< NodeCache::Node >();
 
-  uint32_t uncompressedSize = idxFile->read< uint32_t >();
-  uint32_t compressedSize   = idxFile->read< uint32_t >();
+    uint32_t sizes[ 2 ]; // Uncompressed and compressed sizes
+    readIndexData( offset, sizes, sizeof( sizes ) );
 
-  //GD_DPRINTF( "%x,%x\n", uncompressedSize, compressedSize );
+    uint32_t uncompressedSize = sizes[ 0 ];
+    uint32_t compressedSize   = sizes[ 1 ];
 
-  out.resize( uncompressedSize );
+    //GD_DPRINTF( "%x,%x\n", uncompressedSize, compressedSize );
 
-  vector< unsigned char > compressedData( compressedSize );
+    loaded->data.resize( uncompressedSize );
 
-  idxFile->read( &compressedData.front(), compressedData.size() );
+    qint64 dataOffset = (qint64)offset + sizeof( sizes );
 
-  unsigned long decompressedLength = out.size();
+    // With the file mapped, we inflate right from the mapping
+    vector< unsigned char > compressedBuffer;
+    unsigned char const * compressedData;
 
-  if ( uncompress( (unsigned char *)&out.front(), &decompressedLength, &compressedData.front(), compressedData.size() )
-         != Z_OK
-       || decompressedLength != out.size() ) {
-    throw exFailedToDecompressNode();
+    if ( idxFileMap ) {
+      if ( dataOffset + compressedSize > idxFileMapSize ) {
+        throw File::exReadError();
+      }
+      compressedData = idxFileMap + dataOffset;
+    }
+    else {
+      compressedBuffer.resize( compressedSize );
+      readIndexData( dataOffset, &compressedBuffer.front(), compressedBuffer.size() );
+      compressedData = &compressedBuffer.front();
+    }
+
+    unsigned long decompressedLength = loaded->data.size();
+
+    if ( uncompress( (unsigned char *)&loaded->data.front(), &decompressedLength, compressedData, compressedSize )
+           != Z_OK
+         || decompressedLength != loaded->data.size() ) {
+      throw exFailedToDecompressNode();
+    }
+
+    // Leaves are immediately followed by the link to the next leaf, nodes are not
+    if ( *(uint32_t *)&loaded->data.front() != 0xffffFFFF ) {
+      readIndexData( dataOffset + compressedSize, &loaded->nextLeaf, sizeof( uint32_t ) );
+    }
+    else {
+      loaded->nextLeaf = 0;
+    }
+
+    NodeCache::instance().put( indexId, offset, loaded );
+
+    node = loaded;
   }
+
+  return node;
 }
 
-char const * BtreeIndex::findChainOffsetExactOrPrefix(
-  wstring const & target, bool & exactMatch, vector< char > & extLeaf, uint32_t & nextLeaf, char const *& leafEnd )
+void BtreeIndex::loadRootNode()
+{
+  if ( rootNodeLoaded.loadAcquire() ) {
+    return;
+  }
+
+  QMutexLocker _( &rootNodeMutex );
+
+  if ( !rootNodeLoaded.loadRelaxed() ) {
+    // Time to load our root node. We do it only once, at the first request.
+    rootNode = readNode( rootOffset )->data;
+    rootNodeLoaded.storeRelease( 1 );
+  }
+}
+
+char const * BtreeIndex::findChainOffsetExactOrPrefix( wstring const & target,
+                                                       bool & exactMatch,
+                                                       sptr< NodeCache::Node const > & extLeaf,
+                                                       uint32_t & nextLeaf,
+                                                       char const *& leafEnd )
 {
   if ( !idxFile ) {
     throw exIndexWasNotOpened();
   }
 
-  QMutexLocker _( idxFileMutex );
-
   // Lookup the index by traversing the index btree
 
   // vector< wchar > wcharBuffer;
@@ -460,11 +734,7 @@ char const * BtreeIndex::findChainOffsetExactOrPrefix(
 
   uint32_t currentNodeOffset = rootOffset;
 
-  if ( !rootNodeLoaded ) {
-    // Time to load our root node. We do it only once, at the first request.
-    readNode( rootOffset, rootNode );
-    rootNodeLoaded = true;
-  }
+  loadRootNode();
 
   char const * leaf = &rootNode.front();
   leafEnd           = leaf + rootNode.size();
@@ -477,10 +747,10 @@ char const * BtreeIndex::findChainOffsetExactOrPrefix(
       if ( leafEntries == 0xffffFFFF ) {
         // A node
         currentNodeOffset = *( (uint32_t *)leaf + 1 );
-        readNode( currentNodeOffset, extLeaf );
-        leaf     = &extLeaf.front();
-        leafEnd  = leaf + extLeaf.size();
-        nextLeaf = idxFile->read< uint32_t >();
+        extLeaf  = readNode( currentNodeOffset );
+        nextLeaf = extLeaf->nextLeaf;
+        leaf     = &extLeaf->data.front();
+        leafEnd  = leaf + extLeaf->data.size();
       }
       else {
         // A leaf
@@ -592,18 +862,20 @@ char const * BtreeIndex::findChainOffsetExactOrPrefix(
       }
 
       //GD_DPRINTF( "reading node at %x\n", currentNodeOffset );
-      readNode( currentNodeOffset, extLeaf );
-      leaf    = &extLeaf.front();
-      leafEnd = leaf + extLeaf.size();
+      extLeaf  = readNode( currentNodeOffset );
+      nextLeaf = extLeaf->nextLeaf;
+      leaf     = &extLeaf->data.front();
+      leafEnd  = leaf + extLeaf->data.size();
     }
     else {
       //GD_DPRINTF( "=>a leaf\n" );
       // A leaf
 
       // If this leaf is the root, there's no next leaf, it just can't be.
-      // We do this check because the file's position indicator just won't
-      // be in the right place for root node anyway, since we precache it.
-      nextLeaf = ( currentNodeOffset != rootOffset ? idxFile->read< uint32_t >() : 0 );
+      // Otherwise the link was obtained when the leaf was read.
+      if ( currentNodeOffset == rootOffset ) {
+        nextLeaf = 0;
+      }
 
       if ( !leafEntries ) {
         // Empty leaf? This may only be possible for entirely empty trees only.
@@ -694,13 +966,12 @@ char const * BtreeIndex::findChainOffsetExactOrPrefix(
             // would mean the first element in the next leaf.
             if ( chainToCheck == &chainOffsets.back() ) {
               if ( nextLeaf ) {
-                readNode( nextLeaf, extLeaf );
-
-                leafEnd = &extLeaf.front() + extLeaf.size();
+                extLeaf  = readNode( nextLeaf );
+                nextLeaf = extLeaf->nextLeaf;
 
-                nextLeaf = idxFile->read< uint32_t >();
+                leafEnd = &extLeaf->data.front() + extLeaf->data.size();
 
-                return &extLeaf.front() + sizeof( uint32_t );
+                return &extLeaf->data.front() + sizeof( uint32_t );
               }
               else {
                 return nullptr; // This was the last leaf
@@ -791,10 +1062,271 @@ void BtreeIndex::antialias( wstring const & str, vector< WordArticleLink > & cha
 }
 
 
+namespace {
+
+enum {
+  /// Chains only get that many links with non-empty prefixes, i.e. middle
+  /// matches, so that they don't get overpopulated.
+  MaxMiddleMatchesInChain = 1024
+};
+
+/// The fixed part of each IndexedWords record
+struct RecordHeader
+{
+  uint32_t foldedSize, wordSize, prefixSize, articleOffset;
+};
+
+} // namespace
+
+/// Reads the sorted sequence of the chains added to IndexedWords. The chains
+/// are counted while the spilled runs and the words still in memory are
+/// merged into a single run, which is then read back. Without any spilled
+/// runs, the words in memory are read right away, they're only counted first.
+class IndexedWordsReader
+{
+public:
+
+  explicit IndexedWordsReader( IndexedWords & );
+
+  /// The number of chains in total
+  size_t chainCount() const
+  {
+    return chains;
+  }
+
+  bool atEnd() const
+  {
+    return heap.empty();
+  }
+
+  /// The folded word of the current chain.
+  string const & folded() const
+  {
+    return heap.front()->folded;
+  }
+
+  /// Reads the current chain and advances to the next one.
+  void readChain( vector< WordArticleLink > & );
+
+  /// Advances to the next chain without reading the current one.
+  void skipChain();
+
+private:
+
+  /// A sorted sequence of records, read one at a time.
+  struct Run
+  {
+    size_t index; // The order of the run, the records of earlier runs go first
+    QTemporaryFile * file;
+    size_t nextRecord; // For the run in memory
+
+    string folded;
+    RecordHeader header;
+    vector< char > strings; // The word and the prefix of the current record
+  };
+
+  /// Loads the next record of the run. Returns false if there are no more.
+  bool readRecord( Run & );
+
+  /// Orders the heap so that the smallest record is on top.
+  static bool greater( Run const * a, Run const * b )
+  {
+    int result = a->folded.compare( b->folded );
+
+    return result > 0 || ( result == 0 && a->index > b->index );
+  }
+
+  /// Moves to the next record of the run on top, removing the run from the
+  /// heap once it's exhausted.
+  void advance();
+
+  /// Starts over from the first chain.
+  void rewind();
+
+  /// Goes through all the records in order, counting the chains and copying
+  /// the records to the given file unless it's null.
+  void merge( QTemporaryFile * );
+
+  IndexedWords & indexedWords;
+  vector< Run > runs;
+  vector< Run * > heap;
+  sptr< QTemporaryFile > merged;
+  size_t chains;
+};
+
+IndexedWordsReader::IndexedWordsReader( IndexedWords & indexedWords_ ):
+  indexedWords( indexedWords_ ),
+  runs( indexedWords_.runs.size() + 1 ),
+  chains( 0 )
+{
+  // The records still in memory make the last run
+  indexedWords.sortRecords();
+
+  for ( size_t x = 0; x < runs.size(); ++x ) {
+    runs[ x ].index = x;
+    runs[ x ].file  = x < indexedWords.runs.size() ? indexedWords.runs[ x ].get() : nullptr;
+  }
+
+  if ( indexedWords.runs.empty() ) {
+    merge( nullptr );
+  }
+  else {
+    merged = std::make_shared< QTemporaryFile >( QDir( Config::getIndexDir() ).filePath( "indexedwords-XXXXXX" ) );
+
+    if ( !merged->open() ) {
+      throw exIndexedWordsFileError();
+    }
+
+    merge( merged.get() );
+
+    if ( !merged->flush() ) {
+      throw exIndexedWordsFileError();
+    }
+
+    runs.resize( 1 );
+    runs[ 0 ].file = merged.get();
+  }
+
+  rewind();
+}
+
+void IndexedWordsReader::merge( QTemporaryFile * file )
+{
+  rewind();
+
+  string last;
+
+  while ( !atEnd() ) {
+    Run const & run = *heap.front();
+
+    if ( !chains || run.folded != last ) {
+      ++chains;
+      last = run.folded;
+    }
+
+    if ( file ) {
+      qint64 const foldedSize  = run.folded.size();
+      qint64 const stringsSize = run.strings.size();
+
+      if ( file->write( reinterpret_cast< char const * >( &run.header ), sizeof( run.header ) ) != sizeof( run.header )
+           || file->write( run.folded.data(), foldedSize ) != foldedSize
+           || file->write( run.strings.data(), stringsSize ) != stringsSize ) {
+        throw exIndexedWordsFileError();
+      }
+    }
+
+    advance();
+  }
+}
+
+void IndexedWordsReader::rewind()
+{
+  heap.clear();
+
+  for ( auto & run : runs ) {
+    run.nextRecord = 0;
+
+    if ( run.file && !run.file->seek( 0 ) ) {
+      throw exIndexedWordsFileError();
+    }
+
+    if ( readRecord( run ) ) {
+      heap.push_back( &run );
+    }
+  }
+
+  std::make_heap( heap.begin(), heap.end(), greater );
+}
+
+bool IndexedWordsReader::readRecord( Run & run )
+{
+  size_t stringsSize;
+
+  if ( run.file ) {
+    qint64 result = run.file->read( reinterpret_cast< char * >( &run.header ), sizeof( run.header ) );
+
+    if ( result == 0 ) {
+      return false;
+    }
+
+    if ( result != sizeof( run.header ) ) {
+      throw exIndexedWordsFileError();
+    }
+
+    stringsSize = run.header.wordSize + run.header.prefixSize;
+
+    run.folded.resize( run.header.foldedSize );
+    run.strings.resize( stringsSize );
+
+    if ( run.file->read( &run.folded[ 0 ], run.header.foldedSize ) != run.header.foldedSize
+         || run.file->read( run.strings.data(), stringsSize ) != (qint64)stringsSize ) {
+      throw exIndexedWordsFileError();
+    }
+  }
+  else {
+    if ( run.nextRecord == indexedWords.recordOffsets.size() ) {
+      return false;
+    }
+
+    char const * record = indexedWords.records.data() + indexedWords.recordOffsets[ run.nextRecord++ ];
+
+    memcpy( &run.header, record, sizeof( run.header ) );
+    record += sizeof( run.header );
+
+    stringsSize = run.header.wordSize + run.header.prefixSize;
+
+    run.folded.assign( record, run.header.foldedSize );
+    run.strings.assign( record + run.header.foldedSize, record + run.header.foldedSize + stringsSize );
+  }
+
+  return true;
+}
+
+void IndexedWordsReader::advance()
+{
+  std::pop_heap( heap.begin(), heap.end(), greater );
+
+  if ( readRecord( *heap.back() ) ) {
+    std::push_heap( heap.begin(), heap.end(), greater );
+  }
+  else {
+    heap.pop_back();
+  }
+}
+
+void IndexedWordsReader::readChain( vector< WordArticleLink > & chain )
+{
+  chain.clear();
+
+  string const current = folded();
+
+  do {
+    Run const & run = *heap.front();
+
+    if ( chain.size() < MaxMiddleMatchesInChain || !run.header.prefixSize ) {
+      char const * word = run.strings.data();
+
+      chain.emplace_back( string( word, run.header.wordSize ),
+                          run.header.articleOffset,
+                          string( word + run.header.wordSize, run.header.prefixSize ) );
+    }
+
+    advance();
+  } while ( !atEnd() && folded() == current );
+}
+
+void IndexedWordsReader::skipChain()
+{
+  string const current = folded();
+
+  do {
+    advance();
+  } while ( !atEnd() && folded() == current );
+}
+
 /// A function which recursively creates btree node.
-/// The nextIndex iterator is being iterated over and increased when building
-/// leaf nodes.
-static uint32_t buildBtreeNode( IndexedWords::const_iterator & nextIndex,
+/// The chains are read from nextIndex when building leaf nodes.
+static uint32_t buildBtreeNode( IndexedWordsReader & nextIndex,
                                 size_t indexSize,
                                 File::Index & file,
                                 size_t maxElements,
@@ -808,36 +1340,30 @@ static uint32_t buildBtreeNode( IndexedWords::const_iterator & nextIndex,
   if ( isLeaf ) {
     // A leaf.
 
-    uint32_t totalChainsLength = 0;
+    uncompressedData.resize( sizeof( uint32_t ) );
 
-    auto nextWord = nextIndex;
+    // First uint32_t indicates that this is a leaf.
+    *(uint32_t *)&uncompressedData.front() = indexSize;
 
-    for ( unsigned x = indexSize; x--; ++nextWord ) {
-      totalChainsLength += sizeof( uint32_t );
+    vector< WordArticleLink > chain;
 
-      vector< WordArticleLink > const & chain = nextWord->second;
+    for ( unsigned x = indexSize; x--; ) {
+      nextIndex.readChain( chain );
+
+      uint32_t size = 0;
 
       for ( const auto & y : chain ) {
-        totalChainsLength += y.word.size() + 1 + y.prefix.size() + 1 + sizeof( uint32_t );
+        size += y.word.size() + 1 + y.prefix.size() + 1 + sizeof( uint32_t );
       }
-    }
 
-    uncompressedData.resize( sizeof( uint32_t ) + totalChainsLength );
-
-    // First uint32_t indicates that this is a leaf.
-    *(uint32_t *)&uncompressedData.front() = indexSize;
-
-    unsigned char * ptr = &uncompressedData.front() + sizeof( uint32_t );
-
-    for ( unsigned x = indexSize; x--; ++nextIndex ) {
-      vector< WordArticleLink > const & chain = nextIndex->second;
+      size_t prevSize = uncompressedData.size();
+      uncompressedData.resize( prevSize + sizeof( uint32_t ) + size );
 
-      unsigned char * saveSizeHere = ptr;
+      unsigned char * ptr = &uncompressedData.front() + prevSize;
 
+      memcpy( ptr, &size, sizeof( uint32_t ) );
       ptr += sizeof( uint32_t );
 
-      uint32_t size = 0;
-
       for ( const auto & y : chain ) {
         memcpy( ptr, y.word.c_str(), y.word.size() + 1 );
         ptr += y.word.size() + 1;
@@ -847,11 +1373,7 @@ static uint32_t buildBtreeNode( IndexedWords::const_iterator & nextIndex,
 
         memcpy( ptr, &( y.articleOffset ), sizeof( uint32_t ) );
         ptr += sizeof( uint32_t );
-
-        size += y.word.size() + 1 + y.prefix.size() + 1 + sizeof( uint32_t );
       }
-
-      memcpy( saveSizeHere, &size, sizeof( uint32_t ) );
     }
   }
   else {
@@ -871,12 +1393,12 @@ static uint32_t buildBtreeNode( IndexedWords::const_iterator & nextIndex,
 
       memcpy( &uncompressedData.front() + sizeof( uint32_t ) + x * sizeof( uint32_t ), &offset, sizeof( uint32_t ) );
 
-      size_t sz = nextIndex->first.size() + 1;
+      size_t sz = nextIndex.folded().size() + 1;
 
       size_t prevSize = uncompressedData.size();
       uncompressedData.resize( prevSize + sz );
 
-      memcpy( &uncompressedData.front() + prevSize, nextIndex->first.c_str(), sz );
+      memcpy( &uncompressedData.front() + prevSize, nextIndex.folded().c_str(), sz );
 
       prevEntry = curEntry;
     }
@@ -927,6 +1449,104 @@ static uint32_t buildBtreeNode( IndexedWords::const_iterator & nextIndex,
   return offset;
 }
 
+IndexedWords::IndexedWords() {}
+
+IndexedWords::~IndexedWords() {}
+
+void IndexedWords::clear()
+{
+  vector< char >().swap( records );
+  vector< uint32_t >().swap( recordOffsets );
+  runs.clear();
+}
+
+void IndexedWords::addLink( string const & folded,
+                            string const & word,
+                            string const & prefix,
+                            uint32_t articleOffset )
+{
+  RecordHeader const header = { (uint32_t)folded.size(),
+                                (uint32_t)word.size(),
+                                (uint32_t)prefix.size(),
+                                articleOffset };
+
+  // Records are padded to keep the headers aligned
+  size_t const recordSize = ( sizeof( header ) + folded.size() + word.size() + prefix.size() + 3 ) & ~size_t( 3 );
+
+  if ( !records.empty()
+       && records.size() + recordSize + ( recordOffsets.size() + 1 ) * sizeof( uint32_t ) > MemoryBudget ) {
+    spill();
+  }
+
+  size_t offset = records.size();
+
+  if ( records.capacity() < offset + recordSize ) {
+    // Grow the buffer by the usual factor, but don't overshoot the budget
+    records.reserve( std::max( offset + recordSize, std::min( records.capacity() * 2, (size_t)MemoryBudget ) ) );
+  }
+
+  records.resize( offset + recordSize );
+
+  char * ptr = records.data() + offset;
+
+  memcpy( ptr, &header, sizeof( header ) );
+  ptr += sizeof( header );
+
+  memcpy( ptr, folded.data(), folded.size() );
+  ptr += folded.size();
+
+  memcpy( ptr, word.data(), word.size() );
+  ptr += word.size();
+
+  memcpy( ptr, prefix.data(), prefix.size() );
+
+  recordOffsets.push_back( offset );
+}
+
+void IndexedWords::sortRecords()
+{
+  char const * data = records.data();
+
+  std::stable_sort( recordOffsets.begin(), recordOffsets.end(), [ data ]( uint32_t a, uint32_t b ) {
+    RecordHeader const * x = reinterpret_cast< RecordHeader const * >( data + a );
+    RecordHeader const * y = reinterpret_cast< RecordHeader const * >( data + b );
+
+    int result = memcmp( x + 1, y + 1, std::min( x->foldedSize, y->foldedSize ) );
+
+    return result < 0 || ( result == 0 && x->foldedSize < y->foldedSize );
+  } );
+}
+
+void IndexedWords::spill()
+{
+  auto file = std::make_shared< QTemporaryFile >( QDir( Config::getIndexDir() ).filePath( "indexedwords-XXXXXX" ) );
+
+  if ( !file->open() ) {
+    throw exIndexedWordsFileError();
+  }
+
+  sortRecords();
+
+  for ( auto offset : recordOffsets ) {
+    RecordHeader const * header = reinterpret_cast< RecordHeader const * >( records.data() + offset );
+
+    qint64 recordSize = sizeof( *header ) + header->foldedSize + header->wordSize + header->prefixSize;
+
+    if ( file->write( records.data() + offset, recordSize ) != recordSize ) {
+      throw exIndexedWordsFileError();
+    }
+  }
+
+  if ( !file->flush() ) {
+    throw exIndexedWordsFileError();
+  }
+
+  runs.push_back( file );
+
+  records.clear();
+  recordOffsets.clear();
+}
+
 void IndexedWords::addWord( wstring const & index_word, uint32_t articleOffset, unsigned int maxHeadwordSize )
 {
   wstring word               = gd::removeTrailingZero( index_word );
@@ -964,8 +1584,6 @@ void IndexedWords::addWord( wstring const & index_word, uint32_t articleOffset,
 
   wchar const * nextChar = wordBegin;
 
-  vector< char > utfBuffer( wordSize * 4 );
-
   int wordsAdded = 0; // Number of stored parts
 
   for ( ;; ) {
@@ -976,11 +1594,7 @@ void IndexedWords::addWord( wstring const & index_word, uint32_t articleOffset,
         if ( wordsAdded == 0 ) {
           wstring folded = Folding::applyWhitespaceOnly( wstring( wordBegin, wordSize ) );
           if ( !folded.empty() ) {
-            auto i = insert( { Utf8::encode( folded ), vector< WordArticleLink >() } ).first;
-
-            string utfWord = Utf8::encode( wstring( wordBegin, wordSize ) );
-            string utfPrefix;
-            i->second.emplace_back( utfWord, articleOffset, utfPrefix );
+            addLink( Utf8::encode( folded ), Utf8::encode( wstring( wordBegin, wordSize ) ), string(), articleOffset );
           }
         }
         return;
@@ -991,23 +1605,12 @@ void IndexedWords::addWord( wstring const & index_word, uint32_t articleOffset,
       }
     }
 
-    // Insert this word
-    wstring folded = Folding::apply( nextChar );
-    auto name      = Utf8::encode( folded );
-
-    auto i = insert( { std::move( name ), vector< WordArticleLink >() } ).first;
-
-    if ( ( i->second.size() < 1024 ) || ( nextChar == wordBegin ) ) // Don't overpopulate chains with middle matches
-    {
-      string utfWord   = Utf8::encode( wstring( nextChar, wordSize - ( nextChar - wordBegin ) ) );
-      string utfPrefix = Utf8::encode( wstring( wordBegin, nextChar - wordBegin ) );
-
-      i->second.emplace_back( std::move( utfWord ), articleOffset, std::move( utfPrefix ) );
-      // reduce the vector reallocation.
-      if ( i->second.size() * 1.0 / i->second.capacity() > 0.75 ) {
-        i->second.reserve( i->second.capacity() * 2 );
-      }
-    }
+    // Insert this word. Chains overpopulated with middle matches are trimmed
+    // by the IndexedWordsReader.
+    addLink( Utf8::encode( Folding::apply( nextChar ) ),
+             Utf8::encode( wstring( nextChar, wordSize - ( nextChar - wordBegin ) ) ),
+             Utf8::encode( wstring( wordBegin, nextChar - wordBegin ) ),
+             articleOffset );
 
     wordsAdded += 1;
 
@@ -1031,20 +1634,45 @@ void IndexedWords::addSingleWord( wstring const & index_word, uint32_t articleOf
   if ( folded.empty() ) {
     folded = Folding::applyWhitespaceOnly( word );
   }
-  operator[]( Utf8::encode( folded ) ).emplace_back( Utf8::encode( word ), articleOffset );
+  addLink( Utf8::encode( folded ), Utf8::encode( word ), string(), articleOffset );
 }
 
-IndexInfo buildIndex( IndexedWords const & indexedWords, File::Index & file )
+void IndexedWords::addChain( vector< WordArticleLink > const & chain, uint32_t articleOffset )
 {
-  size_t indexSize = indexedWords.size();
-  auto nextIndex   = indexedWords.begin();
+  if ( chain.empty() ) {
+    return;
+  }
+
+  // All the links of a chain fold to the same word
+  wstring const head = Utf8::decode( chain[ 0 ].word );
+  wstring folded     = Folding::apply( head );
+  if ( folded.empty() ) {
+    folded = Folding::applyWhitespaceOnly( head );
+  }
+
+  string const key = Utf8::encode( folded );
+
+  std::set< pair< string, string > > added;
+
+  for ( auto const & link : chain ) {
+    if ( chain.size() == 1 || added.emplace( link.prefix, link.word ).second ) {
+      addLink( key, link.word, link.prefix, articleOffset );
+    }
+  }
+}
+
+IndexInfo buildIndex( IndexedWords & indexedWords, File::Index & file )
+{
+  IndexedWordsReader nextIndex( indexedWords );
+
+  size_t indexSize = nextIndex.chainCount();
 
   // Skip any empty words. No point in indexing those, and some dictionaries
   // are known to have buggy empty-word entries (Stardict's jargon for instance).
 
-  while ( indexSize && nextIndex->first.empty() ) {
+  while ( indexSize && nextIndex.folded().empty() ) {
     indexSize--;
-    ++nextIndex;
+    nextIndex.skipChain();
   }
 
   // We try to stick to two-level tree for most dictionaries. Try finding
@@ -1093,24 +1721,48 @@ void BtreeIndex::findArticleLinks( QList< WordArticleLink > * articleLinks,
                                    QSet< uint32_t > * offsets,
                                    QSet< QString > * headwords,
                                    QAtomicInt * isCancelled )
+{
+  forEachChain(
+    [ & ]( vector< WordArticleLink > & chain ) {
+      for ( auto & i : chain ) {
+        if ( isCancelled && Utils::AtomicInt::loadAcquire( *isCancelled ) ) {
+          return;
+        }
+
+        if ( headwords ) {
+          headwords->insert( QString::fromUtf8( ( i.prefix + i.word ).c_str() ) );
+        }
+
+        if ( offsets && offsets->contains( i.articleOffset ) ) {
+          continue;
+        }
+
+        if ( offsets ) {
+          offsets->insert( i.articleOffset );
+        }
+
+        if ( articleLinks ) {
+          articleLinks->push_back( WordArticleLink( i.prefix + i.word, i.articleOffset ) );
+        }
+      }
+    },
+    isCancelled );
+}
+
+void BtreeIndex::forEachChain( std::function< void( vector< WordArticleLink > & ) > const & onChain,
+                               QAtomicInt * isCancelled )
 {
   uint32_t currentNodeOffset = rootOffset;
   uint32_t nextLeaf          = 0;
   uint32_t leafEntries;
 
-  QMutexLocker _( idxFileMutex );
-
-  if ( !rootNodeLoaded ) {
-    // Time to load our root node. We do it only once, at the first request.
-    readNode( rootOffset, rootNode );
-    rootNodeLoaded = true;
-  }
+  loadRootNode();
 
   char const * leaf     = &rootNode.front();
   char const * leafEnd  = leaf + rootNode.size();
   char const * chainPtr = nullptr;
 
-  vector< char > extLeaf;
+  sptr< NodeCache::Node const > extLeaf;
 
   // Find first leaf
 
@@ -1124,10 +1776,10 @@ void BtreeIndex::findArticleLinks( QList< WordArticleLink > * articleLinks,
     if ( leafEntries == 0xffffFFFF ) {
       // A node
       currentNodeOffset = *( (uint32_t *)leaf + 1 );
-      readNode( currentNodeOffset, extLeaf );
-      leaf     = &extLeaf.front();
-      leafEnd  = leaf + extLeaf.size();
-      nextLeaf = idxFile->read< uint32_t >();
+      extLeaf  = readNode( currentNodeOffset );
+      nextLeaf = extLeaf->nextLeaf;
+      leaf     = &extLeaf->data.front();
+      leafEnd  = leaf + extLeaf->data.size();
     }
     else {
       // A leaf
@@ -1149,39 +1801,23 @@ void BtreeIndex::findArticleLinks( QList< WordArticleLink > * articleLinks,
   // Read all chains
 
   for ( ;; ) {
-    vector< WordArticleLink > result = readChain( chainPtr );
-
-    for ( auto & i : result ) {
-      if ( isCancelled && Utils::AtomicInt::loadAcquire( *isCancelled ) ) {
-        return;
-      }
-
-      if ( headwords ) {
-        headwords->insert( QString::fromUtf8( ( i.prefix + i.word ).c_str() ) );
-      }
-
-      if ( offsets && offsets->contains( i.articleOffset ) ) {
-        continue;
-      }
+    if ( isCancelled && Utils::AtomicInt::loadAcquire( *isCancelled ) ) {
+      return;
+    }
 
-      if ( offsets ) {
-        offsets->insert( i.articleOffset );
-      }
+    vector< WordArticleLink > chain = readChain( chainPtr );
 
-      if ( articleLinks ) {
-        articleLinks->push_back( WordArticleLink( i.prefix + i.word, i.articleOffset ) );
-      }
-    }
+    onChain( chain );
 
     if ( chainPtr >= leafEnd ) {
       // We're past the current leaf, fetch the next one
 
       if ( nextLeaf ) {
-        readNode( nextLeaf, extLeaf );
-        leaf    = &extLeaf.front();
-        leafEnd = leaf + extLeaf.size();
+        extLeaf  = readNode( nextLeaf );
+        nextLeaf = extLeaf->nextLeaf;
+        leaf     = &extLeaf->data.front();
+        leafEnd  = leaf + extLeaf->data.size();
 
-        nextLeaf = idxFile->read< uint32_t >();
         chainPtr = leaf + sizeof( uint32_t );
 
         leafEntries = *(uint32_t *)leaf;
@@ -1213,18 +1849,16 @@ void BtreeIndex::findSingleNodeHeadwords( uint32_t offsets, QSet< QString > * he
 {
   uint32_t currentNodeOffset = offsets;
 
-  QMutexLocker _( idxFileMutex );
-
   char const * leaf     = nullptr;
   char const * leafEnd  = nullptr;
   char const * chainPtr = nullptr;
 
-  vector< char > extLeaf;
+  sptr< NodeCache::Node const > extLeaf;
 
   // A node
-  readNode( currentNodeOffset, extLeaf );
-  leaf    = &extLeaf.front();
-  leafEnd = leaf + extLeaf.size();
+  extLeaf = readNode( currentNodeOffset );
+  leaf    = &extLeaf->data.front();
+  leafEnd = leaf + extLeaf->data.size();
 
   // A leaf
   chainPtr = leaf + sizeof( uint32_t );
@@ -1247,13 +1881,7 @@ void BtreeIndex::findSingleNodeHeadwords( uint32_t offsets, QSet< QString > * he
 //find the next chain ptr ,which is larger than this currentChainPtr
 QList< uint32_t > BtreeIndex::findNodes()
 {
-  QMutexLocker _( idxFileMutex );
-
-  if ( !rootNodeLoaded ) {
-    // Time to load our root node. We do it only once, at the first request.
-    readNode( rootOffset, rootNode );
-    rootNodeLoaded = true;
-  }
+  loadRootNode();
 
   char const * leaf = &rootNode.front();
   QList< uint32_t > leafOffset;
@@ -1288,19 +1916,13 @@ void BtreeIndex::getHeadwordsFromOffsets( QList< uint32_t > & offsets,
 
   std::sort( offsets.begin(), offsets.end() );
 
-  QMutexLocker _( idxFileMutex );
-
-  if ( !rootNodeLoaded ) {
-    // Time to load our root node. We do it only once, at the first request.
-    readNode( rootOffset, rootNode );
-    rootNodeLoaded = true;
-  }
+  loadRootNode();
 
   char const * leaf     = &rootNode.front();
   char const * leafEnd  = leaf + rootNode.size();
   char const * chainPtr = nullptr;
 
-  vector< char > extLeaf;
+  sptr< NodeCache::Node const > extLeaf;
 
   // Find first leaf
 
@@ -1314,10 +1936,10 @@ void BtreeIndex::getHeadwordsFromOffsets( QList< uint32_t > & offsets,
     if ( leafEntries == 0xffffFFFF ) {
       // A node
       currentNodeOffset = *( (uint32_t *)leaf + 1 );
-      readNode( currentNodeOffset, extLeaf );
-      leaf     = &extLeaf.front();
-      leafEnd  = leaf + extLeaf.size();
-      nextLeaf = idxFile->read< uint32_t >();
+      extLeaf  = readNode( currentNodeOffset );
+      nextLeaf = extLeaf->nextLeaf;
+      leaf     = &extLeaf->data.front();
+      leafEnd  = leaf + extLeaf->data.size();
     }
     else {
       // A leaf
@@ -1377,11 +1999,11 @@ void BtreeIndex::getHeadwordsFromOffsets( QList< uint32_t > & offsets,
       // We're past the current leaf, fetch the next one
 
       if ( nextLeaf ) {
-        readNode( nextLeaf, extLeaf );
-        leaf    = &extLeaf.front();
-        leafEnd = leaf + extLeaf.size();
+        extLeaf  = readNode( nextLeaf );
+        nextLeaf = extLeaf->nextLeaf;
+        leaf     = &extLeaf->data.front();
+        leafEnd  = leaf + extLeaf->data.size();
 
-        nextLeaf = idxFile->read< uint32_t >();
         chainPtr = leaf + sizeof( uint32_t );
 
         leafEntries = *(uint32_t *)leaf;
@@ -1433,4 +2055,43 @@ void BtreeDictionary::findHeadWordsWithLenth( int & index, QSet< QString > * hea
 
 void BtreeDictionary::getArticleText( uint32_t, QString &, QString & ) {}
 
+void BtreeDictionary::sortInStorageOrder( vector< uint32_t > & articleAddresses )
+{
+  std::sort( articleAddresses.begin(), articleAddresses.end() );
+}
+
+ArticleIterator::ArticleIterator( BtreeDictionary & dict_, vector< uint32_t > articleAddresses ):
+  dict( dict_ ),
+  addresses( std::move( articleAddresses ) ),
+  position( 0 )
+{
+  dict.sortInStorageOrder( addresses );
+}
+
+bool ArticleIterator::skipPast( uint32_t articleAddress )
+{
+  auto i = std::find( addresses.begin() + position, addresses.end(), articleAddress );
+
+  if ( i == addresses.end() ) {
+    return false;
+  }
+
+  position = i - addresses.begin() + 1;
+
+  return true;
+}
+
+bool ArticleIterator::next( uint32_t & articleAddress, QString & headword, QString & text )
+{
+  if ( position == addresses.size() ) {
+    return false;
+  }
+
+  articleAddress = addresses[ position++ ];
+
+  dict.getArticleText( articleAddress, headword, text );
+
+  return true;
+}
+
 } // namespace BtreeIndexing
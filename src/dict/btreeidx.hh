@@ -8,15 +8,18 @@
 #include "dictfile.hh"
 
 #include <algorithm>
+#include <functional>
 #include <map>
 #include <stdint.h>
 #include <string>
 #include <vector>
 
+#include <QCache>
 #include <QFuture>
 #include <QList>
+#include <QMutex>
 #include <QSet>
-#include <QList>
+#include <QTemporaryFile>
 
 
 /// A base for the dictionary which creates a btree index to look up
@@ -40,6 +43,7 @@ enum {
 DEF_EX( exIndexWasNotOpened, "The index wasn't opened", Dictionary::Ex )
 DEF_EX( exFailedToDecompressNode, "Failed to decompress a btree's node", Dictionary::Ex )
 DEF_EX( exCorruptedChainData, "Corrupted chain data in the leaf of a btree encountered", Dictionary::Ex )
+DEF_EX( exIndexedWordsFileError, "Failed to use a temporary file while building the index", Dictionary::Ex )
 
 /// This structure describes a word linked to its translation. The
 /// translation is represented as an abstract 32-bit offset.
@@ -70,6 +74,71 @@ struct IndexInfo
   }
 };
 
+/// A process-wide LRU cache of uncompressed btree nodes, shared by all the
+/// indices. The nodes are keyed by the number of the index they belong to
+/// and their offset in it. The total size of the node data kept is limited by a byte
+/// budget; a zero budget disables the cache. The cache is split into shards
+/// with their own locks, so concurrent lookups rarely contend.
+class NodeCache
+{
+public:
+
+  struct Node
+  {
+    vector< char > data;
+    uint32_t nextLeaf; // Link to the next leaf, zero for nodes and the last leaf
+  };
+
+  static NodeCache & instance();
+
+  /// Returns a new number to key the nodes of an index being opened with.
+  /// The number is never reused, so the nodes an index had before it was
+  /// rebuilt and reopened are never mistaken for its current ones. They're
+  /// not looked up anymore and just age out.
+  quint32 newIndexId();
+
+  /// Returns the cached node, or an empty pointer if there's none.
+  sptr< Node const > get( quint32 indexId, uint32_t offset );
+
+  void put( quint32 indexId, uint32_t offset, sptr< Node const > const & );
+
+  void setMaxSize( size_t bytes );
+
+  quint64 getHits();
+  quint64 getMisses();
+
+  /// Logs the hits and misses counted so far.
+  void logStatistics();
+
+private:
+
+  NodeCache();
+
+  enum {
+    ShardCount = 16
+  };
+
+  typedef quint64 Key; // The index id in the high half, the offset in the low one
+
+  static Key makeKey( quint32 indexId, uint32_t offset )
+  {
+    return ( (quint64)indexId << 32 ) | offset;
+  }
+
+  struct Shard
+  {
+    QMutex mutex;
+    QCache< Key, sptr< Node const > > nodes;
+    quint64 hits   = 0;
+    quint64 misses = 0;
+  };
+
+  Shard shards[ ShardCount ];
+  QAtomicInteger< quint32 > lastIndexId;
+
+  Shard & shardFor( Key const & );
+};
+
 /// Base btree indexing class which allows using what buildIndex() function
 /// created. It's quite low-lovel and is basically a set of 'building blocks'
 /// functions.
@@ -81,7 +150,9 @@ public:
 
   /// Opens the index. The file reference is saved to be used for
   /// subsequent lookups.
-  /// The mutex is the one to be locked when working with the file.
+  /// The mutex is the one to be locked when working with the file. The
+  /// whole file is memory-mapped if possible, in which case the lookups
+  /// don't need the mutex at all and can run from many threads at once.
   void openIndex( IndexInfo const &, File::Index &, QMutex & );
 
   /// Finds articles that match the given string. A case-insensitive search
@@ -100,6 +171,10 @@ public:
                          QSet< QString > * headwords,
                          QAtomicInt * isCancelled = 0 );
 
+  /// Calls the given function for each chain of word-article links in the
+  /// index, in the order of their folded words.
+  void forEachChain( std::function< void( vector< WordArticleLink > & ) > const &, QAtomicInt * isCancelled = 0 );
+
   void findHeadWords( QList< uint32_t > offsets, int & index, QSet< QString > * headwords, uint32_t length );
   void findSingleNodeHeadwords( uint32_t offsets, QSet< QString > * headwords );
   QList< uint32_t > findNodes();
@@ -122,12 +197,23 @@ protected:
   /// case, the returned pointer wouldn't belong to 'leaf' at all. To that end,
   /// the leafEnd pointer always holds the pointer to the first byte outside
   /// the node data.
-  char const * findChainOffsetExactOrPrefix(
-    wstring const & target, bool & exactMatch, vector< char > & leaf, uint32_t & nextLeaf, char const *& leafEnd );
+  char const * findChainOffsetExactOrPrefix( wstring const & target,
+                                             bool & exactMatch,
+                                             sptr< NodeCache::Node const > & leaf,
+                                             uint32_t & nextLeaf,
+                                             char const *& leafEnd );
 
   /// Reads a node or leaf at the given offset. Just uncompresses its data
-  /// to the given vector and does nothing more.
-  void readNode( uint32_t offset, vector< char > & out );
+  /// and does nothing more. The nodes read are kept in the shared NodeCache,
+  /// and the one returned is shared with it, so it's never to be changed.
+  sptr< NodeCache::Node const > readNode( uint32_t offset );
+
+  /// Reads the data at the given position of the index file. It doesn't
+  /// depend on the file position and is safe to be called from any thread.
+  void readIndexData( qint64 offset, void * buf, size_t size );
+
+  /// Loads the root node unless it's already loaded.
+  void loadRootNode();
 
   /// Reads the word-article links' chain at the given offset. The pointer
   /// is updated to point to the next chain, if there's any.
@@ -144,9 +230,13 @@ protected:
 
 private:
 
+  quint32 indexId;          // Keys the nodes of the index in the NodeCache
+  uchar const * idxFileMap; // The whole index file mapped, or null if mapping failed
+  qint64 idxFileMapSize;
   uint32_t indexNodeSize;
   uint32_t rootOffset;
-  bool rootNodeLoaded;
+  QMutex rootNodeMutex;
+  QAtomicInt rootNodeLoaded;
   vector< char > rootNode; // We load root note here and keep it at all times,
                            // since all searches always start with it.
 };
@@ -182,6 +272,21 @@ public:
 
   virtual void getArticleText( uint32_t articleAddress, QString & headword, QString & text );
 
+  /// Reorders the given distinct article addresses the way the articles are
+  /// laid out in the dictionary files, so that reading them one after another
+  /// goes through the files in order. See ArticleIterator. The default sorts
+  /// them, which suits the dictionaries addressing their articles in the
+  /// order they were stored in.
+  virtual void sortInStorageOrder( vector< uint32_t > & articleAddresses );
+
+  /// Returns true if prefixMatch() and stemmedMatch() find nothing but the
+  /// words of the btree index, so they can be looked up in a headword index
+  /// merged from several dictionaries instead. True by default.
+  virtual bool matchesOnlyIndexedWords()
+  {
+    return true;
+  }
+
   string const & ftsIndexName() const
   {
     return ftsIdxName;
@@ -212,6 +317,38 @@ protected:
   friend class FTSResultsRequest;
 };
 
+/// Reads the given articles of the dictionary one after another in the order
+/// they're stored in (see BtreeDictionary::sortInStorageOrder()). This way
+/// the compressed chunk holding an article stays cached while the following
+/// articles, which are mostly in the same chunk, are read, so each chunk is
+/// only read and inflated once. It isn't thread-safe.
+class ArticleIterator
+{
+public:
+
+  ArticleIterator( BtreeDictionary & dict, vector< uint32_t > articleAddresses );
+
+  /// Returns the number of the articles left to read
+  size_t remaining() const
+  {
+    return addresses.size() - position;
+  }
+
+  /// Skips all the articles up to the given one, inclusive, so the reading
+  /// resumes after it. Returns false, not moving, if there's no such article.
+  bool skipPast( uint32_t articleAddress );
+
+  /// Reads the next article, as getArticleText() does. Returns false if
+  /// there are none left. If the reading throws, the article is skipped.
+  bool next( uint32_t & articleAddress, QString & headword, QString & text );
+
+private:
+
+  BtreeDictionary & dict;
+  vector< uint32_t > addresses;
+  size_t position;
+};
+
 class BtreeWordSearchRequest: public Dictionary::WordSearchRequest
 {
 protected:
@@ -236,6 +373,13 @@ public:
 
   virtual void findMatches();
 
+  /// Tells whether the word the link leads to is to be reported as a match.
+  /// Accepts every link by default.
+  virtual bool acceptsLink( WordArticleLink const & )
+  {
+    return true;
+  }
+
   void run();
 
   virtual void cancel()
@@ -248,26 +392,74 @@ public:
 
 // Everything below is for building the index data.
 
-/// This represents the index in its source form, as a map which binds folded
-/// words to sequences of their unfolded source forms and the corresponding
-/// article offsets. The words are utf8-encoded -- it doesn't break Unicode
-/// sorting, but conserves space.
-struct IndexedWords: public map< string, vector< WordArticleLink > >
+/// This represents the index in its source form: folded words, each bound to
+/// a sequence of its unfolded source forms and the corresponding article
+/// offsets. The words are utf8-encoded -- it doesn't break Unicode sorting,
+/// but conserves space.
+/// The words are kept in memory only until they take MemoryBudget bytes. Then
+/// they are sorted and moved to a temporary file, and buildIndex() merges all
+/// such files back, so huge dictionaries don't need huge amounts of memory to
+/// be indexed.
+class IndexedWords
 {
-  /// Instead of adding to the map directly, use this function. It does folding
-  /// itself, and for phrases/sentences it adds additional entries beginning with
-  /// each new word.
+public:
+
+  enum {
+    MemoryBudget = 64 * 1024 * 1024
+  };
+
+  IndexedWords();
+  ~IndexedWords();
+
+  IndexedWords( IndexedWords const & )             = delete;
+  IndexedWords & operator=( IndexedWords const & ) = delete;
+
+  /// Use this function to add words. It does folding itself, and for
+  /// phrases/sentences it adds additional entries beginning with each new word.
   void addWord( wstring const & word, uint32_t articleOffset, unsigned int maxHeadwordSize = 256U );
 
   /// Differs from addWord() in that it only adds a single entry. We use this
   /// for zip's file names.
   void addSingleWord( wstring const & word, uint32_t articleOffset );
+
+  /// Adds a chain read from another index as it is, except that its links
+  /// get the given article offset. Repeated words of the chain are added once.
+  void addChain( vector< WordArticleLink > const & chain, uint32_t articleOffset );
+
+  bool empty() const
+  {
+    return recordOffsets.empty() && runs.empty();
+  }
+
+  /// Drops all the words added, releasing the memory and the temporary files.
+  void clear();
+
+private:
+
+  /// Adds a single link to the given folded word.
+  void addLink( string const & folded, string const & word, string const & prefix, uint32_t articleOffset );
+
+  /// Sorts the records kept in memory by their folded words. The records of
+  /// the same word are kept in the order they were added.
+  void sortRecords();
+
+  /// Sorts the records kept in memory and moves them to a new temporary file.
+  void spill();
+
+  // Each record is four uint32_t values -- the sizes of the folded word, the
+  // word and the prefix, and the article offset -- followed by the three
+  // strings themselves. The spilled runs use the same format.
+  vector< char > records;
+  vector< uint32_t > recordOffsets;
+  vector< sptr< QTemporaryFile > > runs; // In the order they were spilled
+
+  friend class IndexedWordsReader;
 };
 
 /// Builds the index, as a compressed btree. Returns IndexInfo.
 /// All the data is stored to the given file, beginning from its current
 /// position.
-IndexInfo buildIndex( IndexedWords const &, File::Index & file );
+IndexInfo buildIndex( IndexedWords &, File::Index & file );
 
 } // namespace BtreeIndexing
 
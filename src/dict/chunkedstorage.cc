@@ -123,7 +123,8 @@ uint32_t Writer::finish()
 }
 
 Reader::Reader( File::Index & f, uint32_t offset ):
-  file( f )
+  file( f ),
+  cache( CachedChunks )
 {
   file.seek( offset );
 
@@ -135,19 +136,54 @@ Reader::Reader( File::Index & f, uint32_t offset ):
   file.read( &offsets.front(), offsets.size() * sizeof( uint32_t ) );
 }
 
-char * Reader::getBlock( uint32_t address, vector< char > & chunk )
+char const * Reader::getBlock( uint32_t address, Chunk & chunk )
 {
-  size_t chunkIdx = address >> 16;
+  uint32_t chunkIdx = address >> 16;
 
   if ( chunkIdx >= offsets.size() ) {
     throw exAddressOutOfRange();
   }
 
-  // Read and decompress the chunk
+  chunk.reset();
+
+  {
+    QMutexLocker _( &cacheMutex );
+
+    if ( Chunk * cached = cache.object( chunkIdx ) ) {
+      chunk = *cached;
+    }
+  }
+
+  if ( !chunk ) {
+    chunk = readChunk( chunkIdx );
+
+    // Another thread might have read the same chunk meanwhile, in which case
+    // this one just replaces it
+    QMutexLocker _( &cacheMutex );
+    cache.insert( chunkIdx, new Chunk( chunk ) );
+  }
+
+  size_t offsetInChunk = address & 0xffFF;
+
+  if ( offsetInChunk > chunk->size() ) { // It can be equal to for 0-sized blocks
+    throw exAddressOutOfRange();
+  }
+
+  return chunk->data() + offsetInChunk;
+}
+
+Reader::Chunk Reader::readChunk( uint32_t chunkIdx )
+{
+  uchar * bytes;
+  uint32_t uncompressedSize;
+  uint32_t compressedSize;
+
+  // Only the mapping is done under the file lock, the decompression runs
+  // straight from the mapped data
   {
-    // file.seek( offsets[ chunkIdx ] );
     QMutexLocker _( &file.lock );
-    auto bytes = file.map( offsets[ chunkIdx ], 8 );
+
+    bytes = file.map( offsets[ chunkIdx ], 8 );
     if ( bytes == nullptr ) {
       throw mapFailed();
     }
@@ -155,40 +191,32 @@ char * Reader::getBlock( uint32_t address, vector< char > & chunk )
     QDataStream in( qBytes );
     in.setByteOrder( QDataStream::LittleEndian );
 
-    uint32_t uncompressedSize;
-    uint32_t compressedSize;
-
     in >> uncompressedSize >> compressedSize;
 
     file.unmap( bytes );
-    chunk.resize( uncompressedSize );
 
-    // vector< unsigned char > compressedData( compressedSize );
-    auto chunkDataBytes = file.map( offsets[ chunkIdx ] + 8, compressedSize );
-    if ( chunkDataBytes == nullptr ) {
+    bytes = file.map( offsets[ chunkIdx ] + 8, compressedSize );
+    if ( bytes == nullptr ) {
       throw mapFailed();
     }
-    // file.read( &compressedData.front(), compressedData.size() );
-    auto autoUnmap = qScopeGuard( [ & ] {
-      file.unmap( chunkDataBytes );
-    } );
-    Q_UNUSED( autoUnmap )
+  }
 
-    unsigned long decompressedLength = chunk.size();
+  auto autoUnmap = qScopeGuard( [ & ] {
+    QMutexLocker _( &file.lock );
+    file.unmap( bytes );
+  } );
+  Q_UNUSED( autoUnmap )
 
-    if ( uncompress( (unsigned char *)&chunk.front(), &decompressedLength, chunkDataBytes, compressedSize ) != Z_OK
-         || decompressedLength != chunk.size() ) {
-      throw exFailedToDecompressChunk();
-    }
-  }
+  sptr< vector< char > > chunk = std::make_shared< vector< char > >( uncompressedSize );
 
-  size_t offsetInChunk = address & 0xffFF;
+  unsigned long decompressedLength = chunk->size();
 
-  if ( offsetInChunk > chunk.size() ) { // It can be equal to for 0-sized blocks
-    throw exAddressOutOfRange();
+  if ( uncompress( (unsigned char *)chunk->data(), &decompressedLength, bytes, compressedSize ) != Z_OK
+       || decompressedLength != chunk->size() ) {
+    throw exFailedToDecompressChunk();
   }
 
-  return &chunk.front() + offsetInChunk;
+  return chunk;
 }
 
 } // namespace ChunkedStorage
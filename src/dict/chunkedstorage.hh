@@ -6,10 +6,14 @@
 
 #include "ex.hh"
 #include "dictfile.hh"
+#include "sptr.hh"
 
 #include <vector>
 #include <stdint.h>
 
+#include <QCache>
+#include <QMutex>
+
 /// A chunked compression storage. We use this for articles' bodies. The idea
 /// is to store data in a separately-compressed chunks, much like in dictzip,
 /// but without any fancy gzip-compatibility or whatever. Another difference
@@ -68,21 +72,39 @@ private:
   void saveCurrentChunk();
 };
 
-/// This class reads data blocks previously written by Writer.
+/// This class reads data blocks previously written by Writer. The few most
+/// recently used chunks are kept decompressed, since the neighbouring blocks
+/// (e.g. the articles of the adjacent headwords) are usually read together.
 class Reader
 {
-  vector< uint32_t > offsets;
-  File::Index & file;
-
 public:
+  /// A decompressed chunk. It's shared with the reader's cache, so it's
+  /// never modified.
+  typedef sptr< vector< char > const > Chunk;
+
   /// Creates reader by giving it a file to read from and the offset returned
   /// by Writer::finish().
   Reader( File::Index &, uint32_t );
 
   /// Reads the block previously written by Writer, identified by its address.
-  /// Uses the user-provided storage to load the entire chunk, and then to
-  /// return a pointer to the requested block inside it.
-  char * getBlock( uint32_t address, vector< char > & );
+  /// The entire chunk is stored to the given reference, and a pointer to the
+  /// requested block inside it is returned. The pointer stays valid for as
+  /// long as the chunk reference is kept. Safe to be called from any thread.
+  char const * getBlock( uint32_t address, Chunk & );
+
+private:
+
+  enum {
+    CachedChunks = 4
+  };
+
+  vector< uint32_t > offsets;
+  File::Index & file;
+
+  QMutex cacheMutex;
+  QCache< uint32_t, Chunk > cache; // Keyed by chunk index
+
+  Chunk readChunk( uint32_t chunkIdx );
 };
 
 } // namespace ChunkedStorage
@@ -88,7 +88,7 @@ class DictdDictionary: public BtreeIndexing::BtreeDictionary
   File::Index idx, indexFile; // The later is .index file
   IdxHeader idxHeader;
   dictData * dz;
-  QMutex indexFileMutex, dzMutex;
+  QMutex indexFileMutex;
 
 public:
 
@@ -327,11 +327,7 @@ sptr< Dictionary::DataRequest > DictdDictionary::getArticle( wstring const & wor
 
       string articleText;
 
-      char * articleBody;
-      {
-        QMutexLocker _( &dzMutex );
-        articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
-      }
+      char * articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
 
       if ( !articleBody ) {
         articleText = string( "<div class=\"dictd_article\">DICTZIP error: " ) + dict_error_str( dz ) + "</div>";
@@ -524,11 +520,7 @@ void DictdDictionary::getArticleText( uint32_t articleAddress, QString & headwor
 
     string articleText;
 
-    char * articleBody;
-    {
-      QMutexLocker _( &dzMutex );
-      articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
-    }
+    char * articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
 
     if ( !articleBody ) {
       articleText = dict_error_str( dz );
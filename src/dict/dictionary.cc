@@ -62,19 +62,102 @@ QString Request::getErrorString()
 }
 
 
+///////// MatchList
+
+size_t MatchList::blockOf( size_t index, size_t & offset )
+{
+  size_t const n = ( index >> FirstBlockBits ) + 1;
+  size_t block   = 0;
+
+  while ( n >> ( block + 1 ) ) {
+    ++block;
+  }
+
+  // Block b starts with the index 2^FirstBlockBits * (2^b - 1)
+  offset = index - ( ( ( size_t( 1 ) << block ) - 1 ) << FirstBlockBits );
+
+  return block;
+}
+
+WordMatch const & MatchList::operator[]( size_t index ) const
+{
+  size_t offset;
+  size_t const block = blockOf( index, offset );
+
+  return blocks[ block ][ offset ];
+}
+
+vector< MatchList::Span > MatchList::spans( size_t from ) const
+{
+  vector< Span > result;
+
+  size_t const total = size();
+
+  while ( from < total ) {
+    size_t offset;
+    size_t const block     = blockOf( from, offset );
+    size_t const blockSize = size_t( 1 ) << ( FirstBlockBits + block );
+    size_t const count     = std::min( blockSize - offset, total - from );
+
+    result.push_back( Span{ blocks[ block ].get() + offset, count } );
+    from += count;
+  }
+
+  return result;
+}
+
+void MatchList::push_back( WordMatch match )
+{
+  size_t const index = count.loadRelaxed();
+
+  size_t offset;
+  size_t const block = blockOf( index, offset );
+
+  if ( block >= MaxBlocks ) {
+    throw exIndexOutOfRange();
+  }
+
+  if ( !offset ) {
+    blocks[ block ].reset( new WordMatch[ size_t( 1 ) << ( FirstBlockBits + block ) ] );
+  }
+
+  WordMatch & stored = blocks[ block ][ offset ];
+  stored             = std::move( match );
+
+  if ( wordsIndexed ) {
+    words.insert( stored.word );
+  }
+
+  // Only now the readers get to see it
+  count.storeRelease( index + 1 );
+}
+
+void MatchList::addUnique( WordMatch const & match )
+{
+  if ( !wordsIndexed ) {
+    for ( auto const & span : spans() ) {
+      for ( auto const & x : span ) {
+        words.insert( x.word );
+      }
+    }
+
+    wordsIndexed = true;
+  }
+
+  if ( !words.count( match.word ) ) {
+    push_back( match );
+  }
+}
+
 ///////// WordSearchRequest
 
 size_t WordSearchRequest::matchesCount()
 {
-  QMutexLocker _( &dataMutex );
-
   return matches.size();
 }
 
 WordMatch WordSearchRequest::operator[]( size_t index )
 {
-  QMutexLocker _( &dataMutex );
-
   if ( index >= matches.size() ) {
     throw exIndexOutOfRange();
   }
@@ -82,7 +165,12 @@ WordMatch WordSearchRequest::operator[]( size_t index )
   return matches[ index ];
 }
 
-vector< WordMatch > & WordSearchRequest::getAllMatches()
+vector< MatchList::Span > WordSearchRequest::matchesFrom( size_t index )
+{
+  return matches.spans( index );
+}
+
+MatchList const & WordSearchRequest::getAllMatches()
 {
   if ( !isFinished() ) {
     throw exRequestUnfinished();
@@ -93,16 +181,7 @@ vector< WordMatch > & WordSearchRequest::getAllMatches()
 
 void WordSearchRequest::addMatch( WordMatch const & match )
 {
-  unsigned n;
-  for ( n = 0; n < matches.size(); n++ ) {
-    if ( matches[ n ].word.compare( match.word ) == 0 ) {
-      break;
-    }
-  }
-
-  if ( n >= matches.size() ) {
-    matches.push_back( match );
-  }
+  matches.addUnique( match );
 }
 
 ////////////// DataRequest
@@ -139,6 +218,36 @@ void DataRequest::appendString( std::string_view str )
   cond.wakeAll();
 }
 
+void DataRequest::publishDataPart( const void * buffer, size_t size )
+{
+  {
+    QMutexLocker _( &dataMutex );
+
+    hasAnyData = true;
+
+    size_t offset = data.size();
+
+    data.resize( data.size() + size );
+
+    memcpy( &data.front() + offset, buffer, size );
+    cond.wakeAll();
+  }
+
+  update();
+}
+
+void DataRequest::dropPublishedData( QString const & error )
+{
+  {
+    QMutexLocker _( &dataMutex );
+
+    hasAnyData = false;
+    data.clear();
+  }
+
+  setErrorString( error );
+}
+
 void DataRequest::getDataSlice( size_t offset, size_t size, void * buffer )
 {
   if ( size == 0 ) {
@@ -153,6 +262,27 @@ void DataRequest::getDataSlice( size_t offset, size_t size, void * buffer )
   memcpy( buffer, &data[ offset ], size );
 }
 
+size_t DataRequest::readDataSlice( size_t offset, size_t size, void * buffer )
+{
+  QMutexLocker _( &dataMutex );
+
+  if ( !hasAnyData || offset >= data.size() ) {
+    return 0;
+  }
+
+  size = std::min( size, data.size() - offset );
+  memcpy( buffer, &data[ offset ], size );
+
+  return size;
+}
+
+size_t DataRequest::availableDataSize()
+{
+  QMutexLocker _( &dataMutex );
+
+  return hasAnyData ? data.size() : 0;
+}
+
 vector< char > & DataRequest::getFullData()
 {
   if ( !isFinished() ) {
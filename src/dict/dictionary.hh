@@ -5,9 +5,13 @@
 #define __DICTIONARY_HH_INCLUDED__
 
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
+#include <QAtomicInteger>
 #include <QMutex>
 #include <QObject>
 #include <QString>
@@ -151,6 +155,83 @@ struct WordMatch
   }
 };
 
+/// An append-only list of word matches. One thread at a time adds matches to
+/// it, while any number of others read the ones added so far without locking.
+/// That works since the matches never move once added, and each one is only
+/// counted by size() after it's complete.
+class MatchList
+{
+public:
+
+  /// A run of matches stored contiguously
+  struct Span
+  {
+    WordMatch const * first;
+    size_t count;
+
+    WordMatch const * begin() const
+    {
+      return first;
+    }
+
+    WordMatch const * end() const
+    {
+      return first + count;
+    }
+  };
+
+  MatchList() = default;
+
+  Q_DISABLE_COPY_MOVE( MatchList )
+
+  /// The number of matches added so far
+  size_t size() const
+  {
+    return count.loadAcquire();
+  }
+
+  bool empty() const
+  {
+    return !size();
+  }
+
+  /// The index should be less than size()
+  WordMatch const & operator[]( size_t index ) const;
+
+  /// Returns the matches with indices from the given one up to size(), as the
+  /// runs they are stored in
+  vector< Span > spans( size_t from = 0 ) const;
+
+  void push_back( WordMatch match );
+
+  template< typename... Args >
+  void emplace_back( Args &&... args )
+  {
+    push_back( WordMatch( std::forward< Args >( args )... ) );
+  }
+
+  /// Adds the match unless there's one with the same word already
+  void addUnique( WordMatch const & );
+
+private:
+
+  enum {
+    FirstBlockBits = 6,
+    MaxBlocks      = 32
+  };
+
+  /// Block n holds 2^(FirstBlockBits + n) matches, so the blocks only get
+  /// allocated and never reallocated
+  static size_t blockOf( size_t index, size_t & offset );
+
+  std::unique_ptr< WordMatch[] > blocks[ MaxBlocks ];
+  QAtomicInteger< size_t > count;
+
+  /// The words added, used by addUnique(). It's only made on its first use.
+  std::unordered_set< std::u32string_view > words;
+  bool wordsIndexed = false;
+};
+
 /// This request type corresponds to all types of word searching operations.
 class WordSearchRequest: public Request
 {
@@ -171,9 +252,14 @@ public:
   /// than matchesCount().
   WordMatch operator[]( size_t index );
 
-  /// Returns all the matches found. Since no further locking can or would be
-  /// done, this can only be called after the request has finished.
-  vector< WordMatch > & getAllMatches();
+  /// Returns the matches found so far, starting with the given index. No
+  /// locking is done, and the spans stay valid as long as the request exists,
+  /// so this is the way to go through lots of matches.
+  vector< MatchList::Span > matchesFrom( size_t index = 0 );
+
+  /// Returns all the matches found. This can only be called after the request
+  /// has finished.
+  MatchList const & getAllMatches();
 
   /// Returns true if the match was uncertain -- that is, there may be more
   /// results in the dictionary itself, the dictionary index isn't good enough
@@ -188,11 +274,12 @@ public:
 
 protected:
 
-  // Subclasses should be filling up the 'matches' array, locking the mutex when
-  // whey work with it.
+  // Subclasses should be filling up the 'matches' list, locking the mutex when
+  // they add to it, so that there's only one writer at a time. The readers
+  // don't lock it.
   QMutex dataMutex;
 
-  vector< WordMatch > matches;
+  MatchList matches;
   bool uncertain;
 };
 
@@ -218,6 +305,15 @@ public:
   /// buffer. "size + offset" must be <= than dataSize().
   void getDataSlice( size_t offset, size_t size, void * buffer );
 
+  /// Copies up to "size" bytes starting from "offset" of the data read so far
+  /// to the given buffer. Unlike dataSize() and getDataSlice(), this never
+  /// waits for more data, so the data can be streamed while the request is
+  /// still in progress. Returns the number of bytes copied.
+  size_t readDataSlice( size_t offset, size_t size, void * buffer );
+
+  /// Returns the number of bytes read so far, without waiting for more
+  size_t availableDataSize();
+
   /// Returns all the data read. Since no further locking can or would be
   /// done, this can only be called after the request has finished.
   vector< char > & getFullData();
@@ -231,6 +327,21 @@ signals:
   void finishedArticle( QString articleText );
 
 protected:
+  /// The size of the parts in which the resources read a bit at a time are
+  /// published
+  enum {
+    DataPartSize = 64 * 1024
+  };
+
+  /// Appends the given part of the data and makes it available to the readers
+  /// right away, without waiting for the request to finish
+  void publishDataPart( const void * buffer, size_t size );
+
+  /// Drops all the data published so far and sets the given error, so that a
+  /// request which fails after publishing a part of its data fails as a whole
+  /// instead of looking successful with the data cut short
+  void dropPublishedData( QString const & error );
+
   bool hasAnyData; // With this being false, dataSize() always returns -1
   vector< char > data;
 };
@@ -249,7 +360,7 @@ public:
 
   void cancel() override {}
 
-  vector< WordMatch > & getMatches()
+  MatchList & getMatches()
   {
     return matches;
   }
@@ -291,7 +402,10 @@ enum Feature {
   /// No features
   NoFeatures = 0,
   /// The dictionary is suitable to query when searching for compound expressions.
-  SuitableForCompoundSearching = 1
+  SuitableForCompoundSearching = 1,
+  /// The articles don't depend on the alts passed to getArticle(), so there's
+  /// no point in requesting any for the alts.
+  ArticlesIgnoreAlts = 2
 };
 
 Q_DECLARE_FLAGS( Features, Feature )
@@ -311,6 +311,11 @@ public:
     return {};
   }
 
+  Features getFeatures() const noexcept override
+  {
+    return ArticlesIgnoreAlts;
+  }
+
   unsigned long getArticleCount() noexcept override
   {
     return 0;
@@ -149,7 +149,6 @@ class DslDictionary: public BtreeIndexing::BtreeDictionary
   sptr< ChunkedStorage::Reader > chunks;
   string preferredSoundDictionary;
   map< string, string > abrv;
-  QMutex dzMutex;
   dictData * dz;
   QMutex resourceZipMutex;
   IndexedZip resourceZip;
@@ -230,6 +229,8 @@ public:
 
   void getArticleText( uint32_t articleAddress, QString & headword, QString & text ) override;
 
+  void sortInStorageOrder( vector< uint32_t > & articleAddresses ) override;
+
   void makeFTSIndex( QAtomicInt & isCancelled ) override;
 
   void setFTSParameters( Config::FullTextSearch const & fts ) override
@@ -272,10 +273,10 @@ private:
   /// Converts DSL language to an Html.
   string dslToHtml( wstring const &, wstring const & headword = wstring() );
 
-  // Parts of dslToHtml()
-  string nodeToHtml( ArticleDom::Node const & );
-  string processNodeChildren( ArticleDom::Node const & node );
-  string getNodeLink( ArticleDom::Node const & node );
+  // Parts of dslToHtml(). The Html is appended to the result given.
+  void nodeToHtml( ArticleDom const &, ArticleDom::NodeIndex, string & result );
+  void processNodeChildren( ArticleDom const &, ArticleDom::NodeIndex, string & result );
+  string getNodeLink( ArticleDom const &, ArticleDom::NodeIndex );
 
   bool hasHiddenZones() /// Return true if article has hidden zones
   {
@@ -399,9 +400,9 @@ void DslDictionary::doDeferredInit()
       // Read the abrv, if any
 
       if ( idxHeader.hasAbrv ) {
-        vector< char > chunk;
+        ChunkedStorage::Reader::Chunk chunk;
 
-        char * abrvBlock = chunks->getBlock( idxHeader.abrvAddress, chunk );
+        char const * abrvBlock = chunks->getBlock( idxHeader.abrvAddress, chunk );
 
         uint32_t total;
         memcpy( &total, abrvBlock, sizeof( uint32_t ) );
@@ -414,7 +415,7 @@ void DslDictionary::doDeferredInit()
           memcpy( &keySz, abrvBlock, sizeof( uint32_t ) );
           abrvBlock += sizeof( uint32_t );
 
-          char * key = abrvBlock;
+          char const * key = abrvBlock;
 
           abrvBlock += keySz;
 
@@ -501,6 +502,42 @@ bool isDslWs( wchar ch )
   }
 }
 
+/// Appends the article's text escaped for Html, with all the '\r' stripped
+/// and all the '\n' turned into empty paragraphs.
+void appendTextAsHtml( std::u32string_view text, string & result )
+{
+  char buf[ 4 ];
+
+  for ( wchar ch : text ) {
+    switch ( ch ) {
+      case U'\r':
+        break;
+      case U'\n':
+        result += "<p></p>";
+        break;
+      case U'&':
+        result += "&amp;";
+        break;
+      case U'<':
+        result += "&lt;";
+        break;
+      case U'>':
+        result += "&gt;";
+        break;
+      case U'"':
+        result += "&quot;";
+        break;
+      default:
+        if ( ch < 0x80 ) {
+          result.push_back( char( ch ) );
+        }
+        else {
+          result.append( buf, Utf8::encode( &ch, 1, buf ) );
+        }
+    }
+  }
+}
+
 void DslDictionary::loadArticle( uint32_t address,
                                  wstring const & requestedHeadwordFolded,
                                  bool ignoreDiacritics,
@@ -512,9 +549,9 @@ void DslDictionary::loadArticle( uint32_t address,
   wstring articleData;
 
   {
-    vector< char > chunk;
+    ChunkedStorage::Reader::Chunk chunk;
 
-    char * articleProps;
+    char const * articleProps;
 
     {
       QMutexLocker _( &idxMutex );
@@ -530,13 +567,7 @@ void DslDictionary::loadArticle( uint32_t address,
     GD_DPRINTF( "offset = %x\n", articleOffset );
 
 
-    char * articleBody;
-
-    {
-      QMutexLocker _( &dzMutex );
-
-      articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
-    }
+    char * articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
 
     if ( !articleBody ) {
       //      throw exCantReadFile( getDictionaryFilenames()[ 0 ] );
@@ -742,27 +773,29 @@ string DslDictionary::dslToHtml( wstring const & str, wstring const & headword )
 
   optionalPartNom = 0;
 
-  string html = processNodeChildren( dom.root );
+  // The whole article is rendered into this single buffer. The Html markup
+  // usually takes more space than the DSL one.
+  string html;
+  html.reserve( normalizedStr.size() * 2 );
+
+  processNodeChildren( dom, ArticleDom::Root, html );
 
   return html;
 }
 
-string DslDictionary::processNodeChildren( ArticleDom::Node const & node )
+void DslDictionary::processNodeChildren( ArticleDom const & dom, ArticleDom::NodeIndex node, string & result )
 {
-  string result;
-
-  for ( const auto & i : node ) {
-    result += nodeToHtml( i );
+  for ( ArticleDom::NodeIndex i = dom.node( node ).firstChild; i != ArticleDom::NoNode; i = dom.node( i ).nextSibling ) {
+    nodeToHtml( dom, i, result );
   }
-
-  return result;
 }
 
-string DslDictionary::getNodeLink( ArticleDom::Node const & node )
+string DslDictionary::getNodeLink( ArticleDom const & dom, ArticleDom::NodeIndex node )
 {
   string link;
-  if ( !node.tagAttrs.empty() ) {
-    QString attrs = QString::fromStdU32String( node.tagAttrs );
+  std::u32string_view const tagAttrs = dom.tagAttrs( node );
+  if ( !tagAttrs.empty() ) {
+    QString attrs = QString::fromUcs4( tagAttrs.data(), tagAttrs.size() );
     int n         = attrs.indexOf( "target=\"" );
     if ( n >= 0 ) {
       int n_end      = attrs.indexOf( '\"', n + 8 );
@@ -771,83 +804,93 @@ string DslDictionary::getNodeLink( ArticleDom::Node const & node )
     }
   }
   if ( link.empty() ) {
-    link = Html::escape( Filetype::simplifyString( Utf8::encode( node.renderAsText() ), false ) );
+    link = Html::escape( Filetype::simplifyString( Utf8::encode( dom.renderAsText( node ) ), false ) );
   }
 
   return link;
 }
 
-string DslDictionary::nodeToHtml( ArticleDom::Node const & node )
+void DslDictionary::nodeToHtml( ArticleDom const & dom, ArticleDom::NodeIndex node, string & result )
 {
-  string result;
-
-  if ( !node.isTag ) {
-    result = Html::escape( Utf8::encode( node.text ) );
-
-    // Handle all end-of-line
-
-    string::size_type n;
-
-    // Strip all '\r'
-    while ( ( n = result.find( '\r' ) ) != string::npos ) {
-      result.erase( n, 1 );
-    }
-
-    // Replace all '\n'
-    while ( ( n = result.find( '\n' ) ) != string::npos ) {
-      result.replace( n, 1, "<p></p>" );
-    }
-
-    return result;
+  if ( !dom.node( node ).isTag ) {
+    appendTextAsHtml( dom.text( node ), result );
+    return;
   }
 
-  if ( node.tagName == U"b" ) {
-    result += "<b class=\"dsl_b\">" + processNodeChildren( node ) + "</b>";
+  std::u32string_view const tagName  = dom.tagName( node );
+  std::u32string_view const tagAttrs = dom.tagAttrs( node );
+
+  if ( tagName == U"b" ) {
+    result += "<b class=\"dsl_b\">";
+    processNodeChildren( dom, node, result );
+    result += "</b>";
   }
-  else if ( node.tagName == U"i" ) {
-    result += "<i class=\"dsl_i\">" + processNodeChildren( node ) + "</i>";
+  else if ( tagName == U"i" ) {
+    result += "<i class=\"dsl_i\">";
+    processNodeChildren( dom, node, result );
+    result += "</i>";
   }
-  else if ( node.tagName == U"u" ) {
-    string nodeText = processNodeChildren( node );
+  else if ( tagName == U"u" ) {
+    size_t const start = result.size();
+
+    result += "<span class=\"dsl_u\">";
 
-    if ( nodeText.size() && isDslWs( nodeText[ 0 ] ) ) {
-      result.push_back( ' ' ); // Fix a common problem where in "foo[i] bar[/i]"
+    size_t const textStart = result.size();
+    processNodeChildren( dom, node, result );
+
+    if ( result.size() > textStart && isDslWs( result[ textStart ] ) ) {
+      result.insert( start, 1, ' ' ); // Fix a common problem where in "foo[i] bar[/i]"
     }
     // the space before "bar" gets underlined.
 
-    result += "<span class=\"dsl_u\">" + nodeText + "</span>";
+    result += "</span>";
   }
-  else if ( node.tagName == U"c" ) {
-    if ( node.tagAttrs.empty() ) {
-      result += "<span class=\"c_default_color\">" + processNodeChildren( node ) + "</span>";
+  else if ( tagName == U"c" ) {
+    if ( tagAttrs.empty() ) {
+      result += "<span class=\"c_default_color\">";
+      processNodeChildren( dom, node, result );
+      result += "</span>";
     }
     else {
-      result += "<font color=\"" + Html::escape( Utf8::encode( node.tagAttrs ) ) + "\">" + processNodeChildren( node )
-        + "</font>";
+      result += "<font color=\"" + Html::escape( Utf8::encode( wstring( tagAttrs ) ) ) + "\">";
+      processNodeChildren( dom, node, result );
+      result += "</font>";
     }
   }
-  else if ( node.tagName == U"*" ) {
+  else if ( tagName == U"*" ) {
     string id = "O" + getId().substr( 0, 7 ) + "_" + QString::number( articleNom ).toStdString() + "_opt_"
       + QString::number( optionalPartNom++ ).toStdString();
-    result += R"(<span class="dsl_opt" id=")" + id + "\">" + processNodeChildren( node ) + "</span>";
-  }
-  else if ( node.tagName == U"m" ) {
-    result += "<div class=\"dsl_m\">" + processNodeChildren( node ) + "</div>";
-  }
-  else if ( node.tagName.size() == 2 && node.tagName[ 0 ] == L'm' && iswdigit( node.tagName[ 1 ] ) ) {
-    result += "<div class=\"dsl_" + Utf8::encode( node.tagName ) + "\">" + processNodeChildren( node ) + "</div>";
-  }
-  else if ( node.tagName == U"trn" ) {
-    result += "<span class=\"dsl_trn\">" + processNodeChildren( node ) + "</span>";
-  }
-  else if ( node.tagName == U"ex" ) {
-    result += "<span class=\"dsl_ex\">" + processNodeChildren( node ) + "</span>";
-  }
-  else if ( node.tagName == U"com" ) {
-    result += "<span class=\"dsl_com\">" + processNodeChildren( node ) + "</span>";
-  }
-  else if ( node.tagName == U"s" || node.tagName == U"video" ) {
-    string filename = Filetype::simplifyString( Utf8::encode( node.renderAsText() ), false );
+    result += R"(<span class="dsl_opt" id=")" + id + "\">";
+    processNodeChildren( dom, node, result );
+    result += "</span>";
+  }
+  else if ( tagName == U"m" ) {
+    result += "<div class=\"dsl_m\">";
+    processNodeChildren( dom, node, result );
+    result += "</div>";
+  }
+  else if ( tagName.size() == 2 && tagName[ 0 ] == L'm' && iswdigit( tagName[ 1 ] ) ) {
+    result += "<div class=\"dsl_" + Utf8::encode( wstring( tagName ) ) + "\">";
+    processNodeChildren( dom, node, result );
+    result += "</div>";
+  }
+  else if ( tagName == U"trn" ) {
+    result += "<span class=\"dsl_trn\">";
+    processNodeChildren( dom, node, result );
+    result += "</span>";
+  }
+  else if ( tagName == U"ex" ) {
+    result += "<span class=\"dsl_ex\">";
+    processNodeChildren( dom, node, result );
+    result += "</span>";
+  }
+  else if ( tagName == U"com" ) {
+    result += "<span class=\"dsl_com\">";
+    processNodeChildren( dom, node, result );
+    result += "</span>";
+  }
+  else if ( tagName == U"s" || tagName == U"video" ) {
+    string filename = Filetype::simplifyString( Utf8::encode( dom.renderAsText( node ) ), false );
     string n        = resourceDir1 + filename;
 
     if ( Filetype::isNameOfSound( filename ) ) {
@@ -891,8 +934,9 @@ string DslDictionary::nodeToHtml( ArticleDom::Node const & node )
       url.setPath( Utils::Url::ensureLeadingSlash( QString::fromUtf8( filename.c_str() ) ) );
 
       result += string( R"(<a class="dsl_s dsl_video" href=")" ) + url.toEncoded().data() + "\">"
-        + "<span class=\"img\"></span>" + "<span class=\"filename\">" + processNodeChildren( node ) + "</span>"
-        + "</a>";
+        + "<span class=\"img\"></span>" + "<span class=\"filename\">";
+      processNodeChildren( dom, node, result );
+      result += "</span></a>";
     }
     else {
       // Unknown file type, downgrade to a hyperlink
@@ -902,12 +946,13 @@ string DslDictionary::nodeToHtml( ArticleDom::Node const & node )
       url.setHost( QString::fromUtf8( getId().c_str() ) );
       url.setPath( Utils::Url::ensureLeadingSlash( QString::fromUtf8( filename.c_str() ) ) );
 
-      result +=
-        string( R"(<a class="dsl_s" href=")" ) + url.toEncoded().data() + "\">" + processNodeChildren( node ) + "</a>";
+      result += string( R"(<a class="dsl_s" href=")" ) + url.toEncoded().data() + "\">";
+      processNodeChildren( dom, node, result );
+      result += "</a>";
     }
   }
-  else if ( node.tagName == U"url" ) {
-    string link = getNodeLink( node );
+  else if ( tagName == U"url" ) {
+    string link = getNodeLink( dom, node );
     if ( QUrl::fromEncoded( link.c_str() ).scheme().isEmpty() ) {
       link = "http://" + link;
     }
@@ -925,15 +970,19 @@ string DslDictionary::nodeToHtml( ArticleDom::Node const & node )
       }
     }
 
-    result += R"(<a class="dsl_url" href=")" + link + "\">" + processNodeChildren( node ) + "</a>";
+    result += R"(<a class="dsl_url" href=")" + link + "\">";
+    processNodeChildren( dom, node, result );
+    result += "</a>";
   }
-  else if ( node.tagName == U"!trs" ) {
-    result += "<span class=\"dsl_trs\">" + processNodeChildren( node ) + "</span>";
+  else if ( tagName == U"!trs" ) {
+    result += "<span class=\"dsl_trs\">";
+    processNodeChildren( dom, node, result );
+    result += "</span>";
   }
-  else if ( node.tagName == U"p" ) {
+  else if ( tagName == U"p" ) {
     result += "<span class=\"dsl_p\"";
 
-    string val = Utf8::encode( node.renderAsText() );
+    string val = Utf8::encode( dom.renderAsText( node ) );
 
     // If we have such a key, display a title
 
@@ -945,22 +994,27 @@ string DslDictionary::nodeToHtml( ArticleDom::Node const & node )
       result += " title=\"" + Html::escape( title ) + "\"";
     }
 
-    result += ">" + processNodeChildren( node ) + "</span>";
+    result += ">";
+    processNodeChildren( dom, node, result );
+    result += "</span>";
   }
-  else if ( node.tagName == U"'" ) {
+  else if ( tagName == U"'" ) {
     // There are two ways to display the stress: by adding an accent sign or via font styles.
     // We generate two spans, one with accented data and another one without it, so the
     // user could pick up the best suitable option.
-    string data = processNodeChildren( node );
-    result += R"(<span class="dsl_stress"><span class="dsl_stress_without_accent">)" + data + "</span>"
-      + "<span class=\"dsl_stress_with_accent\">" + data + Utf8::encode( wstring( 1, 0x301 ) ) + "</span></span>";
-  }
-  else if ( node.tagName == U"lang" ) {
+    result += R"(<span class="dsl_stress"><span class="dsl_stress_without_accent">)";
+    size_t const dataStart = result.size();
+    processNodeChildren( dom, node, result );
+    string const data = result.substr( dataStart );
+    result += "</span><span class=\"dsl_stress_with_accent\">" + data + Utf8::encode( wstring( 1, 0x301 ) )
+      + "</span></span>";
+  }
+  else if ( tagName == U"lang" ) {
     result += "<span class=\"dsl_lang\"";
-    if ( !node.tagAttrs.empty() ) {
+    if ( !tagAttrs.empty() ) {
       // Find ISO 639-1 code
       string langcode;
-      QString attr = QString::fromStdU32String( node.tagAttrs );
+      QString attr = QString::fromUcs4( tagAttrs.data(), tagAttrs.size() );
       int n        = attr.indexOf( "id=" );
       if ( n >= 0 ) {
         int id = attr.mid( n + 3 ).toInt();
@@ -982,19 +1036,21 @@ string DslDictionary::nodeToHtml( ArticleDom::Node const & node )
         result += " lang=\"" + langcode + "\"";
       }
     }
-    result += ">" + processNodeChildren( node ) + "</span>";
+    result += ">";
+    processNodeChildren( dom, node, result );
+    result += "</span>";
   }
-  else if ( node.tagName == U"ref" ) {
+  else if ( tagName == U"ref" ) {
     QUrl url;
 
     url.setScheme( "gdlookup" );
     url.setHost( "localhost" );
-    auto nodeStr = Utf8::decode( getNodeLink( node ) );
+    auto nodeStr = Utf8::decode( getNodeLink( dom, node ) );
 
     normalizeHeadword( nodeStr );
     url.setPath( Utils::Url::ensureLeadingSlash( QString::fromStdU32String( nodeStr ) ) );
-    if ( !node.tagAttrs.empty() ) {
-      QString attr = QString::fromStdU32String( node.tagAttrs ).remove( '\"' );
+    if ( !tagAttrs.empty() ) {
+      QString attr = QString::fromUcs4( tagAttrs.data(), tagAttrs.size() ).remove( '\"' );
       int n        = attr.indexOf( '=' );
       if ( n > 0 ) {
         QList< std::pair< QString, QString > > query;
@@ -1003,50 +1059,61 @@ string DslDictionary::nodeToHtml( ArticleDom::Node const & node )
       }
     }
 
-    result +=
-      string( R"(<a class="dsl_ref" href=")" ) + url.toEncoded().data() + "\">" + processNodeChildren( node ) + "</a>";
+    result += string( R"(<a class="dsl_ref" href=")" ) + url.toEncoded().data() + "\">";
+    processNodeChildren( dom, node, result );
+    result += "</a>";
   }
-  else if ( node.tagName == U"@" ) {
+  else if ( tagName == U"@" ) {
     // Special case - insided card header was not parsed
 
     QUrl url;
 
     url.setScheme( "gdlookup" );
     url.setHost( "localhost" );
-    wstring nodeStr = node.renderAsText();
+    wstring nodeStr = dom.renderAsText( node );
     normalizeHeadword( nodeStr );
     url.setPath( Utils::Url::ensureLeadingSlash( QString::fromStdU32String( nodeStr ) ) );
 
-    result +=
-      string( R"(<a class="dsl_ref" href=")" ) + url.toEncoded().data() + "\">" + processNodeChildren( node ) + "</a>";
+    result += string( R"(<a class="dsl_ref" href=")" ) + url.toEncoded().data() + "\">";
+    processNodeChildren( dom, node, result );
+    result += "</a>";
   }
-  else if ( node.tagName == U"sub" ) {
-    result += "<sub>" + processNodeChildren( node ) + "</sub>";
+  else if ( tagName == U"sub" ) {
+    result += "<sub>";
+    processNodeChildren( dom, node, result );
+    result += "</sub>";
   }
-  else if ( node.tagName == U"sup" ) {
-    result += "<sup>" + processNodeChildren( node ) + "</sup>";
+  else if ( tagName == U"sup" ) {
+    result += "<sup>";
+    processNodeChildren( dom, node, result );
+    result += "</sup>";
   }
-  else if ( node.tagName == U"t" ) {
-    result += "<span class=\"dsl_t\">" + processNodeChildren( node ) + "</span>";
+  else if ( tagName == U"t" ) {
+    result += "<span class=\"dsl_t\">";
+    processNodeChildren( dom, node, result );
+    result += "</span>";
   }
-  else if ( node.tagName == U"br" ) {
+  else if ( tagName == U"br" ) {
     result += "<br />";
   }
   else {
+    QByteArray const name  = QString::fromUcs4( tagName.data(), tagName.size() ).toUtf8();
+    QByteArray const attrs = QString::fromUcs4( tagAttrs.data(), tagAttrs.size() ).toUtf8();
+
     gdWarning( R"(DSL: Unknown tag "%s" with attributes "%s" found in "%s", article "%s".)",
-               QString::fromStdU32String( node.tagName ).toUtf8().data(),
-               QString::fromStdU32String( node.tagAttrs ).toUtf8().data(),
+               name.data(),
+               attrs.data(),
                getName().c_str(),
                QString::fromStdU32String( currentHeadword ).toUtf8().data() );
 
-    result += "<span class=\"dsl_unknown\">[" + string( QString::fromStdU32String( node.tagName ).toUtf8().data() );
-    if ( !node.tagAttrs.empty() ) {
-      result += " " + string( QString::fromStdU32String( node.tagAttrs ).toUtf8().data() );
+    result += "<span class=\"dsl_unknown\">[" + string( name.data() );
+    if ( !tagAttrs.empty() ) {
+      result += " " + string( attrs.data() );
     }
-    result += "]" + processNodeChildren( node ) + "</span>";
+    result += "]";
+    processNodeChildren( dom, node, result );
+    result += "</span>";
   }
-
-  return result;
 }
 
 QString const & DslDictionary::getDescription()
@@ -1157,14 +1224,40 @@ void DslDictionary::makeFTSIndex( QAtomicInt & isCancelled )
   }
 }
 
+void DslDictionary::sortInStorageOrder( vector< uint32_t > & articleAddresses )
+{
+  // The articles are read from the .dsl file, which is dictzipped in chunks,
+  // so they're best read by their offsets in it
+  vector< std::pair< uint32_t, uint32_t > > positions;
+  positions.reserve( articleAddresses.size() );
+
+  {
+    QMutexLocker _( &idxMutex );
+
+    ChunkedStorage::Reader::Chunk chunk;
+    uint32_t articleOffset;
+
+    for ( uint32_t address : articleAddresses ) {
+      memcpy( &articleOffset, chunks->getBlock( address, chunk ), sizeof( articleOffset ) );
+      positions.emplace_back( articleOffset, address );
+    }
+  }
+
+  std::sort( positions.begin(), positions.end() );
+
+  for ( size_t x = 0; x < positions.size(); ++x ) {
+    articleAddresses[ x ] = positions[ x ].second;
+  }
+}
+
 void DslDictionary::getArticleText( uint32_t articleAddress, QString & headword, QString & text )
 {
   headword.clear();
   text.clear();
 
-  vector< char > chunk;
+  ChunkedStorage::Reader::Chunk chunk;
 
-  char * articleProps;
+  char const * articleProps;
   wstring articleData;
 
   {
@@ -1177,12 +1270,7 @@ void DslDictionary::getArticleText( uint32_t articleAddress, QString & headword,
   memcpy( &articleOffset, articleProps, sizeof( articleOffset ) );
   memcpy( &articleSize, articleProps + sizeof( articleOffset ), sizeof( articleSize ) );
 
-  char * articleBody;
-
-  {
-    QMutexLocker _( &dzMutex );
-    articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
-  }
+  char * articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
 
   if ( !articleBody ) {
     return;
@@ -1399,7 +1487,7 @@ void DslDictionary::getArticleText( uint32_t articleAddress, QString & headword,
     if ( haveInsidedCards ) {
       // Use base DSL parser for articles with insided cards
       ArticleDom dom( gd::toWString( text ), getName(), articleHeadword );
-      text = QString::fromStdU32String( dom.root.renderAsText( true ) );
+      text = QString::fromStdU32String( dom.renderAsText( ArticleDom::Root, true ) );
     }
     else {
       // Unescape DSL symbols
@@ -1899,7 +1987,7 @@ vector< sptr< Dictionary::Class > > makeDictionaries( vector< string > const & f
                 }
 
                 // If the string has any dsl markup, we strip it
-                string value = Utf8::encode( ArticleDom( curString ).root.renderAsText() );
+                string value = Utf8::encode( ArticleDom( curString ).renderAsText( ArticleDom::Root ) );
 
                 for ( auto & key : keys ) {
                   unescapeDsl( key );
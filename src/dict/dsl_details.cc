@@ -50,56 +50,155 @@ bool isAtSignFirst( wstring const & str )
 
 /////////////// ArticleDom
 
-wstring ArticleDom::Node::renderAsText( bool stripTrsTag ) const
+wstring ArticleDom::renderAsText( NodeIndex n, bool stripTrsTag ) const
 {
-  if ( !isTag ) {
-    return text;
-  }
-
   wstring result;
 
-  for ( const auto & i : *this ) {
-    if ( !stripTrsTag || i.tagName != U"!trs" ) {
-      result += i.renderAsText( stripTrsTag );
+  renderAsText( n, stripTrsTag, result );
+
+  return result;
+}
+
+void ArticleDom::renderAsText( NodeIndex n, bool stripTrsTag, wstring & result ) const
+{
+  if ( !nodes[ n ].isTag ) {
+    result += text( n );
+    return;
+  }
+
+  for ( NodeIndex i = nodes[ n ].firstChild; i != NoNode; i = nodes[ i ].nextSibling ) {
+    if ( !stripTrsTag || !nodes[ i ].isTag || tagName( i ) != U"!trs" ) {
+      renderAsText( i, stripTrsTag, result );
     }
   }
+}
 
-  return result;
+ArticleDom::NodeIndex ArticleDom::addNode( NodeIndex parent, bool isTag, Span name, Span attrs )
+{
+  NodeIndex const n = nodes.size();
+
+  nodes.push_back( Node{ isTag, name, attrs, NoNode, NoNode, nodes[ parent ].lastChild, NoNode } );
+
+  if ( nodes[ parent ].lastChild != NoNode ) {
+    nodes[ nodes[ parent ].lastChild ].nextSibling = n;
+  }
+  else {
+    nodes[ parent ].firstChild = n;
+  }
+
+  nodes[ parent ].lastChild = n;
+
+  return n;
+}
+
+ArticleDom::NodeIndex ArticleDom::addTag( NodeIndex parent, wstring const & name, wstring const & attrs )
+{
+  Span nameSpan{ uint32_t( chars.size() ), uint32_t( name.size() ) };
+  chars += name;
+
+  Span attrsSpan{ uint32_t( chars.size() ), uint32_t( attrs.size() ) };
+  chars += attrs;
+
+  return addNode( parent, true, nameSpan, attrsSpan );
+}
+
+ArticleDom::NodeIndex ArticleDom::addText( NodeIndex parent )
+{
+  return addNode( parent, false, Span{ uint32_t( chars.size() ), 0 }, Span{ 0, 0 } );
+}
+
+void ArticleDom::appendText( NodeIndex textNode, wchar ch )
+{
+  // The text node being filled is always the last one to use the buffer
+  Q_ASSERT( nodes[ textNode ].name.offset + nodes[ textNode ].name.size == chars.size() );
+
+  chars.push_back( ch );
+  ++nodes[ textNode ].name.size;
+}
+
+void ArticleDom::removeLastChild( NodeIndex parent )
+{
+  NodeIndex const n = nodes[ parent ].lastChild;
+
+  Q_ASSERT( n == nodes.size() - 1 );
+
+  nodes[ parent ].lastChild = nodes[ n ].prevSibling;
+
+  if ( nodes[ n ].prevSibling != NoNode ) {
+    nodes[ nodes[ n ].prevSibling ].nextSibling = NoNode;
+  }
+  else {
+    nodes[ parent ].firstChild = NoNode;
+  }
+
+  // The node's characters are left in the buffer, since they might still be
+  // referred to by the tags to be reopened
+  nodes.pop_back();
+}
+
+void ArticleDom::adoptChildren( NodeIndex parent, ArticleDom const & dom )
+{
+  // The other DOM's nodes are appended after ours, except for its root
+  NodeIndex const nodeBase = nodes.size() - 1;
+  uint32_t const charBase  = chars.size();
+
+  auto rebase = [ nodeBase ]( NodeIndex n ) {
+    return n == NoNode ? n : n + nodeBase;
+  };
+
+  chars += dom.chars;
+
+  for ( size_t x = Root + 1; x < dom.nodes.size(); ++x ) {
+    Node node = dom.nodes[ x ];
+
+    node.name.offset += charBase;
+    node.attrs.offset += charBase;
+    node.firstChild  = rebase( node.firstChild );
+    node.lastChild   = rebase( node.lastChild );
+    node.prevSibling = rebase( node.prevSibling );
+    node.nextSibling = rebase( node.nextSibling );
+
+    nodes.push_back( node );
+  }
+
+  NodeIndex const first = rebase( dom.nodes[ Root ].firstChild );
+
+  if ( first == NoNode ) {
+    return;
+  }
+
+  if ( nodes[ parent ].lastChild != NoNode ) {
+    nodes[ nodes[ parent ].lastChild ].nextSibling = first;
+    nodes[ first ].prevSibling                     = nodes[ parent ].lastChild;
+  }
+  else {
+    nodes[ parent ].firstChild = first;
+  }
+
+  nodes[ parent ].lastChild = rebase( dom.nodes[ Root ].lastChild );
 }
 
 namespace {
 
 /// @return true if @p tagName equals "mN" where N is a digit
-bool is_mN( wstring const & tagName )
+bool is_mN( std::u32string_view tagName )
 {
   return tagName.size() == 2 && tagName[ 0 ] == U'm' && iswdigit( tagName[ 1 ] );
 }
 
-bool isAnyM( wstring const & tagName )
+bool isAnyM( std::u32string_view tagName )
 {
   return tagName == U"m" || is_mN( tagName );
 }
 
-bool checkM( wstring const & dest, wstring const & src )
+bool checkM( std::u32string_view dest, std::u32string_view src )
 {
   return src == U"m" && is_mN( dest );
 }
 
-/// Closing the [mN] tags is optional. Quote from https://documentation.help/ABBYY-Lingvo8/paragraph_form.htm:
-/// Any paragraph from this tag until the end of card or until system meets an «[/m]» (margin shift toggle off) tag
-struct MustTagBeClosed
-{
-  bool operator()( ArticleDom::Node const * tag ) const
-  {
-    Q_ASSERT( tag->isTag );
-    return !isAnyM( tag->tagName );
-  }
-};
-
 } // unnamed namespace
 
 ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring const & headword_ ):
-  root( Node::Tag(), wstring(), wstring() ),
   stringPos( str.c_str() ),
   lineStartPos( str.c_str() ),
   transcriptionCount( 0 ),
@@ -107,9 +206,15 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
   dictionaryName( dictName ),
   headword( headword_ )
 {
-  list< Node * > stack; // Currently opened tags
+  // The text of an article is usually close to its source in size
+  chars.reserve( str.size() );
+  nodes.reserve( str.size() / 16 + 1 );
+
+  nodes.push_back( Node{ true, Span{ 0, 0 }, Span{ 0, 0 }, NoNode, NoNode, NoNode, NoNode } );
+
+  vector< NodeIndex > stack; // Currently opened tags
 
-  Node * textNode = 0; // A leaf node which currently accumulates text.
+  NodeIndex textNode = NoNode; // A leaf node which currently accumulates text.
 
   try {
     for ( ;; ) {
@@ -148,48 +253,28 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
             expandOptionalParts( linkTo, &allLinkEntries );
 
             for ( auto entry = allLinkEntries.begin(); entry != allLinkEntries.end(); ) {
-              if ( !textNode ) {
-                Node text = Node( Node::Text(), wstring() );
-
-                if ( stack.empty() ) {
-                  root.push_back( text );
-                  stack.push_back( &root.back() );
-                }
-                else {
-                  stack.back()->push_back( text );
-                  stack.push_back( &stack.back()->back() );
-                }
-
-                textNode = stack.back();
+              if ( textNode == NoNode ) {
+                textNode = addText( stack.empty() ? Root : stack.back() );
+                stack.push_back( textNode );
               }
-              textNode->text.push_back( L'-' );
-              textNode->text.push_back( L' ' );
+              appendText( textNode, L'-' );
+              appendText( textNode, L' ' );
 
               // Close the currently opened text node
               stack.pop_back();
-              textNode = 0;
+              textNode = NoNode;
 
               wstring linkText = Folding::trimWhitespace( *entry );
               ArticleDom nodeDom( linkText, dictName, headword_ );
 
-              Node link( Node::Tag(), U"@", wstring() );
-              for ( auto & n : nodeDom.root ) {
-                link.push_back( n );
-              }
+              NodeIndex const parent = stack.empty() ? Root : stack.back();
+
+              adoptChildren( addTag( parent, U"@", wstring() ), nodeDom );
 
               ++entry;
 
-              if ( stack.empty() ) {
-                root.push_back( link );
-                if ( entry != allLinkEntries.end() ) { // Add line break before next entry
-                  root.push_back( Node( Node::Tag(), U"br", wstring() ) );
-                }
-              }
-              else {
-                stack.back()->push_back( link );
-                if ( entry != allLinkEntries.end() ) {
-                  stack.back()->push_back( Node( Node::Tag(), U"br", wstring() ) );
-                }
+              if ( entry != allLinkEntries.end() ) { // Add line break before next entry
+                addTag( parent, U"br", wstring() );
               }
             }
 
@@ -263,10 +348,10 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
 
         // Add the tag, or close it
 
-        if ( textNode ) {
+        if ( textNode != NoNode ) {
           // Close the currently opened text node
           stack.pop_back();
-          textNode = 0;
+          textNode = NoNode;
         }
 
         // If the tag is [t], we update the transcriptionCount
@@ -364,27 +449,17 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
 
           // Add the corresponding node
 
-          if ( textNode ) {
+          if ( textNode != NoNode ) {
             // Close the currently opened text node
             stack.pop_back();
-            textNode = 0;
+            textNode = NoNode;
           }
 
           linkText = Folding::trimWhitespace( linkText );
           processUnsortedParts( linkText, true );
           ArticleDom nodeDom( linkText, dictName, headword_ );
 
-          Node link( Node::Tag(), U"ref", wstring() );
-          for ( auto & n : nodeDom.root ) {
-            link.push_back( n );
-          }
-
-          if ( stack.empty() ) {
-            root.push_back( link );
-          }
-          else {
-            stack.back()->push_back( link );
-          }
+          adoptChildren( addTag( stack.empty() ? Root : stack.back(), U"ref", wstring() ), nodeDom );
 
           continue;
         }
@@ -427,19 +502,9 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
       // If we're here, we've got a normal symbol, to be saved as text.
 
       // If there's currently no text node, open one
-      if ( !textNode ) {
-        Node text = Node( Node::Text(), wstring() );
-
-        if ( stack.empty() ) {
-          root.push_back( text );
-          stack.push_back( &root.back() );
-        }
-        else {
-          stack.back()->push_back( text );
-          stack.push_back( &stack.back()->back() );
-        }
-
-        textNode = stack.back();
+      if ( textNode == NoNode ) {
+        textNode = addText( stack.empty() ? Root : stack.back() );
+        stack.push_back( textNode );
       }
 
       // If we're inside the transcription, do old-encoding conversion
@@ -552,28 +617,28 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
             ch = 0x153;
             break;
           case 0x405:
-            textNode->text.push_back( 0x153 );
+            appendText( textNode, 0x153 );
             ch = 0x303;
             break;
           case 0x441:
             ch = 0x272;
             break;
           case 0x442:
-            textNode->text.push_back( 0x254 );
+            appendText( textNode, 0x254 );
             ch = 0x303;
             break;
           case 0x443:
             ch = 0xF8;
             break;
           case 0x445:
-            textNode->text.push_back( 0x25B );
+            appendText( textNode, 0x25B );
             ch = 0x303;
             break;
           case 0x446:
             ch = 0xE7;
             break;
           case 0x44C:
-            textNode->text.push_back( 0x251 );
+            appendText( textNode, 0x251 );
             ch = 0x303;
             break;
           case 0x44D:
@@ -586,7 +651,7 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
             ch = 0x3B2;
             break;
           case 0x31:
-            textNode->text.push_back( 0x65 );
+            appendText( textNode, 0x65 );
             ch = 0x303;
             break;
           case 0x32:
@@ -625,11 +690,11 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
             break;
           //case 0x00b1: ch = 0x0261; break;
           case 0x0402:
-            textNode->text.push_back( 0x0069 );
+            appendText( textNode, 0x0069 );
             ch = L':';
             break;
           case 0x0403:
-            textNode->text.push_back( 0x0251 );
+            appendText( textNode, 0x0251 );
             ch = L':';
             break;
           //case 0x040b: ch = 0x03b8; break;
@@ -638,7 +703,7 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
             ch = 0x0061;
             break;
           case 0x0453:
-            textNode->text.push_back( 0x0075 );
+            appendText( textNode, 0x0075 );
             ch = L':';
             break;
           case 0x201a:
@@ -648,7 +713,7 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
             ch = 0x0259;
             break;
           case 0x2039:
-            textNode->text.push_back( 0x0064 );
+            appendText( textNode, 0x0064 );
             ch = 0x0292;
             break;
         }
@@ -658,24 +723,32 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
         ch = 0xA0; // Escaped spaces turn into non-breakable ones in Lingvo
       }
 
-      textNode->text.push_back( ch );
+      appendText( textNode, ch );
     } // for( ; ; )
   }
   catch ( eot & ) {
   }
 
-  if ( textNode ) {
+  if ( textNode != NoNode ) {
     stack.pop_back();
   }
 
   if ( !stack.empty() ) {
-    auto it = std::find_if( stack.begin(), stack.end(), MustTagBeClosed() );
+    /// Closing the [mN] tags is optional. Quote from https://documentation.help/ABBYY-Lingvo8/paragraph_form.htm:
+    /// Any paragraph from this tag until the end of card or until system meets an «[/m]» (margin shift toggle off) tag
+    auto mustTagBeClosed = [ this ]( NodeIndex tag ) {
+      Q_ASSERT( nodes[ tag ].isTag );
+      return !isAnyM( tagName( tag ) );
+    };
+
+    auto it = std::find_if( stack.begin(), stack.end(), mustTagBeClosed );
     if ( it == stack.end() ) {
       return; // no unclosed tags that must be closed => nothing to warn about
     }
-    QByteArray const firstTagName = QString::fromStdU32String( ( *it )->tagName ).toUtf8();
+    std::u32string_view const firstTag = tagName( *it );
+    QByteArray const firstTagName      = QString::fromUcs4( firstTag.data(), firstTag.size() ).toUtf8();
     ++it;
-    unsigned const unclosedTagCount = 1 + std::count_if( it, stack.end(), MustTagBeClosed() );
+    unsigned const unclosedTagCount = 1 + std::count_if( it, stack.end(), mustTagBeClosed );
 
     if ( dictName.empty() ) {
       gdWarning( "Warning: %u tag(s) were unclosed, first tag name \"%s\".\n",
@@ -692,25 +765,23 @@ ArticleDom::ArticleDom( wstring const & str, string const & dictName, wstring co
   }
 }
 
-void ArticleDom::openTag( wstring const & name, wstring const & attrs, list< Node * > & stack )
+void ArticleDom::openTag( wstring const & name, wstring const & attrs, vector< NodeIndex > & stack )
 {
-  list< Node > nodesToReopen;
+  vector< std::pair< Span, Span > > nodesToReopen; // Names and attributes
 
   if ( isAnyM( name ) ) {
     // All tags above [m] tag will be closed and reopened after
     // to avoid break this tag by closing some other tag.
 
     while ( !stack.empty() ) {
-      nodesToReopen.emplace_back( Node::Tag(), stack.back()->tagName, stack.back()->tagAttrs );
+      nodesToReopen.emplace_back( nodes[ stack.back() ].name, nodes[ stack.back() ].attrs );
 
-      if ( stack.back()->empty() ) {
+      if ( nodes[ stack.back() ].firstChild == NoNode ) {
         // Empty nodes are deleted since they're no use
 
         stack.pop_back();
 
-        Node * parent = !stack.empty() ? stack.back() : &root;
-
-        parent->pop_back();
+        removeLastChild( !stack.empty() ? stack.back() : Root );
       }
       else {
         stack.pop_back();
@@ -720,41 +791,26 @@ void ArticleDom::openTag( wstring const & name, wstring const & attrs, list< Nod
 
   // Add tag
 
-  Node node( Node::Tag(), name, attrs );
-
-  if ( stack.empty() ) {
-    root.push_back( node );
-    stack.push_back( &root.back() );
-  }
-  else {
-    stack.back()->push_back( node );
-    stack.push_back( &stack.back()->back() );
-  }
+  stack.push_back( addTag( stack.empty() ? Root : stack.back(), name, attrs ) );
 
   // Reopen tags if needed
 
   while ( !nodesToReopen.empty() ) {
-    if ( stack.empty() ) {
-      root.push_back( nodesToReopen.back() );
-      stack.push_back( &root.back() );
-    }
-    else {
-      stack.back()->push_back( nodesToReopen.back() );
-      stack.push_back( &stack.back()->back() );
-    }
+    stack.push_back(
+      addNode( stack.empty() ? Root : stack.back(), true, nodesToReopen.back().first, nodesToReopen.back().second ) );
 
     nodesToReopen.pop_back();
   }
 }
 
-void ArticleDom::closeTag( wstring const & name, list< Node * > & stack, bool warn )
+void ArticleDom::closeTag( wstring const & name, vector< NodeIndex > & stack, bool warn )
 {
   // Find the tag which is to be closed
 
-  list< Node * >::reverse_iterator n;
+  vector< NodeIndex >::reverse_iterator n;
 
   for ( n = stack.rbegin(); n != stack.rend(); ++n ) {
-    if ( ( *n )->tagName == name || checkM( ( *n )->tagName, name ) ) {
+    if ( tagName( *n ) == name || checkM( tagName( *n ), name ) ) {
       // Found it
       break;
     }
@@ -765,16 +821,14 @@ void ArticleDom::closeTag( wstring const & name, list< Node * > & stack, bool wa
     // then close the tag itself
 
     while ( !stack.empty() ) {
-      bool found = stack.back()->tagName == name || checkM( stack.back()->tagName, name );
+      bool found = tagName( stack.back() ) == name || checkM( tagName( stack.back() ), name );
 
-      if ( stack.back()->empty() && stack.back()->tagName != U"br" ) {
+      if ( nodes[ stack.back() ].firstChild == NoNode && tagName( stack.back() ) != U"br" ) {
         // Empty nodes except [br] tag are deleted since they're no use
 
         stack.pop_back();
 
-        Node * parent = !stack.empty() ? stack.back() : &root;
-
-        parent->pop_back();
+        removeLastChild( !stack.empty() ? stack.back() : Root );
       }
       else {
         stack.pop_back();
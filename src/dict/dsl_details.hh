@@ -5,6 +5,7 @@
 #define __DSL_DETAILS_HH_INCLUDED__
 
 #include <string>
+#include <string_view>
 #include <list>
 #include <vector>
 #include <zlib.h>
@@ -35,52 +36,97 @@ string findCodeForDslId( int id );
 bool isAtSignFirst( wstring const & str );
 
 /// Parses the DSL language, representing it in its structural DOM form.
+/// The whole tree is kept flat: all the nodes are stored in one vector and
+/// refer to each other by their indices, and all their text is stored in one
+/// character buffer, which the nodes refer to by spans. So building even a
+/// large article takes only a few allocations.
 struct ArticleDom
 {
-  struct Node: public list< Node >
+  /// A node is referred to by its index in the 'nodes' vector
+  typedef uint32_t NodeIndex;
+
+  enum : NodeIndex {
+    NoNode = ~NodeIndex( 0 ),
+    Root   = 0 // The root of DOM's tree is always the first node
+  };
+
+  /// A part of the 'chars' buffer
+  struct Span
+  {
+    uint32_t offset, size;
+  };
+
+  struct Node
   {
     bool isTag; // true if it is a tag with subnodes, false if it's a leaf text
                 // data.
-    // Those are only used if isTag is true
-    wstring tagName;
-    wstring tagAttrs;
-    wstring text; // This is only used if isTag is false
-
-    class Text
-    {};
-    class Tag
-    {};
-
-    Node( Tag, wstring const & name, wstring const & attrs ):
-      isTag( true ),
-      tagName( name ),
-      tagAttrs( attrs )
-    {
-    }
-
-    Node( Text, wstring const & text_ ):
-      isTag( false ),
-      text( text_ )
-    {
-    }
-
-    /// Concatenates all childen text nodes recursively to form all text
-    /// the node contains stripped of any markup.
-    wstring renderAsText( bool stripTrsTag = false ) const;
+    Span name;  // Tag's name if isTag is true, the text otherwise
+    Span attrs; // This is only used if isTag is true
+
+    NodeIndex firstChild, lastChild;
+    NodeIndex prevSibling, nextSibling;
   };
 
-  /// Does the parse at construction. Refer to the 'root' member variable
-  /// afterwards.
+  /// Does the parse at construction. Refer to the 'nodes' member variable
+  /// afterwards, starting with the Root.
   explicit ArticleDom( wstring const &, string const & dictName = string(), wstring const & headword_ = wstring() );
 
-  /// Root of DOM's tree
-  Node root;
+  vector< Node > nodes;
+  wstring chars; // Tag names, attributes and texts of all the nodes
+
+  Node const & node( NodeIndex n ) const
+  {
+    return nodes[ n ];
+  }
+
+  std::u32string_view tagName( NodeIndex n ) const
+  {
+    return spanView( nodes[ n ].name );
+  }
+
+  std::u32string_view tagAttrs( NodeIndex n ) const
+  {
+    return spanView( nodes[ n ].attrs );
+  }
+
+  std::u32string_view text( NodeIndex n ) const
+  {
+    return spanView( nodes[ n ].name );
+  }
+
+  /// Concatenates all childen text nodes recursively to form all text
+  /// the node contains stripped of any markup.
+  wstring renderAsText( NodeIndex, bool stripTrsTag = false ) const;
 
 private:
 
-  void openTag( wstring const & name, wstring const & attr, list< Node * > & stack );
+  std::u32string_view spanView( Span const & span ) const
+  {
+    return std::u32string_view( chars.data() + span.offset, span.size );
+  }
+
+  void renderAsText( NodeIndex, bool stripTrsTag, wstring & result ) const;
+
+  /// Adds a node as the last child of the given parent, returns its index
+  NodeIndex addNode( NodeIndex parent, bool isTag, Span name, Span attrs );
+
+  NodeIndex addTag( NodeIndex parent, wstring const & name, wstring const & attrs );
+
+  /// Adds an empty text node, to be filled by appendText()
+  NodeIndex addText( NodeIndex parent );
+
+  void appendText( NodeIndex textNode, wchar ch );
+
+  /// Removes the last child of the given parent. It must be the last node
+  /// added, which is always the case for the empty tags being closed.
+  void removeLastChild( NodeIndex parent );
+
+  /// Copies all the root's children of the given DOM to the given parent.
+  void adoptChildren( NodeIndex parent, ArticleDom const & );
+
+  void openTag( wstring const & name, wstring const & attr, vector< NodeIndex > & stack );
 
-  void closeTag( wstring const & name, list< Node * > & stack, bool warn = true );
+  void closeTag( wstring const & name, vector< NodeIndex > & stack, bool warn = true );
 
   bool atSignFirstInLine();
 
@@ -169,6 +169,12 @@ public:
   sptr< Dictionary::WordSearchRequest >
   stemmedMatch( wstring const &, unsigned minLength, unsigned maxSuffixVariation, unsigned long maxResults ) override;
 
+  // The matches also come from the book itself
+  bool matchesOnlyIndexedWords() override
+  {
+    return false;
+  }
+
 protected:
 
   void loadIcon() noexcept override;
@@ -276,9 +282,9 @@ void EpwingDictionary::loadIcon() noexcept
 void EpwingDictionary::loadArticle(
   quint32 address, string & articleHeadword, string & articleText, int & articlePage, int & articleOffset )
 {
-  vector< char > chunk;
+  ChunkedStorage::Reader::Chunk chunk;
 
-  char * articleProps;
+  char const * articleProps;
 
   {
     QMutexLocker _( &idxMutex );
@@ -450,8 +456,8 @@ void EpwingDictionary::getArticleText( uint32_t articleAddress, QString & headwo
   headword.clear();
   text.clear();
 
-  vector< char > chunk;
-  char * articleProps;
+  ChunkedStorage::Reader::Chunk chunk;
+  char const * articleProps;
 
   {
     QMutexLocker _( &idxMutex );
@@ -355,7 +355,6 @@ class GlsDictionary: public BtreeIndexing::BtreeDictionary
   IdxHeader idxHeader;
   dictData * dz;
   ChunkedStorage::Reader chunks;
-  QMutex dzMutex;
   QMutex resourceZipMutex;
   IndexedZip resourceZip;
 
@@ -592,8 +591,8 @@ void GlsDictionary::makeFTSIndex( QAtomicInt & isCancelled )
 
 void GlsDictionary::loadArticleText( uint32_t address, vector< string > & headwords, string & articleText )
 {
-  vector< char > chunk;
-  char * articleProps;
+  ChunkedStorage::Reader::Chunk chunk;
+  char const * articleProps;
   {
     QMutexLocker _( &idxMutex );
 
@@ -605,13 +604,7 @@ void GlsDictionary::loadArticleText( uint32_t address, vector< string > & headwo
   memcpy( &articleOffset, articleProps, sizeof( articleOffset ) );
   memcpy( &articleSize, articleProps + sizeof( articleOffset ), sizeof( articleSize ) );
 
-  char * articleBody;
-
-  {
-    QMutexLocker _( &dzMutex );
-
-    articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
-  }
+  char * articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
 
   headwords.clear();
   articleText.clear();
@@ -0,0 +1,438 @@
+#include "groupindex.hh"
+#include "btreeidx.hh"
+#include "config.hh"
+#include "folding.hh"
+#include "gddebug.hh"
+#include "utils.hh"
+
+#include <cstring>
+#include <map>
+#include <QFile>
+#include <QtConcurrent>
+
+namespace GroupIndex {
+
+using BtreeIndexing::IndexedWords;
+using BtreeIndexing::IndexInfo;
+using BtreeIndexing::WordArticleLink;
+using std::map;
+
+namespace {
+
+enum {
+  Signature            = 0x58444947, // GIDX on little-endian, XDIG on big-endian
+  CurrentFormatVersion = 1 + BtreeIndexing::FormatVersion + Folding::Version
+};
+
+#pragma pack( push, 1 )
+struct IdxHeader
+{
+  uint32_t signature;             // First comes the signature, GIDX
+  uint32_t formatVersion;         // File format version, is to be CurrentFormatVersion
+  uint32_t dictionaryCount;       // The number of dictionaries merged
+  uint32_t dictionaryIdsOffset;   // Their ids, in the order of their positions, each one preceded by its size
+  uint32_t indexBtreeMaxElements; // Two fields from IndexInfo
+  uint32_t indexRootOffset;
+};
+static_assert( alignof( IdxHeader ) == 1 );
+#pragma pack( pop )
+
+bool indexIsOldOrBad( string const & indexFile )
+{
+  File::Index idx( indexFile, "rb" );
+
+  IdxHeader header;
+
+  return idx.readRecords( &header, sizeof( header ), 1 ) != 1 || header.signature != Signature
+    || header.formatVersion != CurrentFormatVersion;
+}
+
+/// Returns the dictionary as a btree one if its words can be looked up in a
+/// merged index, or nullptr otherwise
+BtreeIndexing::BtreeDictionary * mergeable( sptr< Dictionary::Class > const & dictionary )
+{
+  auto btreeDictionary = dynamic_cast< BtreeIndexing::BtreeDictionary * >( dictionary.get() );
+
+  return btreeDictionary && btreeDictionary->matchesOnlyIndexedWords() ? btreeDictionary : nullptr;
+}
+
+} // namespace
+
+/// The article offset of each link is the position of the dictionary the
+/// word comes from. The index is only good for word searches.
+class Index: public BtreeIndexing::BtreeDictionary
+{
+  QMutex idxMutex;
+  File::Index idx;
+  IdxHeader idxHeader;
+  map< string, uint32_t > positions; // Of the dictionaries, by their ids
+
+public:
+
+  Index( string const & id, string const & indexFile );
+
+  /// Returns the position of the dictionary with the given id, or -1 if it
+  /// isn't merged
+  int find( string const & dictionaryId ) const
+  {
+    auto i = positions.find( dictionaryId );
+    return i == positions.end() ? -1 : (int)i->second;
+  }
+
+  uint32_t dictionaryCount() const
+  {
+    return idxHeader.dictionaryCount;
+  }
+
+  string getName() noexcept override
+  {
+    return "Group index";
+  }
+
+  map< Dictionary::Property, string > getProperties() noexcept override
+  {
+    return map< Dictionary::Property, string >();
+  }
+
+  unsigned long getArticleCount() noexcept override
+  {
+    return 0;
+  }
+
+  unsigned long getWordCount() noexcept override
+  {
+    return 0;
+  }
+
+  sptr< Dictionary::DataRequest >
+  getArticle( wstring const &, vector< wstring > const &, wstring const &, bool ) override
+  {
+    return std::make_shared< Dictionary::DataRequestInstant >( false );
+  }
+};
+
+Index::Index( string const & id, string const & indexFile ):
+  BtreeDictionary( id, vector< string >( 1, indexFile ) ),
+  idx( indexFile, "rb" ),
+  idxHeader( idx.read< IdxHeader >() )
+{
+  idx.seek( idxHeader.dictionaryIdsOffset );
+
+  for ( uint32_t x = 0; x < idxHeader.dictionaryCount; ++x ) {
+    string dictionaryId( idx.read< uint32_t >(), '\0' );
+    idx.read( &dictionaryId[ 0 ], dictionaryId.size() );
+    positions[ dictionaryId ] = x;
+  }
+
+  openIndex( IndexInfo( idxHeader.indexBtreeMaxElements, idxHeader.indexRootOffset ), idx, idxMutex );
+}
+
+namespace {
+
+class GroupWordSearchRequest: public BtreeIndexing::BtreeWordSearchRequest
+{
+  sptr< Index > index; // Kept for the search to use
+  vector< bool > found;
+
+public:
+
+  GroupWordSearchRequest( Lookup const & lookup,
+                          wstring const & str_,
+                          unsigned minLength_,
+                          int maxSuffixVariation_,
+                          bool allowMiddleMatches_,
+                          unsigned long maxResults_ ):
+    BtreeWordSearchRequest(
+      *lookup.index, str_, minLength_, maxSuffixVariation_, allowMiddleMatches_, maxResults_, false ),
+    index( lookup.index ),
+    found( lookup.found )
+  {
+    f = QtConcurrent::run( [ this ]() {
+      this->run();
+    } );
+  }
+
+  ~GroupWordSearchRequest()
+  {
+    // The search has to end before the index may go away
+    isCancelled.ref();
+    f.waitForFinished();
+  }
+
+  bool acceptsLink( WordArticleLink const & link ) override
+  {
+    return link.articleOffset < found.size() && found[ link.articleOffset ];
+  }
+};
+
+} // namespace
+
+sptr< Dictionary::WordSearchRequest >
+prefixMatch( Lookup const & lookup, wstring const & str, unsigned long maxResults )
+{
+  return std::make_shared< GroupWordSearchRequest >( lookup, str, 0, -1, true, maxResults );
+}
+
+sptr< Dictionary::WordSearchRequest > stemmedMatch( Lookup const & lookup,
+                                                    wstring const & str,
+                                                    unsigned minLength,
+                                                    unsigned maxSuffixVariation,
+                                                    unsigned long maxResults )
+{
+  return std::make_shared< GroupWordSearchRequest >( lookup,
+                                                     str,
+                                                     minLength,
+                                                     (int)maxSuffixVariation,
+                                                     false,
+                                                     maxResults );
+}
+
+Indices & Indices::instance()
+{
+  static Indices indices;
+  return indices;
+}
+
+void Indices::stopBuilding()
+{
+  cancelled.ref();
+  builder.waitForFinished();
+  cancelled.storeRelease( 0 );
+}
+
+void Indices::clear()
+{
+  stopBuilding();
+
+  QMutexLocker _( &mutex );
+  groupIds.clear();
+  indices.clear();
+}
+
+void Indices::setGroups( vector< vector< sptr< Dictionary::Class > > > const & groups )
+{
+  stopBuilding();
+
+  string const indicesDir = Config::getIndexDir().toStdString();
+
+  vector< string > ids;
+  vector< sptr< Index > > ready;
+  vector< Group > missing;
+
+  for ( auto const & dictionaries : groups ) {
+    Group group;
+    vector< string > dictionaryIds;
+    vector< string > sourceFiles; // The merged index is outdated if any of these is newer
+
+    for ( auto const & dictionary : dictionaries ) {
+      if ( !mergeable( dictionary ) ) {
+        continue;
+      }
+
+      group.dictionaries.push_back( dictionary );
+      dictionaryIds.push_back( dictionary->getId() );
+
+      sourceFiles.push_back( indicesDir + dictionary->getId() );
+      sourceFiles.insert( sourceFiles.end(),
+                          dictionary->getDictionaryFilenames().begin(),
+                          dictionary->getDictionaryFilenames().end() );
+    }
+
+    if ( group.dictionaries.size() < 2 ) {
+      continue; // Nothing to merge
+    }
+
+    dictionaryIds.push_back( "GroupIndex" ); // A mixin
+
+    group.id        = Dictionary::makeDictionaryId( dictionaryIds );
+    group.indexFile = indicesDir + group.id;
+
+    if ( std::find( ids.begin(), ids.end(), group.id ) != ids.end() ) {
+      continue; // Another group has the same dictionaries
+    }
+
+    ids.push_back( group.id );
+
+    if ( Dictionary::needToRebuildIndex( sourceFiles, group.indexFile ) || indexIsOldOrBad( group.indexFile ) ) {
+      missing.push_back( std::move( group ) );
+      continue;
+    }
+
+    auto i = std::find_if( indices.begin(), indices.end(), [ &group ]( sptr< Index > const & index ) {
+      return index->getId() == group.id;
+    } );
+
+    if ( i != indices.end() ) {
+      ready.push_back( *i );
+      continue;
+    }
+
+    try {
+      ready.push_back( std::make_shared< Index >( group.id, group.indexFile ) );
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "Failed to open the group index %s, error: %s\n", group.indexFile.c_str(), e.what() );
+      missing.push_back( std::move( group ) );
+    }
+  }
+
+  {
+    QMutexLocker _( &mutex );
+    groupIds = ids;
+    indices  = ready;
+  }
+
+  if ( !missing.empty() ) {
+    builder = QtConcurrent::run( [ this, missing ]() {
+      build( missing );
+    } );
+  }
+}
+
+void Indices::build( vector< Group > const & groups )
+{
+  for ( auto const & group : groups ) {
+    if ( Utils::AtomicInt::loadAcquire( cancelled ) ) {
+      return;
+    }
+
+    gdDebug( "Building the group index %s of %u dictionaries\n",
+             group.id.c_str(),
+             (unsigned)group.dictionaries.size() );
+
+    // The index is written to a temporary file, so a build which doesn't
+    // complete leaves the previous index as it was
+    QString const tempFile = QString::fromStdString( group.indexFile + ".tmp" );
+
+    try {
+      {
+        File::Index idx( tempFile.toStdString(), "wb" );
+
+        IdxHeader idxHeader;
+
+        memset( &idxHeader, 0, sizeof( idxHeader ) );
+
+        // We write a dummy header first. At the end of the process the header
+        // will be rewritten with the right values.
+
+        idx.write( idxHeader );
+
+        IndexedWords indexedWords;
+        vector< string > merged;
+
+        for ( auto const & dictionary : group.dictionaries ) {
+          BtreeIndexing::BtreeDictionary * btreeDictionary = mergeable( dictionary );
+
+          if ( !btreeDictionary->ensureInitDone().empty() ) {
+            continue; // It will be searched on its own
+          }
+
+          uint32_t const position = merged.size();
+
+          btreeDictionary->forEachChain(
+            [ &indexedWords, position ]( vector< WordArticleLink > & chain ) {
+              indexedWords.addChain( chain, position );
+            },
+            &cancelled );
+
+          if ( Utils::AtomicInt::loadAcquire( cancelled ) ) {
+            break;
+          }
+
+          merged.push_back( dictionary->getId() );
+        }
+
+        if ( Utils::AtomicInt::loadAcquire( cancelled ) ) {
+          idx.close();
+          QFile::remove( tempFile );
+          return;
+        }
+
+        IndexInfo idxInfo = BtreeIndexing::buildIndex( indexedWords, idx );
+
+        idxHeader.dictionaryCount     = merged.size();
+        idxHeader.dictionaryIdsOffset = idx.tell();
+
+        for ( auto const & id : merged ) {
+          idx.write( (uint32_t)id.size() );
+          idx.write( id.data(), id.size() );
+        }
+
+        idxHeader.indexBtreeMaxElements = idxInfo.btreeMaxElements;
+        idxHeader.indexRootOffset       = idxInfo.rootOffset;
+
+        // That concludes it. Update the header.
+
+        idxHeader.signature     = Signature;
+        idxHeader.formatVersion = CurrentFormatVersion;
+
+        idx.rewind();
+
+        idx.write( idxHeader );
+      }
+
+      QString const indexFile = QString::fromStdString( group.indexFile );
+
+      QFile::remove( indexFile );
+
+      if ( !QFile::rename( tempFile, indexFile ) ) {
+        gdWarning( "Failed to replace the group index %s\n", group.indexFile.c_str() );
+        QFile::remove( tempFile );
+        continue;
+      }
+
+      auto index = std::make_shared< Index >( group.id, group.indexFile );
+
+      QMutexLocker _( &mutex );
+      indices.push_back( index );
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "Failed to build the group index %s, error: %s\n", group.indexFile.c_str(), e.what() );
+      QFile::remove( tempFile );
+    }
+  }
+}
+
+Lookup Indices::find( vector< sptr< Dictionary::Class > > const & dictionaries )
+{
+  Lookup lookup;
+
+  QMutexLocker _( &mutex );
+
+  // An index is only worth it for two dictionaries or more
+  size_t mostCovered = 1;
+
+  for ( auto const & index : indices ) {
+    vector< bool > found( index->dictionaryCount() );
+    vector< bool > covered( dictionaries.size() );
+    size_t coveredCount = 0;
+
+    for ( size_t x = 0; x < dictionaries.size(); ++x ) {
+      int const position = index->find( dictionaries[ x ]->getId() );
+
+      if ( position >= 0 && !found[ position ] ) {
+        found[ position ] = true;
+        covered[ x ]      = true;
+        ++coveredCount;
+      }
+    }
+
+    if ( coveredCount > mostCovered ) {
+      mostCovered    = coveredCount;
+      lookup.index   = index;
+      lookup.found   = std::move( found );
+      lookup.covered = std::move( covered );
+    }
+  }
+
+  return lookup;
+}
+
+bool Indices::isIndexFile( string const & fileName )
+{
+  QMutexLocker _( &mutex );
+
+  return std::find( groupIds.begin(), groupIds.end(), fileName ) != groupIds.end();
+}
+
+} // namespace GroupIndex
@@ -0,0 +1,91 @@
+#ifndef __GROUPINDEX_HH_INCLUDED__
+#define __GROUPINDEX_HH_INCLUDED__
+
+#include "dictionary.hh"
+
+#include <QAtomicInt>
+#include <QFuture>
+#include <QMutex>
+
+/// Headword indices merged from the btree indices of all the dictionaries of
+/// a group. With such an index, a prefix or stemmed search in the group takes
+/// a single lookup instead of one for each dictionary.
+namespace GroupIndex {
+
+using std::string;
+using std::vector;
+using gd::wstring;
+
+/// A merged index. Each of its links leads to the dictionary the word comes
+/// from, so a word which is in several dictionaries has a link to each one.
+class Index;
+
+/// What an index can do for a search in the given dictionaries
+struct Lookup
+{
+  sptr< Index > index;    // Null if no index covers at least two of them
+  vector< bool > found;   // For each of the index's dictionaries, whether its words are to be found
+  vector< bool > covered; // For each of the given dictionaries, whether the index covers it
+};
+
+/// Finds the words beginning with the given one, like
+/// Dictionary::Class::prefixMatch() of each of the dictionaries does.
+sptr< Dictionary::WordSearchRequest > prefixMatch( Lookup const &, wstring const &, unsigned long maxResults );
+
+/// Finds the words like Dictionary::Class::stemmedMatch() of each of the
+/// dictionaries does.
+sptr< Dictionary::WordSearchRequest > stemmedMatch(
+  Lookup const &, wstring const &, unsigned minLength, unsigned maxSuffixVariation, unsigned long maxResults );
+
+/// Keeps the indices of the current groups. They are stored next to the
+/// dictionaries' own indices, and the missing or outdated ones are built in
+/// the background, one after another.
+class Indices
+{
+public:
+
+  static Indices & instance();
+
+  /// Makes the indices match the given groups. The indices of the groups which
+  /// are gone are dropped. Only the dictionaries with btree indices which are
+  /// searched by their indices alone are merged.
+  void setGroups( vector< vector< sptr< Dictionary::Class > > > const & groups );
+
+  /// Stops the build in progress, if any, and drops all the indices.
+  void clear();
+
+  /// Picks the ready index covering the most of the given dictionaries.
+  Lookup find( vector< sptr< Dictionary::Class > > const & );
+
+  /// Returns true if the given file name is the one of a current group's index
+  bool isIndexFile( string const & fileName );
+
+private:
+
+  Indices() = default;
+
+  /// Stops the build in progress, if any, and waits for it to finish.
+  void stopBuilding();
+
+  struct Group
+  {
+    string id;
+    string indexFile;
+    vector< sptr< Dictionary::Class > > dictionaries;
+  };
+
+  /// Builds the given groups' indices one after another, making each one
+  /// available as soon as it's done.
+  void build( vector< Group > const & );
+
+  QMutex mutex;
+  vector< string > groupIds;       // Of all the current groups
+  vector< sptr< Index > > indices; // The ones ready to be used
+
+  QFuture< void > builder;
+  QAtomicInt cancelled;
+};
+
+} // namespace GroupIndex
+
+#endif
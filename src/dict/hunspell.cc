@@ -13,6 +13,7 @@
 #include <QRunnable>
 #include <QThreadPool>
 #include <QSemaphore>
+#include <QCache>
 
 #include <QRegularExpression>
 
@@ -39,10 +40,79 @@ using gd::wchar;
 
 namespace {
 
+/// A bounded LRU of the results computed by hunspell, by the word they're for
+template< typename Result >
+class ResultCache
+{
+public:
+
+  enum {
+    MaxWords = 2048
+  };
+
+  bool find( wstring const & word, Result & result )
+  {
+    QMutexLocker _( &mutex );
+
+    Result const * cached = cache.object( QString::fromStdU32String( word ) );
+
+    if ( !cached ) {
+      return false;
+    }
+
+    result = *cached;
+    return true;
+  }
+
+  void insert( wstring const & word, Result const & result )
+  {
+    QMutexLocker _( &mutex );
+
+    cache.insert( QString::fromStdU32String( word ), new Result( result ) );
+  }
+
+private:
+
+  QMutex mutex;
+  QCache< QString, Result > cache{ MaxWords };
+};
+
+// We used to have a separate mutex for each Hunspell instance, assuming
+// that its code was reentrant (though probably not thread-safe). However,
+// crashes were discovered later when using several Hunspell dictionaries
+// simultaneously, and we've switched to have a single mutex for all hunspell
+// calls - evidently it's not really reentrant.
+QMutex & getHunspellMutex()
+{
+  static QMutex mutex;
+  return mutex;
+}
+
+/// The Hunspell instance of a dictionary, along with the results it has
+/// computed so far. Since all the hunspell calls have to go one at a time,
+/// under getHunspellMutex(), the results are cached to make as few of them as
+/// possible.
+struct HunspellInstance
+{
+  HunspellInstance( string const & affFile, string const & dicFile ):
+    hunspell( affFile.c_str(), dicFile.c_str() )
+  {
+  }
+
+  Hunspell hunspell;
+
+  /// The stems found by suggest(), by word
+  ResultCache< QList< wstring > > stems;
+
+  /// The spelling suggestions for the misspelled words, and empty lists for
+  /// the correct ones
+  ResultCache< vector< wstring > > corrections;
+};
+
 class HunspellDictionary: public Dictionary::Class
 {
   string name;
-  Hunspell hunspell;
+  HunspellInstance hunspellInstance;
 
 #ifdef Q_OS_WIN32
   static string Utf8ToLocal8Bit( string const & name )
@@ -58,9 +128,9 @@ public:
     Dictionary::Class( id, files ),
     name( name_ ),
 #ifdef Q_OS_WIN32
-    hunspell( Utf8ToLocal8Bit( files[ 0 ] ).c_str(), Utf8ToLocal8Bit( files[ 1 ] ).c_str() )
+    hunspellInstance( Utf8ToLocal8Bit( files[ 0 ] ), Utf8ToLocal8Bit( files[ 1 ] ) )
 #else
-    hunspell( files[ 0 ].c_str(), files[ 1 ].c_str() )
+    hunspellInstance( files[ 0 ], files[ 1 ] )
 #endif
   {
   }
@@ -75,6 +145,11 @@ public:
     return map< Property, string >();
   }
 
+  Features getFeatures() const noexcept override
+  {
+    return ArticlesIgnoreAlts;
+  }
+
   unsigned long getArticleCount() noexcept override
   {
     return 0;
@@ -101,20 +176,6 @@ public:
 protected:
 
   void loadIcon() noexcept override;
-
-private:
-
-  // We used to have a separate mutex for each Hunspell instance, assuming
-  // that its code was reentrant (though probably not thread-safe). However,
-  // crashes were discovered later when using several Hunspell dictionaries
-  // simultaneously, and we've switched to have a single mutex for all hunspell
-  // calls - evidently it's not really reentrant.
-  static QMutex & getHunspellMutex()
-  {
-    static QMutex mutex;
-    return mutex;
-  }
-  //  QMutex hunspellMutex;
 };
 
 /// Encodes the given string to be passed to the hunspell object. May throw
@@ -126,13 +187,10 @@ string encodeToHunspell( Hunspell &, wstring const & );
 wstring decodeFromHunspell( Hunspell &, char const * );
 
 /// Generates suggestions via hunspell
-QList< wstring > suggest( wstring & word, QMutex & hunspellMutex, Hunspell & hunspell );
+QList< wstring > suggest( wstring & word, HunspellInstance & );
 
 /// Generates suggestions for compound expression
-void getSuggestionsForExpression( wstring const & expression,
-                                  vector< wstring > & suggestions,
-                                  QMutex & hunspellMutex,
-                                  Hunspell & hunspell );
+void getSuggestionsForExpression( wstring const & expression, vector< wstring > & suggestions, HunspellInstance & );
 
 /// Returns true if the string contains whitespace, false otherwise
 bool containsWhitespace( wstring const & str )
@@ -172,7 +230,7 @@ vector< wstring > HunspellDictionary::getAlternateWritings( wstring const & word
   vector< wstring > results;
 
   if ( containsWhitespace( word ) ) {
-    getSuggestionsForExpression( word, results, getHunspellMutex(), hunspell );
+    getSuggestionsForExpression( word, results, hunspellInstance );
   }
 
   return results;
@@ -183,8 +241,7 @@ vector< wstring > HunspellDictionary::getAlternateWritings( wstring const & word
 class HunspellArticleRequest: public Dictionary::DataRequest
 {
 
-  QMutex & hunspellMutex;
-  Hunspell & hunspell;
+  HunspellInstance & hunspellInstance;
   wstring word;
 
   QAtomicInt isCancelled;
@@ -192,9 +249,8 @@ class HunspellArticleRequest: public Dictionary::DataRequest
 
 public:
 
-  HunspellArticleRequest( wstring const & word_, QMutex & hunspellMutex_, Hunspell & hunspell_ ):
-    hunspellMutex( hunspellMutex_ ),
-    hunspell( hunspell_ ),
+  HunspellArticleRequest( wstring const & word_, HunspellInstance & hunspellInstance_ ):
+    hunspellInstance( hunspellInstance_ ),
     word( word_ )
   {
     f = QtConcurrent::run( [ this ]() {
@@ -223,8 +279,6 @@ void HunspellArticleRequest::run()
     return;
   }
 
-  vector< string > suggestions;
-
   try {
     wstring trimmedWord = Folding::trimWhitespaceOrPunct( word );
 
@@ -234,18 +288,25 @@ void HunspellArticleRequest::run()
       return;
     }
 
-    QMutexLocker _( &hunspellMutex );
+    vector< wstring > corrections;
 
-    string encodedWord = encodeToHunspell( hunspell, trimmedWord );
+    if ( !hunspellInstance.corrections.find( trimmedWord, corrections ) ) {
+      QMutexLocker _( &getHunspellMutex() );
+      Hunspell & hunspell = hunspellInstance.hunspell;
 
-    if ( hunspell.spell( encodedWord ) ) {
-      // Good word -- no spelling suggestions then.
-      finish();
-      return;
+      string encodedWord = encodeToHunspell( hunspell, trimmedWord );
+
+      // Good words get no spelling suggestions
+      if ( !hunspell.spell( encodedWord ) ) {
+        for ( auto const & suggestion : hunspell.suggest( encodedWord ) ) {
+          corrections.push_back( decodeFromHunspell( hunspell, suggestion.c_str() ) );
+        }
+      }
+
+      hunspellInstance.corrections.insert( trimmedWord, corrections );
     }
 
-    suggestions = hunspell.suggest( encodedWord );
-    if ( !suggestions.empty() ) {
+    if ( !corrections.empty() ) {
       // There were some suggestions made for us. Make an appropriate output.
 
       string result = "<div class=\"gdspellsuggestion\">"
@@ -253,8 +314,8 @@ void HunspellArticleRequest::run()
 
       wstring lowercasedWord = Folding::applySimpleCaseOnly( word );
 
-      for ( vector< string >::size_type x = 0; x < suggestions.size(); ++x ) {
-        wstring suggestion = decodeFromHunspell( hunspell, suggestions[ x ].c_str() );
+      for ( vector< wstring >::size_type x = 0; x < corrections.size(); ++x ) {
+        wstring const & suggestion = corrections[ x ];
 
         if ( Folding::applySimpleCaseOnly( suggestion ) == lowercasedWord ) {
           // If among suggestions we see the same word just with the different
@@ -271,7 +332,7 @@ void HunspellArticleRequest::run()
         result += Html::escape( suggestionUtf8 ) + "\">";
         result += Html::escape( suggestionUtf8 ) + "</a>";
 
-        if ( x != suggestions.size() - 1 ) {
+        if ( x != corrections.size() - 1 ) {
           result += ", ";
         }
       }
@@ -297,7 +358,7 @@ sptr< DataRequest >
 HunspellDictionary::getArticle( wstring const & word, vector< wstring > const &, wstring const &, bool )
 
 {
-  return std::make_shared< HunspellArticleRequest >( word, getHunspellMutex(), hunspell );
+  return std::make_shared< HunspellArticleRequest >( word, hunspellInstance );
 }
 
 /// HunspellDictionary::findHeadwordsForSynonym()
@@ -305,8 +366,7 @@ HunspellDictionary::getArticle( wstring const & word, vector< wstring > const &,
 class HunspellHeadwordsRequest: public Dictionary::WordSearchRequest
 {
 
-  QMutex & hunspellMutex;
-  Hunspell & hunspell;
+  HunspellInstance & hunspellInstance;
   wstring word;
 
   QAtomicInt isCancelled;
@@ -315,9 +375,8 @@ class HunspellHeadwordsRequest: public Dictionary::WordSearchRequest
 
 public:
 
-  HunspellHeadwordsRequest( wstring const & word_, QMutex & hunspellMutex_, Hunspell & hunspell_ ):
-    hunspellMutex( hunspellMutex_ ),
-    hunspell( hunspell_ ),
+  HunspellHeadwordsRequest( wstring const & word_, HunspellInstance & hunspellInstance_ ):
+    hunspellInstance( hunspellInstance_ ),
     word( word_ )
   {
     f = QtConcurrent::run( [ this ]() {
@@ -359,7 +418,7 @@ void HunspellHeadwordsRequest::run()
   if ( containsWhitespace( trimmedWord ) ) {
     vector< wstring > results;
 
-    getSuggestionsForExpression( trimmedWord, results, hunspellMutex, hunspell );
+    getSuggestionsForExpression( trimmedWord, results, hunspellInstance );
 
     QMutexLocker _( &dataMutex );
     for ( const auto & result : results ) {
@@ -367,7 +426,7 @@ void HunspellHeadwordsRequest::run()
     }
   }
   else {
-    QList< wstring > suggestions = suggest( trimmedWord, hunspellMutex, hunspell );
+    QList< wstring > suggestions = suggest( trimmedWord, hunspellInstance );
 
     if ( !suggestions.empty() ) {
       QMutexLocker _( &dataMutex );
@@ -381,27 +440,35 @@ void HunspellHeadwordsRequest::run()
   finish();
 }
 
-QList< wstring > suggest( wstring & word, QMutex & hunspellMutex, Hunspell & hunspell )
+QList< wstring > suggest( wstring & word, HunspellInstance & hunspellInstance )
 {
   QList< wstring > result;
 
-  vector< string > suggestions;
+  if ( hunspellInstance.stems.find( word, result ) ) {
+    return result;
+  }
 
   try {
-    QMutexLocker _( &hunspellMutex );
+    vector< wstring > decoded;
 
-    string encodedWord = encodeToHunspell( hunspell, word );
+    {
+      QMutexLocker _( &getHunspellMutex() );
+      Hunspell & hunspell = hunspellInstance.hunspell;
 
-    suggestions = hunspell.analyze( encodedWord );
-    if ( !suggestions.empty() ) {
+      for ( auto const & x : hunspell.analyze( encodeToHunspell( hunspell, word ) ) ) {
+        decoded.push_back( decodeFromHunspell( hunspell, x.c_str() ) );
+      }
+    }
+
+    if ( !decoded.empty() ) {
       // There were some suggestions made for us. Make an appropriate output.
 
       wstring lowercasedWord = Folding::applySimpleCaseOnly( word );
 
       static QRegularExpression cutStem( R"(^\s*st:(((\s+(?!\w{2}:)(?!-)(?!\+))|\S+)+))" );
 
-      for ( const auto & x : suggestions ) {
-        QString suggestion = QString::fromStdU32String( decodeFromHunspell( hunspell, x.c_str() ) );
+      for ( const auto & x : decoded ) {
+        QString suggestion = QString::fromStdU32String( x );
 
         // Strip comments
         int n = suggestion.indexOf( '#' );
@@ -422,6 +489,8 @@ QList< wstring > suggest( wstring & word, QMutex & hunspellMutex, Hunspell & hun
         }
       }
     }
+
+    hunspellInstance.stems.insert( word, result );
   }
   catch ( Iconv::Ex & e ) {
     gdWarning( "Hunspell: charset conversion error, no processing's done: %s\n", e.what() );
@@ -434,7 +503,7 @@ QList< wstring > suggest( wstring & word, QMutex & hunspellMutex, Hunspell & hun
 sptr< WordSearchRequest > HunspellDictionary::findHeadwordsForSynonym( wstring const & word )
 
 {
-  return std::make_shared< HunspellHeadwordsRequest >( word, getHunspellMutex(), hunspell );
+  return std::make_shared< HunspellHeadwordsRequest >( word, hunspellInstance );
 }
 
 
@@ -443,8 +512,7 @@ sptr< WordSearchRequest > HunspellDictionary::findHeadwordsForSynonym( wstring c
 class HunspellPrefixMatchRequest: public Dictionary::WordSearchRequest
 {
 
-  QMutex & hunspellMutex;
-  Hunspell & hunspell;
+  HunspellInstance & hunspellInstance;
   wstring word;
 
   QAtomicInt isCancelled;
@@ -452,9 +520,8 @@ class HunspellPrefixMatchRequest: public Dictionary::WordSearchRequest
 
 public:
 
-  HunspellPrefixMatchRequest( wstring const & word_, QMutex & hunspellMutex_, Hunspell & hunspell_ ):
-    hunspellMutex( hunspellMutex_ ),
-    hunspell( hunspell_ ),
+  HunspellPrefixMatchRequest( wstring const & word_, HunspellInstance & hunspellInstance_ ):
+    hunspellInstance( hunspellInstance_ ),
     word( word_ )
   {
     f = QtConcurrent::run( [ this ]() {
@@ -493,11 +560,15 @@ void HunspellPrefixMatchRequest::run()
       return;
     }
 
-    QMutexLocker _( &hunspellMutex );
+    bool known;
 
-    string encodedWord = encodeToHunspell( hunspell, trimmedWord );
+    {
+      QMutexLocker _( &getHunspellMutex() );
+      Hunspell & hunspell = hunspellInstance.hunspell;
+      known = hunspell.spell( encodeToHunspell( hunspell, trimmedWord ) );
+    }
 
-    if ( hunspell.spell( encodedWord ) ) {
+    if ( known ) {
       // Known word -- add it to the result
 
       QMutexLocker _( &dataMutex );
@@ -515,13 +586,12 @@ void HunspellPrefixMatchRequest::run()
 sptr< WordSearchRequest > HunspellDictionary::prefixMatch( wstring const & word, unsigned long /*maxResults*/ )
 
 {
-  return std::make_shared< HunspellPrefixMatchRequest >( word, getHunspellMutex(), hunspell );
+  return std::make_shared< HunspellPrefixMatchRequest >( word, hunspellInstance );
 }
 
 void getSuggestionsForExpression( wstring const & expression,
                                   vector< wstring > & suggestions,
-                                  QMutex & hunspellMutex,
-                                  Hunspell & hunspell )
+                                  HunspellInstance & hunspellInstance )
 {
   // Analyze each word separately and use the first two suggestions, if any.
   // This is useful for compound expressions where some words is
@@ -576,7 +646,7 @@ void getSuggestionsForExpression( wstring const & expression,
       }
     }
     else {
-      QList< wstring > sugg = suggest( word, hunspellMutex, hunspell );
+      QList< wstring > sugg = suggest( word, hunspellInstance );
       int suggNum           = sugg.size() + 1;
       if ( suggNum > 3 ) {
         suggNum = 3;
@@ -614,36 +684,12 @@ void getSuggestionsForExpression( wstring const & expression,
 
 string encodeToHunspell( Hunspell & hunspell, wstring const & str )
 {
-  Iconv conv( Iconv::GdWchar );
-
-  void const * in = str.data();
-  size_t inLeft   = str.size() * sizeof( wchar );
-
-  vector< char > result( str.size() * 4 + 1 ); // +1 isn't actually needed,
-                                               // but then iconv complains on empty
-                                               // words
-
-  void * out     = &result.front();
-  size_t outLeft = result.size();
-
-  QString convStr = conv.convert( in, inLeft );
-  return convStr.toStdString();
+  return Iconv::toUtf8( Iconv::GdWchar, str.data(), str.size() * sizeof( wchar ) );
 }
 
 wstring decodeFromHunspell( Hunspell & hunspell, char const * str )
 {
-  Iconv conv( hunspell.get_dic_encoding() );
-
-  void const * in = str;
-  size_t inLeft   = strlen( str );
-
-  vector< wchar > result( inLeft + 1 ); // +1 isn't needed, but see above
-
-  void * out     = &result.front();
-  size_t outLeft = result.size() * sizeof( wchar );
-
-  QString convStr = conv.convert( in, inLeft );
-  return gd::toWString( convStr );
+  return Iconv::toWstring( hunspell.get_dic_encoding(), str, strlen( str ) );
 }
 } // namespace
 
@@ -44,7 +44,11 @@
 
 #include <QMessageBox>
 #include <QDir>
+#include <QThreadPool>
+#include <QtConcurrent>
 
+#include <exception>
+#include <functional>
 #include <set>
 
 using std::set;
@@ -92,11 +96,15 @@ LoadDictionaries::LoadDictionaries( Config::Class const & cfg ):
 void LoadDictionaries::run()
 {
   try {
+    vector< vector< string > > fileSets;
+
     for ( const auto & path : paths ) {
       qDebug() << "handle path:" << path.path;
-      handlePath( path );
+      handlePath( path, fileSets );
     }
 
+    makeFileDictionaries( fileSets );
+
     // Make soundDirs
     {
       vector< sptr< Dictionary::Class > > soundDirDictionaries =
@@ -142,7 +150,7 @@ void LoadDictionaries::addDicts( const std::vector< sptr< Dictionary::Class > >
   std::move( dicts.begin(), dicts.end(), std::back_inserter( dictionaries ) );
 }
 
-void LoadDictionaries::handlePath( Config::Path const & path )
+void LoadDictionaries::handlePath( Config::Path const & path, vector< vector< string > > & fileSets )
 {
   vector< string > allFiles;
 
@@ -157,7 +165,7 @@ void LoadDictionaries::handlePath( Config::Path const & path )
       // Make sure the path doesn't look like with dsl resources
       if ( !fullName.endsWith( ".dsl.files", Qt::CaseInsensitive )
            && !fullName.endsWith( ".dsl.dz.files", Qt::CaseInsensitive ) ) {
-        handlePath( Config::Path( fullName, true ) );
+        handlePath( Config::Path( fullName, true ), fileSets );
       }
     }
 
@@ -166,24 +174,121 @@ void LoadDictionaries::handlePath( Config::Path const & path )
     }
   }
 
-  addDicts( Bgl::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Stardict::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand ) );
-  addDicts( Lsa::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Dsl::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordSize ) );
-  addDicts( DictdFiles::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Xdxf::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Sdict::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Aard::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand ) );
-  addDicts( ZipSounds::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Mdx::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Gls::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Slob::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand ) );
+  fileSets.push_back( std::move( allFiles ) );
+}
+
+void LoadDictionaries::makeFileDictionaries( vector< vector< string > > const & fileSets )
+{
+  string const indexDir = Config::getIndexDir().toStdString();
+
+  typedef vector< sptr< Dictionary::Class > > Dictionaries;
+
+  // The formats, in the order their dictionaries get listed within each directory
+  vector< std::function< Dictionaries( vector< string > const & ) > > const formats = {
+    [ & ]( vector< string > const & files ) {
+      return Bgl::makeDictionaries( files, indexDir, *this );
+    },
+    [ & ]( vector< string > const & files ) {
+      return Stardict::makeDictionaries( files, indexDir, *this, maxHeadwordToExpand );
+    },
+    [ & ]( vector< string > const & files ) {
+      return Lsa::makeDictionaries( files, indexDir, *this );
+    },
+    [ & ]( vector< string > const & files ) {
+      return Dsl::makeDictionaries( files, indexDir, *this, maxHeadwordSize );
+    },
+    [ & ]( vector< string > const & files ) {
+      return DictdFiles::makeDictionaries( files, indexDir, *this );
+    },
+    [ & ]( vector< string > const & files ) {
+      return Xdxf::makeDictionaries( files, indexDir, *this );
+    },
+    [ & ]( vector< string > const & files ) {
+      return Sdict::makeDictionaries( files, indexDir, *this );
+    },
+    [ & ]( vector< string > const & files ) {
+      return Aard::makeDictionaries( files, indexDir, *this, maxHeadwordToExpand );
+    },
+    [ & ]( vector< string > const & files ) {
+      return ZipSounds::makeDictionaries( files, indexDir, *this );
+    },
+    [ & ]( vector< string > const & files ) {
+      return Mdx::makeDictionaries( files, indexDir, *this );
+    },
+    [ & ]( vector< string > const & files ) {
+      return Gls::makeDictionaries( files, indexDir, *this );
+    },
+    [ & ]( vector< string > const & files ) {
+      return Slob::makeDictionaries( files, indexDir, *this, maxHeadwordToExpand );
+    },
 #ifdef MAKE_ZIM_SUPPORT
-  addDicts( Zim::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand ) );
+    [ & ]( vector< string > const & files ) {
+      return Zim::makeDictionaries( files, indexDir, *this, maxHeadwordToExpand );
+    },
 #endif
 #ifndef NO_EPWING_SUPPORT
-  addDicts( Epwing::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
+    [ & ]( vector< string > const & files ) {
+      return Epwing::makeDictionaries( files, indexDir, *this );
+    },
 #endif
+  };
+
+  // Each file is opened, and indexed if needed, as a separate job. Every
+  // format looks at the file on its own and only picks the ones it handles.
+  struct FileJob
+  {
+    string fileName;
+    vector< Dictionaries > dictionaries; // One entry per format
+    std::exception_ptr error;
+  };
+
+  vector< vector< FileJob > > jobs( fileSets.size() );
+
+  for ( size_t x = 0; x < fileSets.size(); ++x ) {
+    for ( auto const & fileName : fileSets[ x ] ) {
+      jobs[ x ].push_back( FileJob{ fileName, vector< Dictionaries >( formats.size() ), nullptr } );
+    }
+  }
+
+  vector< FileJob * > allJobs;
+
+  for ( auto & fileJobs : jobs ) {
+    for ( auto & job : fileJobs ) {
+      allJobs.push_back( &job );
+    }
+  }
+
+  QThreadPool pool;
+  pool.setMaxThreadCount( QThread::idealThreadCount() );
+
+  QtConcurrent::blockingMap( &pool, allJobs, [ & ]( FileJob * job ) {
+    try {
+      vector< string > const files( 1, job->fileName );
+
+      for ( size_t f = 0; f < formats.size(); ++f ) {
+        job->dictionaries[ f ] = formats[ f ]( files );
+      }
+    }
+    catch ( ... ) {
+      job->error = std::current_exception();
+    }
+  } );
+
+  // Merge the results back in the order the sequential loading would have,
+  // i.e. directory by directory, then format by format, then file by file.
+  for ( auto const & fileJobs : jobs ) {
+    for ( auto const & job : fileJobs ) {
+      if ( job.error ) {
+        std::rethrow_exception( job.error );
+      }
+    }
+
+    for ( size_t f = 0; f < formats.size(); ++f ) {
+      for ( auto const & job : fileJobs ) {
+        addDicts( job.dictionaries[ f ] );
+      }
+    }
+  }
 }
 
 void LoadDictionaries::indexingDictionary( string const & dictionaryName ) noexcept
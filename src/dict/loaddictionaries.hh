@@ -46,12 +46,22 @@ public:
 
 public:
 
+  /// These may be called from several threads at once. They only emit the
+  /// signals below, which are delivered to the receivers' threads.
   virtual void indexingDictionary( std::string const & dictionaryName ) noexcept;
   virtual void loadingDictionary( std::string const & dictionaryName ) noexcept;
 
 private:
 
-  void handlePath( Config::Path const & );
+  /// Collects the dictionary files of the path, one set per directory, in
+  /// the order their dictionaries are to be listed.
+  void handlePath( Config::Path const &, std::vector< std::vector< std::string > > & fileSets );
+
+  /// Opens the dictionaries of all the files, building their indices if
+  /// needed. The files are handled by a pool of worker threads, so the
+  /// Initializing callbacks get called from those threads. The result is
+  /// the same as if the files were handled one by one.
+  void makeFileDictionaries( std::vector< std::vector< std::string > > const & fileSets );
 
   // Helper function that will add a vector of dictionary::Class to the dictionary list
   void addDicts( const std::vector< sptr< Dictionary::Class > > & dicts );
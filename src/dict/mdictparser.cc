@@ -32,6 +32,7 @@
 #include <QDomDocument>
 #include <QTextDocumentFragment>
 #include <QDataStream>
+#include <QScopeGuard>
 #if ( QT_VERSION >= QT_VERSION_CHECK( 6, 0, 0 ) )
   #include <QtCore5Compat/QTextCodec>
 #else
@@ -659,4 +660,94 @@ QString & MdictParser::substituteStylesheet( QString & article, MdictParser::Sty
   return article;
 }
 
+RecordBlockCache::RecordBlockCache():
+  blocks( 32 * 1024 * 1024 )
+{
+}
+
+RecordBlockCache & RecordBlockCache::instance()
+{
+  static RecordBlockCache cache;
+  return cache;
+}
+
+bool RecordBlockCache::getBlock( QFile & file,
+                                 QMutex & fileMutex,
+                                 MdictParser::RecordInfo const & recordInfo,
+                                 QByteArray & block )
+{
+  Key const key = qMakePair( file.fileName(), recordInfo.compressedBlockPos );
+
+  {
+    QMutexLocker _( &mutex );
+
+    for ( ;; ) {
+      if ( QByteArray * cached = blocks.object( key ) ) {
+        block = *cached;
+        return true;
+      }
+
+      if ( !pending.contains( key ) ) {
+        break;
+      }
+
+      // Someone else is decompressing this very block, so wait for it
+      blockReady.wait( &mutex );
+    }
+
+    pending.insert( key );
+  }
+
+  bool result = false;
+
+  auto publish = qScopeGuard( [ & ] {
+    QMutexLocker _( &mutex );
+
+    pending.remove( key );
+
+    // QCache takes the ownership and drops the entry right away if it exceeds the budget
+    if ( result ) {
+      blocks.insert( key, new QByteArray( block ), block.size() );
+    }
+
+    blockReady.wakeAll();
+  } );
+
+  QByteArray compressed;
+
+  {
+    QMutexLocker _( &fileMutex );
+    ScopedMemMap mapped( file, recordInfo.compressedBlockPos, recordInfo.compressedBlockSize );
+    if ( !mapped.startAddress() ) {
+      return false;
+    }
+
+    compressed = QByteArray( (char const *)mapped.startAddress(), recordInfo.compressedBlockSize );
+  }
+
+  result = MdictParser::parseCompressedBlock( recordInfo.compressedBlockSize,
+                                              compressed.constData(),
+                                              recordInfo.decompressedBlockSize,
+                                              block );
+
+  return result;
+}
+
+void RecordBlockCache::removeFile( QString const & fileName )
+{
+  QMutexLocker _( &mutex );
+
+  for ( auto const & key : blocks.keys() ) {
+    if ( key.first == fileName ) {
+      blocks.remove( key );
+    }
+  }
+}
+
+void RecordBlockCache::setMaxSize( size_t bytes )
+{
+  QMutexLocker _( &mutex );
+  blocks.setMaxCost( bytes );
+}
+
 } // namespace Mdict
@@ -26,8 +26,13 @@
 #include <map>
 #include <utility>
 
-#include <QPointer>
+#include <QByteArray>
+#include <QCache>
 #include <QFile>
+#include <QMutex>
+#include <QPointer>
+#include <QSet>
+#include <QWaitCondition>
 
 namespace Mdict {
 
@@ -214,6 +219,42 @@ protected:
   bool rtl_;
 };
 
+/// A process-wide LRU cache of decompressed record blocks, shared by the
+/// .mdx and .mdd readers. A block usually holds many records, e.g. all the
+/// images and styles an article refers to, so it's decompressed only once.
+/// The total size of the blocks kept is limited by a byte budget; a zero
+/// budget disables the cache.
+class RecordBlockCache
+{
+public:
+
+  static RecordBlockCache & instance();
+
+  /// Retrieves the decompressed block the given record belongs to, reading
+  /// and decompressing it if it isn't cached yet. Only the reading of the
+  /// compressed data is done under the given file mutex. If another thread
+  /// is already decompressing the same block, this waits for its result.
+  /// Returns false if the block couldn't be read.
+  bool getBlock( QFile & file, QMutex & fileMutex, MdictParser::RecordInfo const & recordInfo, QByteArray & block );
+
+  /// Drops all the blocks of the given file. Used when the file is opened,
+  /// since it might have been changed in the meantime.
+  void removeFile( QString const & fileName );
+
+  void setMaxSize( size_t bytes );
+
+private:
+
+  RecordBlockCache();
+
+  typedef QPair< QString, qint64 > Key; // File name and the block position
+
+  QMutex mutex;
+  QWaitCondition blockReady;
+  QCache< Key, QByteArray > blocks;
+  QSet< Key > pending; // The blocks being decompressed right now
+};
+
 } // namespace Mdict
 
 #endif // __MDICTPARSER_HH_INCLUDED__
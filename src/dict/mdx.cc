@@ -18,6 +18,7 @@
 #include "filetype.hh"
 #include "ftshelpers.hh"
 #include "htmlescape.hh"
+#include "htmlrewriter.hh"
 
 #include <algorithm>
 #include <map>
@@ -124,6 +125,7 @@ public:
   {
     mddFile.setFileName( QString::fromUtf8( fileName ) );
     isFileOpen = mddFile.open( QFile::ReadOnly );
+    RecordBlockCache::instance().removeFile( mddFile.fileName() );
     return isFileOpen;
   }
 
@@ -144,9 +146,10 @@ public:
     return !links.empty();
   }
 
-  /// Attempts loading the given file into the given vector. Returns true on
-  /// success, false otherwise.
-  bool loadFile( gd::wstring const & name, std::vector< char > & result )
+  /// Finds the given file. On success, the file is the 'size' bytes at
+  /// 'offset' of the given record block, which is shared with the record block
+  /// cache. Returns false if there's no such file.
+  bool findFile( gd::wstring const & name, QByteArray & block, size_t & offset, size_t & size )
   {
     if ( !isFileOpen ) {
       return false;
@@ -158,7 +161,7 @@ public:
     }
 
     MdictParser::RecordInfo indexEntry{};
-    vector< char > chunk;
+    ChunkedStorage::Reader::Chunk chunk;
     // QMutexLocker _( &idxMutex );
     const char * indexEntryPtr = chunks.getBlock( links[ 0 ].articleOffset, chunk );
     memcpy( &indexEntry, indexEntryPtr, sizeof( indexEntry ) );
@@ -168,25 +171,12 @@ public:
       return false;
     }
 
-    QByteArray decompressed;
-
-    {
-      QMutexLocker _( &idxMutex );
-      ScopedMemMap compressed( mddFile, indexEntry.compressedBlockPos, indexEntry.compressedBlockSize );
-      if ( !compressed.startAddress() ) {
-        return false;
-      }
-
-      if ( !MdictParser::parseCompressedBlock( indexEntry.compressedBlockSize,
-                                               (char *)compressed.startAddress(),
-                                               indexEntry.decompressedBlockSize,
-                                               decompressed ) ) {
-        return false;
-      }
+    if ( !RecordBlockCache::instance().getBlock( mddFile, idxMutex, indexEntry, block ) ) {
+      return false;
     }
 
-    result.resize( indexEntry.recordSize );
-    memcpy( &result.front(), decompressed.constData() + indexEntry.recordOffset, indexEntry.recordSize );
+    offset = indexEntry.recordOffset;
+    size   = indexEntry.recordSize;
     return true;
   }
 };
@@ -257,6 +247,8 @@ public:
   getSearchResults( QString const & searchString, int searchMode, bool matchCase, bool ignoreDiacritics ) override;
   void getArticleText( uint32_t articleAddress, QString & headword, QString & text ) override;
 
+  void sortInStorageOrder( vector< uint32_t > & articleAddresses ) override;
+
   void makeFTSIndex( QAtomicInt & isCancelled ) override;
 
   void setFTSParameters( Config::FullTextSearch const & fts ) override
@@ -287,17 +279,23 @@ private:
   /// Loads an article with the given offset, filling the given strings.
   void loadArticle( uint32_t offset, string & articleText, bool noFilter = false );
 
-  /// Process resource links (images, audios, etc)
-  QString & filterResource( QString & article );
-
-  void replaceLinks( QString & id, QString & article );
-  //@font-face
-  void replaceStyleInHtml( QString & id, QString & article );
-  void replaceFontLinks( QString & id, QString & article );
+  /// Process resource links (images, audios, etc), appending the result
+  void filterResource( std::string_view article, string & result );
 
   friend class MdxArticleRequest;
   friend class MddResourceRequest;
   void loadResourceFile( const wstring & resourceName, vector< char > & data );
+
+  /// Finds the given resource, a local file taking precedence over the mdd
+  /// files. On success, the resource is the 'size' bytes at 'resource', which
+  /// point either into the mapping of 'localFile' or into the mdd record
+  /// 'block', and stay valid for as long as these do. Returns false if there's
+  /// no such resource.
+  bool findResource( const wstring & resourceName,
+                     QFile & localFile,
+                     QByteArray & block,
+                     const char *& resource,
+                     size_t & size );
 };
 
 MdxDictionary::MdxDictionary( string const & id, string const & indexFile, vector< string > const & dictionaryFiles ):
@@ -327,6 +325,7 @@ MdxDictionary::MdxDictionary( string const & id, string const & indexFile, vecto
 
   dictFile.setFileName( QString::fromUtf8( dictionaryFiles[ 0 ].c_str() ) );
   dictFile.open( QIODevice::ReadOnly );
+  RecordBlockCache::instance().removeFile( dictFile.fileName() );
 
   // Full-text search parameters
 
@@ -477,6 +476,28 @@ void MdxDictionary::makeFTSIndex( QAtomicInt & isCancelled )
   }
 }
 
+void MdxDictionary::sortInStorageOrder( vector< uint32_t > & articleAddresses )
+{
+  // The records are indexed in the order of their keys, while the record
+  // blocks can hold them in any order
+  vector< pair< pair< qint64, qint64 >, uint32_t > > positions;
+  positions.reserve( articleAddresses.size() );
+
+  ChunkedStorage::Reader::Chunk chunk;
+  MdictParser::RecordInfo recordInfo;
+
+  for ( uint32_t address : articleAddresses ) {
+    memcpy( &recordInfo, chunks.getBlock( address, chunk ), sizeof( recordInfo ) );
+    positions.emplace_back( std::make_pair( recordInfo.compressedBlockPos, recordInfo.recordOffset ), address );
+  }
+
+  std::sort( positions.begin(), positions.end() );
+
+  for ( size_t x = 0; x < positions.size(); ++x ) {
+    articleAddresses[ x ] = positions[ x ].second;
+  }
+}
+
 void MdxDictionary::getArticleText( uint32_t articleAddress, QString & headword, QString & text )
 {
   try {
@@ -756,16 +777,14 @@ void MddResourceRequest::run()
       return;
     }
 
-    QMutexLocker _( &dataMutex );
-    data.clear();
-
-    //check the global cache
-    //generate resource unique key
-    const QString id = QString::fromUtf8( dict.getId().c_str() );
-
-    const QString unique_key = id + QString::fromStdString( u8ResourceName );
+    QFile localFile;
+    QByteArray block;
+    const char * resource = nullptr;
+    size_t size           = 0;
 
-    dict.loadResourceFile( resourceName, data );
+    if ( !dict.findResource( resourceName, localFile, block, resource, size ) || !size ) {
+      break;
+    }
 
     // Check if this file has a redirection
     // Always encoded in UTF16-LE
@@ -773,19 +792,22 @@ void MddResourceRequest::run()
     static const char pattern[ 16 ] =
       { '@', '\0', '@', '\0', '@', '\0', 'L', '\0', 'I', '\0', 'N', '\0', 'K', '\0', '=', '\0' };
 
-    if ( data.size() > sizeof( pattern ) ) {
-      if ( memcmp( &data.front(), pattern, sizeof( pattern ) ) == 0 ) {
-        data.push_back( '\0' );
-        data.push_back( '\0' );
-        QString target =
-          MdictParser::toUtf16( "UTF-16LE", &data.front() + sizeof( pattern ), data.size() - sizeof( pattern ) );
-        resourceName = gd::toWString( target.trimmed() );
+    if ( size > sizeof( pattern ) ) {
+      if ( memcmp( resource, pattern, sizeof( pattern ) ) == 0 ) {
+        vector< char > link( resource + sizeof( pattern ), resource + size );
+        link.push_back( '\0' );
+        link.push_back( '\0' );
+        QString target = MdictParser::toUtf16( "UTF-16LE", &link.front(), link.size() );
+        resourceName   = gd::toWString( target.trimmed() );
         continue;
       }
     }
 
-    if ( data.size() > 0 ) {
-      hasAnyData = true;
+    if ( Filetype::isNameOfCSS( u8ResourceName ) || Filetype::isNameOfTiff( u8ResourceName ) ) {
+      // These are converted, so they're only published once fully loaded
+      QMutexLocker _( &dataMutex );
+
+      data.assign( resource, resource + size );
 
       if ( Filetype::isNameOfCSS( u8ResourceName ) ) {
         QByteArray bytes = isolate_css();
@@ -793,10 +815,33 @@ void MddResourceRequest::run()
         data.resize( bytes.size() );
         memcpy( &data.front(), bytes.constData(), bytes.size() );
       }
-      if ( Filetype::isNameOfTiff( u8ResourceName ) ) {
+      else {
         // Convert it
         GdTiff::tiff2img( data );
       }
+
+      hasAnyData = true;
+      break;
+    }
+
+    // Anything else is published a part at a time, so that large media files
+    // start playing before they're fully copied, and a local file is only
+    // read as its parts get published
+    {
+      QMutexLocker _( &dataMutex );
+      data.reserve( size );
+    }
+
+    for ( size_t offset = 0; offset < size; offset += DataPartSize ) {
+      if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+        break;
+      }
+
+      publishDataPart( resource + offset, std::min< size_t >( DataPartSize, size - offset ) );
+    }
+
+    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+      dropPublishedData( "Cancelled" );
     }
     break;
   }
@@ -820,8 +865,8 @@ const QString & MdxDictionary::getDescription()
   }
   else {
     // QMutexLocker _( &idxMutex );
-    vector< char > chunk;
-    char * dictDescription = chunks.getBlock( idxHeader.descriptionAddress, chunk );
+    ChunkedStorage::Reader::Chunk chunk;
+    char const * dictDescription = chunks.getBlock( idxHeader.descriptionAddress, chunk );
     string str( dictDescription );
     dictionaryDescription = QString::fromUtf8( str.c_str(), str.size() );
   }
@@ -851,7 +896,7 @@ void MdxDictionary::loadIcon() noexcept
 
 void MdxDictionary::loadArticle( uint32_t offset, string & articleText, bool noFilter )
 {
-  vector< char > chunk;
+  ChunkedStorage::Reader::Chunk chunk;
   // QMutexLocker _( &idxMutex );
 
   // Load record info from index
@@ -861,266 +906,240 @@ void MdxDictionary::loadArticle( uint32_t offset, string & articleText, bool noF
 
   QByteArray decompressed;
 
-  {
-    QMutexLocker _( &idxMutex );
-    ScopedMemMap compressed( dictFile, recordInfo.compressedBlockPos, recordInfo.compressedBlockSize );
-    if ( !compressed.startAddress() ) {
-      throw exCorruptDictionary();
-    }
-
-    if ( !MdictParser::parseCompressedBlock( recordInfo.compressedBlockSize,
-                                             (char *)compressed.startAddress(),
-                                             recordInfo.decompressedBlockSize,
-                                             decompressed ) ) {
-      throw exCorruptDictionary();
-    }
+  if ( !RecordBlockCache::instance().getBlock( dictFile, idxMutex, recordInfo, decompressed )
+       || decompressed.size() < recordInfo.recordOffset + recordInfo.recordSize ) {
+    throw exCorruptDictionary();
   }
 
   QString article =
     MdictParser::toUtf16( encoding.c_str(), decompressed.constData() + recordInfo.recordOffset, recordInfo.recordSize );
 
-  if ( !noFilter ) {
-    article = MdictParser::substituteStylesheet( article, styleSheets );
-    article = filterResource( article );
+  if ( noFilter ) {
+    articleText = Utils::c_string( article );
+    return;
   }
 
-  articleText = Utils::c_string( article );
+  MdictParser::substituteStylesheet( article, styleSheets );
+
+  QByteArray const articleUtf8 = article.toUtf8();
+  articleText.clear();
+  filterResource( articleUtf8.constData(), articleText );
 }
 
-QString & MdxDictionary::filterResource( QString & article )
+namespace {
+
+/// Returns the link to the given resource of the dictionary, or an empty
+/// string for external and inline resources
+string resourceLink( std::string_view url, string const & scheme, string const & id )
 {
-  QString id = QString::fromStdString( getId() );
-  replaceLinks( id, article );
-  replaceStyleInHtml( id, article );
-  return article;
+  std::string_view const trimmed = url.substr( std::min( url.find_first_not_of( " \t\r\n" ), url.size() ) );
+
+  for ( std::string_view external : { "bres://", "http://", "https://", "ftp://", "data:", "javascript:" } ) {
+    if ( Html::startsWithIgnoreCase( trimmed, external ) ) {
+      return {};
+    }
+  }
+
+  if ( Html::startsWithIgnoreCase( url, "file://" ) ) {
+    url.remove_prefix( 7 );
+  }
+
+  while ( !url.empty() && ( (unsigned char)url[ 0 ] < 0x20 || url[ 0 ] == 0x7f ) ) {
+    url.remove_prefix( 1 );
+  }
+
+  while ( !url.empty() && url[ 0 ] == '.' ) {
+    url.remove_prefix( 1 );
+  }
+
+  if ( !url.empty() && url[ 0 ] == '/' ) {
+    url.remove_prefix( 1 );
+  }
+
+  if ( url.empty() ) {
+    return {};
+  }
+
+  return scheme + id + "/" + string( url );
 }
 
-void MdxDictionary::replaceLinks( QString & id, QString & article )
+/// Points the resource links to the dictionary, the cross references to the
+/// lookups and the sound links to the audio player
+class MdxLinkRewriter: public Html::Rewriter
 {
-  QString articleNewText;
-  int linkPos                        = 0;
-  QRegularExpressionMatchIterator it = RX::Mdx::allLinksRe.globalMatch( article );
-  while ( it.hasNext() ) {
-    QRegularExpressionMatch allLinksMatch = it.next();
+  string const & id;
 
-    if ( allLinksMatch.capturedEnd() < linkPos ) {
-      continue;
-    }
+public:
 
-    articleNewText += article.mid( linkPos, allLinksMatch.capturedStart() - linkPos );
-    linkPos = allLinksMatch.capturedEnd();
-
-    QString linkTxt  = allLinksMatch.captured();
-    QString linkType = allLinksMatch.captured( 1 ).toLower();
-    QString newLink;
-
-    if ( linkType.compare( "a" ) == 0 || linkType.compare( "area" ) == 0 ) {
-      newLink = linkTxt;
-
-      QRegularExpressionMatch match = RX::Mdx::audioRe.match( newLink );
-      if ( match.hasMatch() ) {
-        // sounds and audio link script
-        QString newTxt =
-          match.captured( 1 ) + match.captured( 2 ) + "gdau://" + id + "/" + match.captured( 3 ) + match.captured( 2 );
-        newLink =
-          QString::fromUtf8(
-            addAudioLink( "\"gdau://" + getId() + "/" + match.captured( 3 ).toUtf8().data() + "\"", getId() ).c_str() )
-          + newLink.replace( match.capturedStart(), match.capturedLength(), newTxt );
-      }
+  explicit MdxLinkRewriter( string const & id ):
+    id( id )
+  {
+  }
 
-      match = RX::Mdx::wordCrossLink.match( newLink );
-      if ( match.hasMatch() ) {
-        if ( !match.captured( 3 ).isEmpty() ) {
-          QString newTxt = match.captured( 1 ) + match.captured( 2 ) + "gdlookup://localhost/" + match.captured( 3 );
+protected:
 
-          if ( match.lastCapturedIndex() >= 4 && !match.captured( 4 ).isEmpty() ) {
-            newTxt += QString( "?gdanchor=" ) + match.captured( 4 ).mid( 1 );
-          }
+  void handleTag( Tag & tag ) override;
 
-          newTxt += match.captured( 2 );
-          newLink.replace( match.capturedStart(), match.capturedLength(), newTxt );
-        }
-        else {
-          //links like entry://#abc,just remove the prefix entry://
-          QString newTxt = match.captured( 1 ) + match.captured( 2 );
+  /// Points the fonts of @font-face rules to the dictionary
+  void handleStyle( std::string_view css, string & out ) override;
 
-          if ( match.lastCapturedIndex() >= 4 && !match.captured( 4 ).isEmpty() ) {
-            newTxt += match.captured( 4 );
-          }
+private:
 
-          newTxt += match.captured( 2 );
-          newLink.replace( match.capturedStart(), match.capturedLength(), newTxt );
-        }
-      }
+  void setResourceLink( Attribute * attribute, string const & scheme );
+};
+
+void MdxLinkRewriter::setResourceLink( Attribute * attribute, string const & scheme )
+{
+  if ( attribute ) {
+    string link = resourceLink( attribute->value, scheme, id );
+
+    if ( !link.empty() ) {
+      attribute->set( std::move( link ) );
     }
-    else if ( linkType.compare( "link" ) == 0 ) {
-      // stylesheets
-      QRegularExpressionMatch match = RX::Mdx::stylesRe.match( linkTxt );
-      if ( match.hasMatch() ) {
-        QString newText =
-          match.captured( 1 ) + match.captured( 2 ) + "bres://" + id + "/" + match.captured( 3 ) + match.captured( 2 );
-        newLink = linkTxt.replace( match.capturedStart(), match.capturedLength(), newText );
-      }
-      else {
-        newLink = linkTxt.replace( RX::Mdx::stylesRe2, R"(\1"bres://)" + id + R"(/\2")" );
-      }
+  }
+}
+
+void MdxLinkRewriter::handleTag( Tag & tag )
+{
+  if ( tag.is( "a" ) || tag.is( "area" ) ) {
+    Attribute * href = tag.find( "href" );
+
+    if ( !href ) {
+      return;
     }
-    else {
-      //linkType in ("script","img","source","audio","video")
-      // javascripts and images
-      QRegularExpressionMatch match = RX::Mdx::inlineScriptRe.match( linkTxt );
-      // "script" tag
-      if ( linkType.compare( "script" ) == 0 && match.hasMatch() && match.capturedLength() == linkTxt.length() ) {
-        // skip inline scripts
-        articleNewText += linkTxt;
-        match = RX::Mdx::closeScriptTagRe.match( article, linkPos );
-        if ( match.hasMatch() ) {
-          articleNewText += article.mid( linkPos, match.capturedEnd() - linkPos );
-          linkPos = match.capturedEnd();
-        }
-        continue;
+
+    if ( Html::startsWithIgnoreCase( href->value, "sound://" ) && href->value.size() > 8 ) {
+      // sounds and audio link script
+      string link = "gdau://" + id + "/" + string( href->value.substr( 8 ) );
+      tag.before  = addAudioLink( "\"" + link + "\"", id );
+      href->set( std::move( link ) );
+    }
+    else if ( Html::startsWithIgnoreCase( href->value, "entry://" ) ) {
+      std::string_view word = href->value.substr( 8 );
+      size_t const anchor   = word.find( '#' );
+
+      if ( word.empty() || anchor == 0 ) {
+        // Links like entry:// or entry://#abc, just remove the prefix
+        href->set( string( word ) );
       }
       else {
-        //audio ,video ,html5 tags fall here.
-        match = RX::Mdx::srcRe.match( linkTxt );
-        if ( match.hasMatch() ) {
-          QString newText;
-          QString scheme;
-          // "source" tag
-          if ( linkType.compare( "source" ) == 0 ) {
-            scheme = "gdvideo://";
-          }
-          else {
-            scheme = "bres://";
-          }
-          newText =
-            match.captured( 1 ) + match.captured( 2 ) + scheme + id + "/" + match.captured( 3 ) + match.captured( 2 );
+        string link = "gdlookup://localhost/" + string( word.substr( 0, anchor ) );
 
-          newLink = linkTxt.replace( match.capturedStart(), match.capturedLength(), newText );
-        }
-        else {
-          newLink = linkTxt.replace( RX::Mdx::srcRe2, R"(\1"bres://)" + id + R"(/\2")" );
+        if ( anchor != std::string_view::npos ) {
+          link += "?gdanchor=" + string( word.substr( anchor + 1 ) );
         }
+
+        href->set( std::move( link ) );
       }
+    }
+  }
+  else if ( tag.is( "link" ) ) {
+    // stylesheets
+    setResourceLink( tag.find( "href" ), "bres://" );
+  }
+  else if ( tag.is( "script" ) ) {
+    // Inline scripts have no src
+    setResourceLink( tag.find( "src" ), "bres://" );
+  }
+  else if ( tag.is( "img" ) || tag.is( "source" ) || tag.is( "audio" ) || tag.is( "video" ) ) {
+    setResourceLink( tag.find( "src" ), tag.is( "source" ) ? "gdvideo://" : "bres://" );
 
-      // convert <img src="bres://{id}/a.png" srcset="a-1x.png 1x, b-2x.png 2x, c.png">
-      // into    <img src="bres://{id}/a.png" srcset="bres://{id}/a-1x.png 1x,bres://{id}/b-2x.png 2x,bres://{id}/c.png">
+    // convert <img src="bres://{id}/a.png" srcset="a-1x.png 1x, b-2x.png 2x, c.png">
+    // into    <img src="bres://{id}/a.png" srcset="bres://{id}/a-1x.png 1x,bres://{id}/b-2x.png 2x,bres://{id}/c.png">
+    Attribute * srcset = tag.find( "srcset" );
 
-      if ( linkType.compare( "img" ) == 0 ) {
-        match = RX::Mdx::srcset.match( newLink ); // have to use newLink since linkTxt may already be modified
-        if ( match.hasMatch() ) {
-          auto srcsetOriginalText   = match.captured( "text" );
-          QStringList srcsetNewText = {};
+    if ( !srcset ) {
+      return;
+    }
 
-          auto ImageList = srcsetOriginalText.split( u',', Qt::SkipEmptyParts );
+    string newSrcset;
+    std::string_view images = srcset->value;
 
-          for ( auto & img : ImageList ) {
-            auto imgPair = img.split( RX::whiteSpace );
+    while ( !images.empty() ) {
+      size_t const comma   = images.find( ',' );
+      std::string_view img = images.substr( 0, comma );
+      images.remove_prefix( comma == std::string_view::npos ? images.size() : comma + 1 );
 
-            if ( !imgPair.empty() && !imgPair.at( 0 ).contains( "//" ) ) {
-              if ( imgPair.length() == 1 ) {
-                srcsetNewText.append( QString( R"(bres://%1/%2)" ).arg( id, imgPair.at( 0 ) ) );
-              }
-              else if ( imgPair.length() == 2 ) {
-                srcsetNewText.append( QString( R"(bres://%1/%2 %3)" ).arg( id, imgPair.at( 0 ), imgPair.at( 1 ) ) );
-              }
-            }
-          }
+      img.remove_prefix( std::min( img.find_first_not_of( " \t\r\n" ), img.size() ) );
+      img = img.substr( 0, img.find_last_not_of( " \t\r\n" ) + 1 );
 
-          newLink.replace( match.capturedStart(),
-                           match.capturedLength(),
-                           match.captured( "before" ) % srcsetNewText.join( ',' ) % match.captured( "after" ) );
-        }
+      if ( img.empty() ) {
+        continue;
       }
 
-      if ( linkType.compare( "object" ) == 0 ) {
-        match = RX::Mdx::objectdata.match( newLink );
-        if ( match.hasMatch() ) {
-          auto srcsetOriginalText = match.captured( "text" );
-          QString srcsetNewText;
-          if ( !srcsetOriginalText.contains( "//" ) ) {
-            srcsetNewText = QString( R"(bres://%1/%2)" ).arg( id, srcsetOriginalText );
-          }
+      if ( !newSrcset.empty() ) {
+        newSrcset.push_back( ',' );
+      }
 
-          newLink.replace( match.capturedStart(),
-                           match.capturedLength(),
-                           match.captured( "before" ) % srcsetNewText % match.captured( "after" ) );
-        }
+      if ( img.find( "//" ) == std::string_view::npos ) {
+        newSrcset += "bres://" + id + "/";
       }
-    }
 
-    if ( !newLink.isEmpty() ) {
-      articleNewText += newLink;
-    }
-    else {
-      articleNewText += allLinksMatch.captured();
+      newSrcset.append( img );
     }
+
+    srcset->set( std::move( newSrcset ) );
   }
-  if ( linkPos ) {
-    articleNewText += article.mid( linkPos );
-    article = articleNewText;
+  else if ( tag.is( "object" ) ) {
+    Attribute * data = tag.find( "data" );
+
+    if ( data && !data->value.empty() && data->value.find( "//" ) == std::string_view::npos ) {
+      data->set( "bres://" + id + "/" + string( data->value ) );
+    }
   }
 }
 
-void MdxDictionary::replaceStyleInHtml( QString & id, QString & article )
+void MdxLinkRewriter::handleStyle( std::string_view css, string & out )
 {
-  //article = article.replace( RX::Mdx::fontFace, "src:url(\"bres://" + id + "/" + "\\1\")" );
-  QString articleNewText;
-  int linkPos                        = 0;
-  QRegularExpressionMatchIterator it = RX::Mdx::styleElement.globalMatch( article );
-  while ( it.hasNext() ) {
-    QRegularExpressionMatch allLinksMatch = it.next();
+  // url("font.ttf") -> url("bres://{id}/font.ttf"), remote urls are skipped
+  size_t copied = 0;
+  size_t pos    = 0;
 
-    if ( allLinksMatch.capturedEnd() < linkPos ) {
+  while ( pos < css.size() ) {
+    if ( !Html::startsWithIgnoreCase( css.substr( pos ), "url" ) ) {
+      ++pos;
       continue;
     }
 
-    articleNewText += article.mid( linkPos, allLinksMatch.capturedStart() - linkPos );
-    linkPos = allLinksMatch.capturedEnd();
-
-    articleNewText += allLinksMatch.captured( 1 );
+    size_t p = css.find_first_not_of( " \t\r\n", pos + 3 );
+    if ( p == std::string_view::npos || css[ p ] != '(' ) {
+      pos += 3;
+      continue;
+    }
 
-    // the style
-    auto style = allLinksMatch.captured( 2 );
-    replaceFontLinks( id, style );
-    articleNewText += style;
-    articleNewText += allLinksMatch.captured( 3 );
-  }
-  if ( linkPos ) {
-    articleNewText += article.mid( linkPos );
-    article = articleNewText;
-  }
-}
+    p = css.find_first_not_of( " \t\r\n", p + 1 );
+    if ( p == std::string_view::npos || css[ p ] != '"' ) {
+      pos += 3;
+      continue;
+    }
 
-void MdxDictionary::replaceFontLinks( QString & id, QString & article )
-{
-  //article = article.replace( RX::Mdx::fontFace, "src:url(\"bres://" + id + "/" + "\\1\")" );
-  QString articleNewText;
-  int linkPos                        = 0;
-  QRegularExpressionMatchIterator it = RX::Mdx::fontFace.globalMatch( article );
-  while ( it.hasNext() ) {
-    QRegularExpressionMatch allLinksMatch = it.next();
+    size_t const urlEnd = css.find( '"', p + 1 );
+    size_t const end    = urlEnd == std::string_view::npos ? urlEnd : css.find_first_not_of( " \t\r\n", urlEnd + 1 );
 
-    if ( allLinksMatch.capturedEnd() < linkPos ) {
+    if ( end == std::string_view::npos || css[ end ] != ')' ) {
+      pos += 3;
       continue;
     }
 
-    articleNewText += article.mid( linkPos, allLinksMatch.capturedStart() - linkPos );
-    linkPos          = allLinksMatch.capturedEnd();
-    QString linkTxt  = allLinksMatch.captured();
-    QString linkType = allLinksMatch.captured( 1 );
-    QString newLink  = linkTxt;
+    std::string_view const url = css.substr( p + 1, urlEnd - p - 1 );
 
-    //skip remote url
-    if ( !linkType.contains( ":" ) ) {
-      newLink = QString( "url(\"bres://%1/%2\")" ).arg( id, linkType );
+    if ( url.find( ':' ) == std::string_view::npos ) {
+      out.append( css.substr( copied, pos - copied ) );
+      out += "url(\"bres://" + id + "/" + string( url ) + "\")";
+      copied = end + 1;
     }
-    articleNewText += newLink;
-  }
-  if ( linkPos ) {
-    articleNewText += article.mid( linkPos );
-    article = articleNewText;
+
+    pos = end + 1;
   }
+
+  out.append( css.substr( copied ) );
+}
+
+} // namespace
+
+void MdxDictionary::filterResource( std::string_view article, string & result )
+{
+  MdxLinkRewriter( getId() ).rewrite( article, result );
 }
 
 
@@ -1210,6 +1229,22 @@ QString MdxDictionary::getCachedFileName( QString filename )
 }
 
 void MdxDictionary::loadResourceFile( const wstring & resourceName, vector< char > & data )
+{
+  QFile localFile;
+  QByteArray block;
+  const char * resource;
+  size_t size;
+
+  if ( findResource( resourceName, localFile, block, resource, size ) ) {
+    data.assign( resource, resource + size );
+  }
+}
+
+bool MdxDictionary::findResource( const wstring & resourceName,
+                                  QFile & localFile,
+                                  QByteArray & block,
+                                  const char *& resource,
+                                  size_t & size )
 {
   wstring newResourceName = resourceName;
   string u8ResourceName   = Utf8::encode( resourceName );
@@ -1224,14 +1259,24 @@ void MdxDictionary::loadResourceFile( const wstring & resourceName, vector< char
   }
   // local file takes precedence
   if ( string fn = getContainingFolder().toStdString() + Utils::Fs::separator() + u8ResourceName; File::exists( fn ) ) {
-    File::loadFromFile( fn, data );
-    return;
+    // Mapped, so that it's only read as its parts are used
+    localFile.setFileName( QString::fromStdString( fn ) );
+    if ( !localFile.open( QFile::ReadOnly ) ) {
+      return false;
+    }
+
+    size     = localFile.size();
+    resource = size ? (const char *)localFile.map( 0, size ) : nullptr;
+    return resource != nullptr;
   }
   for ( const auto & mddResource : mddResources ) {
-    if ( mddResource->loadFile( newResourceName, data ) ) {
-      break;
+    size_t offset;
+    if ( mddResource->findFile( newResourceName, block, offset, size ) ) {
+      resource = block.constData() + offset;
+      return true;
     }
   }
+  return false;
 }
 
 static void addEntryToIndex( QString const & word, uint32_t offset, IndexedWords & indexedWords )
@@ -13,6 +13,7 @@
 #include "wstring_qt.hh"
 #include "ftshelpers.hh"
 #include "htmlescape.hh"
+#include "htmlrewriter.hh"
 #include "filetype.hh"
 #include "tiff.hh"
 #include "utils.hh"
@@ -23,6 +24,7 @@
 
 #include "iconv.hh"
 
+#include <QCache>
 #include <QString>
 #include <QFile>
 #include <QFileInfo>
@@ -31,14 +33,15 @@
 #include <QProcess>
 #include <QList>
 
-#include <QRegularExpression>
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 #include <map>
 #include <set>
 #include <algorithm>
+#include <atomic>
 
 namespace Slob {
 
@@ -105,6 +108,13 @@ bool indexIsOldOrBad( string const & indexFile )
     || header.formatVersion != CurrentFormatVersion;
 }
 
+/// Memory limit for the decompressed items kept per file
+static std::atomic< size_t > itemCacheSize( 16 * 1024 * 1024 );
+
+void setItemCacheSize( size_t bytes )
+{
+  itemCacheSize.store( bytes, std::memory_order_relaxed );
+}
 
 class SlobFile
 {
@@ -112,6 +122,21 @@ public:
   typedef std::pair< quint64, quint32 > RefEntryOffsetItem;
   typedef QList< RefEntryOffsetItem > RefOffsetsVector;
 
+  /// A decompressed item, which packs the data of several bins
+  struct Item
+  {
+    QList< quint8 > contentIds; // One per bin
+    string data;
+  };
+
+  /// The data of a single bin. It's a view into the decompressed item, which
+  /// is kept alive for as long as this is.
+  struct BinData
+  {
+    sptr< Item const > item;
+    std::string_view data;
+  };
+
 private:
   enum Compressions {
     UNKNOWN = 0,
@@ -132,9 +157,8 @@ private:
   quint64 storeOffset, fileSize, refsOffset;
   quint32 refsCount, itemsCount;
   quint64 itemsOffset, itemsDataOffset;
-  quint32 currentItem;
   quint32 contentTypesCount;
-  string currentItemData;
+  QCache< quint32, sptr< Item const > > items; // Recently used items, by their index
   RefOffsetsVector refsOffsetVector;
 
   QString readTinyText();
@@ -142,6 +166,10 @@ private:
   QString readLargeText();
   QString readString( unsigned length );
 
+  /// Reads the item with the given index. Its data is only read and
+  /// decompressed if requested.
+  sptr< Item > readItem( quint32 itemIndex, bool withData );
+
 public:
   SlobFile():
     compression( UNKNOWN ),
@@ -153,8 +181,8 @@ public:
     itemsCount( 0 ),
     itemsOffset( 0 ),
     itemsDataOffset( 0 ),
-    currentItem( 0xFFFFFFFF ),
-    contentTypesCount( 0 )
+    contentTypesCount( 0 ),
+    items( itemCacheSize.load( std::memory_order_relaxed ) )
   {
   }
 
@@ -218,7 +246,9 @@ public:
 
   void getRefEntry( quint32 ref_nom, RefEntry & entry );
 
-  quint8 getItem( RefEntry const & entry, string * data );
+  /// Returns the content type id of the given entry's bin, or 0xFF if it's
+  /// not valid. If data is given, the bin's data is stored there.
+  quint8 getItem( RefEntry const & entry, BinData * data );
 };
 
 SlobFile::~SlobFile()
@@ -495,11 +525,13 @@ void SlobFile::getRefEntry( quint32 ref_nom, RefEntry & entry )
   throw exCantReadFile( string( error.toUtf8().data() ) );
 }
 
-quint8 SlobFile::getItem( RefEntry const & entry, string * data )
+sptr< SlobFile::Item > SlobFile::readItem( quint32 itemIndex, bool withData )
 {
-  quint64 pos = itemsOffset + entry.itemIndex * sizeof( quint64 );
+  quint64 pos = itemsOffset + itemIndex * sizeof( quint64 );
   quint64 offset, tmp;
 
+  auto item = std::make_shared< Item >();
+
   for ( ;; ) {
     // Read item data types
 
@@ -519,84 +551,106 @@ quint8 SlobFile::getItem( RefEntry const & entry, string * data )
     }
     bins = qFromBigEndian( bins_be );
 
-    if ( entry.binIndex >= bins ) {
-      return 0xFF;
-    }
-
-    QList< quint8 > ids;
-    ids.resize( bins );
-    if ( file.read( (char *)ids.data(), bins ) != bins ) {
+    item->contentIds.resize( bins );
+    if ( file.read( (char *)item->contentIds.data(), bins ) != bins ) {
       break;
     }
 
-    quint8 id = ids[ entry.binIndex ];
+    if ( withData ) {
+      // Read item data
+      quint32 length, length_be;
+      if ( file.read( (char *)&length_be, sizeof( length_be ) ) != sizeof( length_be ) ) {
+        break;
+      }
+      length = qFromBigEndian( length_be );
+
+      QByteArray compressedData = file.read( length );
 
-    if ( id >= (unsigned)contentTypes.size() ) {
-      return 0xFF;
+      if ( compression == NONE ) {
+        item->data = string( compressedData.data(), compressedData.length() );
+      }
+      else if ( compression == ZLIB ) {
+        item->data = decompressZlib( compressedData.data(), length );
+      }
+      else if ( compression == BZ2 ) {
+        item->data = decompressBzip2( compressedData.data(), length );
+      }
+      else {
+        item->data = decompressLzma2( compressedData.data(), length, true );
+      }
     }
 
-    if ( data != 0 ) {
-      // Read item data
-      if ( currentItem != entry.itemIndex ) {
-        currentItemData.clear();
-        quint32 length, length_be;
-        if ( file.read( (char *)&length_be, sizeof( length_be ) ) != sizeof( length_be ) ) {
-          break;
-        }
-        length = qFromBigEndian( length_be );
+    return item;
+  }
+  QString error = fileName + ": " + file.errorString();
+  throw exCantReadFile( string( error.toUtf8().data() ) );
+}
 
-        QByteArray compressedData = file.read( length );
+quint8 SlobFile::getItem( RefEntry const & entry, BinData * data )
+{
+  sptr< Item const > item;
 
-        if ( compression == NONE ) {
-          currentItemData = string( compressedData.data(), compressedData.length() );
-        }
-        else if ( compression == ZLIB ) {
-          currentItemData = decompressZlib( compressedData.data(), length );
-        }
-        else if ( compression == BZ2 ) {
-          currentItemData = decompressBzip2( compressedData.data(), length );
-        }
-        else {
-          currentItemData = decompressLzma2( compressedData.data(), length, true );
-        }
+  if ( sptr< Item const > * cached = items.object( entry.itemIndex ) ) {
+    item = *cached;
+  }
+  else {
+    item = readItem( entry.itemIndex, data != nullptr );
 
-        if ( currentItemData.empty() ) {
-          currentItem = 0xFFFFFFFF;
-          return 0xFF;
-        }
-        currentItem = entry.itemIndex;
-      }
+    // QCache takes the ownership and drops the entry right away if it exceeds the budget.
+    // The budget can be changed at any time, so it's brought up to date first.
+    if ( !item->data.empty() ) {
+      items.setMaxCost( itemCacheSize.load( std::memory_order_relaxed ) );
+      items.insert( entry.itemIndex, new sptr< Item const >( item ), item->data.size() );
+    }
+  }
 
-      // Find bin data inside item
+  if ( entry.binIndex >= (unsigned)item->contentIds.size() ) {
+    return 0xFF;
+  }
 
-      const char * ptr = currentItemData.c_str();
-      quint32 pos      = entry.binIndex * sizeof( quint32 );
+  quint8 id = item->contentIds[ entry.binIndex ];
 
-      if ( pos >= currentItemData.length() - sizeof( quint32 ) ) {
-        return 0xFF;
-      }
+  if ( id >= (unsigned)contentTypes.size() ) {
+    return 0xFF;
+  }
 
-      quint32 offset, offset_be;
-      memcpy( &offset_be, ptr + pos, sizeof( offset_be ) );
-      offset = qFromBigEndian( offset_be );
+  if ( data != 0 ) {
+    string const & itemData = item->data;
 
-      pos = bins * sizeof( quint32 ) + offset;
+    if ( itemData.empty() ) {
+      return 0xFF;
+    }
 
-      if ( pos >= currentItemData.length() - sizeof( quint32 ) ) {
-        return 0xFF;
-      }
+    // Find bin data inside item
+
+    const char * ptr = itemData.c_str();
+    quint32 pos      = entry.binIndex * sizeof( quint32 );
 
-      quint32 length, len_be;
-      memcpy( &len_be, ptr + pos, sizeof( len_be ) );
-      length = qFromBigEndian( len_be );
+    if ( pos >= itemData.length() - sizeof( quint32 ) ) {
+      return 0xFF;
+    }
 
-      *data = currentItemData.substr( pos + sizeof( len_be ), length );
+    quint32 offset, offset_be;
+    memcpy( &offset_be, ptr + pos, sizeof( offset_be ) );
+    offset = qFromBigEndian( offset_be );
+
+    pos = item->contentIds.size() * sizeof( quint32 ) + offset;
+
+    if ( pos >= itemData.length() - sizeof( quint32 ) ) {
+      return 0xFF;
     }
 
-    return ids[ entry.binIndex ];
+    quint32 length, len_be;
+    memcpy( &len_be, ptr + pos, sizeof( len_be ) );
+    length = qFromBigEndian( len_be );
+
+    pos += sizeof( len_be );
+
+    data->item = item;
+    data->data = std::string_view( ptr + pos, std::min< size_t >( length, itemData.length() - pos ) );
   }
-  QString error = fileName + ": " + file.errorString();
-  throw exCantReadFile( string( error.toUtf8().data() ) );
+
+  return id;
 }
 
 // SlobDictionary
@@ -662,6 +716,8 @@ public:
   getSearchResults( QString const & searchString, int searchMode, bool matchCase, bool ignoreDiacritics ) override;
   void getArticleText( uint32_t articleAddress, QString & headword, QString & text ) override;
 
+  void sortInStorageOrder( vector< uint32_t > & articleAddresses ) override;
+
   quint64 getArticlePos( uint32_t articleNumber );
 
   void makeFTSIndex( QAtomicInt & isCancelled ) override;
@@ -791,79 +847,140 @@ void SlobDictionary::loadArticle( quint32 address, string & articleText )
   articleText = prefix + articleText + cleaner + "</div>";
 }
 
-string SlobDictionary::convert( const string & in, RefEntry const & entry )
+namespace {
+
+/// Returns true for links with data or an external resource
+bool isExternalResource( std::string_view url )
+{
+  for ( std::string_view scheme : { "data:", "http:", "https:", "ftp:" } ) {
+    if ( Html::startsWithIgnoreCase( url, scheme ) ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/// Points the resource links to the dictionary and the article links to
+/// the lookups
+class SlobLinkRewriter: public Html::Rewriter
 {
-  QString text = QString::fromUtf8( in.c_str() );
+  string const & id;
+
+public:
+
+  explicit SlobLinkRewriter( string const & id ):
+    id( id )
+  {
+  }
+
+protected:
+
+  void handleTag( Tag & tag ) override;
+};
 
-  // pattern of img and script
-  text.replace( QRegularExpression( "<\\s*(img|script)\\s+([^>]*)src=\"(?!(?:data|https?|ftp):)(|/)([^\"]*)\"" ),
-                QString( R"(<\1 \2src="bres://%1/\4")" ).arg( getId().c_str() ) );
+void SlobLinkRewriter::handleTag( Tag & tag )
+{
+  if ( tag.is( "img" ) || tag.is( "script" ) ) {
+    Attribute * src = tag.find( "src" );
 
-  // pattern <link... href="..." ...>
-  text.replace( QRegularExpression( R"(<\s*link\s+([^>]*)href="(?!(?:data|https?|ftp):))" ),
-                QString( "<link \\1href=\"bres://%1/" ).arg( getId().c_str() ) );
+    if ( src && !isExternalResource( src->value ) ) {
+      std::string_view url = src->value;
 
-  // pattern <a href="..." ...>, excluding any known protocols such as http://, mailto:, #(comment)
-  // these links will be translated into local definitions
-  QString anchor;
-  QRegularExpression rxLink(
-    R"lit(<\s*a\s+([^>]*)href="(?!(?:\w+://|#|mailto:|tel:))(/|)([^"]*)"\s*(title="[^"]*")?[^>]*>)lit" );
-  QRegularExpressionMatchIterator it = rxLink.globalMatch( text );
-  int pos                            = 0;
-  QString newText;
-  while ( it.hasNext() ) {
-    QRegularExpressionMatch match = it.next();
+      if ( !url.empty() && url[ 0 ] == '/' ) {
+        url.remove_prefix( 1 );
+      }
 
-    newText += text.mid( pos, match.capturedStart() - pos );
-    pos = match.capturedEnd();
+      src->set( "bres://" + id + "/" + string( url ) );
+    }
+  }
+  else if ( tag.is( "link" ) ) {
+    Attribute * href = tag.find( "href" );
 
-    QStringList list = match.capturedTexts();
-    // Add empty strings for compatibility with regex behaviour
-    for ( int i = match.lastCapturedIndex() + 1; i < 5; i++ ) {
-      list.append( QString() );
+    if ( href && !isExternalResource( href->value ) ) {
+      href->set( "bres://" + id + "/" + string( href->value ) );
     }
+  }
+  else if ( tag.is( "a" ) ) {
+    // Links without a known protocol are turned into local definitions
+    Attribute * href = tag.find( "href" );
 
-    QString tag = list[ 3 ];
-    if ( !list[ 4 ].isEmpty() ) {
-      tag = list[ 4 ].split( "\"" )[ 1 ];
+    if ( !href || Html::hasSchemeSlashes( href->value ) || href->value.substr( 0, 1 ) == "#"
+         || Html::startsWithIgnoreCase( href->value, "mailto:" )
+         || Html::startsWithIgnoreCase( href->value, "tel:" ) ) {
+      return;
     }
 
-    // Find anchor
-    int n = list[ 3 ].indexOf( '#' );
-    if ( n > 0 ) {
-      anchor = QString( "?gdanchor=" ) + list[ 3 ].mid( n + 1 );
-      tag.remove( list[ 3 ].mid( n ) );
+    std::string_view url = href->value;
+
+    if ( !url.empty() && url[ 0 ] == '/' ) {
+      url.remove_prefix( 1 );
     }
-    else {
-      anchor.clear();
+
+    // The title holds the name of the article the link points to, if there's one
+    Attribute const * title = tag.find( "title" );
+    string name( title ? title->value : url );
+    string anchor;
+
+    size_t const n = url.find( '#' );
+    if ( n != std::string_view::npos && n > 0 ) {
+      anchor = "?gdanchor=" + string( url.substr( n + 1 ) );
+
+      size_t const pos = name.find( url.substr( n ) );
+      if ( pos != string::npos ) {
+        name.erase( pos, url.size() - n );
+      }
     }
 
-    tag.remove( QRegularExpression( ".*/" ) )
-      .remove( QRegularExpression( "\\.(s|)htm(l|)$", QRegularExpression::PatternOption::CaseInsensitiveOption ) )
-      .replace( "_", "%20" )
-      .prepend( "<a href=\"gdlookup://localhost/" )
-      .append( anchor + "\" " + list[ 4 ] + ">" );
+    // Only the file name is left, without the .html extension
+    size_t const slash = name.rfind( '/' );
+    if ( slash != string::npos ) {
+      name.erase( 0, slash + 1 );
+    }
 
-    newText += tag;
-  }
-  if ( pos ) {
-    newText += text.mid( pos );
-    text = newText;
+    for ( std::string_view extension : { ".html", ".htm", ".shtml", ".shtm" } ) {
+      if ( name.size() >= extension.size()
+           && Html::startsWithIgnoreCase( std::string_view( name ).substr( name.size() - extension.size() ),
+                                          extension ) ) {
+        name.resize( name.size() - extension.size() );
+        break;
+      }
+    }
+
+    string link = "gdlookup://localhost/";
+    for ( char ch : name ) {
+      if ( ch == '_' ) {
+        link += "%20";
+      }
+      else {
+        link.push_back( ch );
+      }
+    }
+
+    href->set( link + anchor );
   }
-  newText.clear();
+}
+
+} // namespace
+
+string SlobDictionary::convert( const string & in, RefEntry const & entry )
+{
+  string text;
 
 #ifdef Q_OS_WIN32
   // Increase equations scale
-  text = QString::fromLatin1( "<script type=\"text/x-mathjax-config\">MathJax.Hub.Config({" )
+  text = string( "<script type=\"text/x-mathjax-config\">MathJax.Hub.Config({" )
     + " SVG: { scale: 170, linebreaks: { automatic:true } }"
     + ", \"HTML-CSS\": { scale: 210, linebreaks: { automatic:true } }"
-    + ", CommonHTML: { scale: 210, linebreaks: { automatic:true } }" + " });</script>" + text;
+    + ", CommonHTML: { scale: 210, linebreaks: { automatic:true } }" + " });</script>";
 #endif
 
+  SlobLinkRewriter( getId() ).rewrite( in, text );
+
   // Fix outstanding elements
   text += "<br style=\"clear:both;\" />";
 
-  return text.toUtf8().data();
+  return text;
 }
 
 void SlobDictionary::loadResource( std::string & resourceName, string & data )
@@ -882,7 +999,7 @@ void SlobDictionary::loadResource( std::string & resourceName, string & data )
 
 quint32 SlobDictionary::readArticle( quint32 articleNumber, std::string & result, RefEntry & entry )
 {
-  string data;
+  SlobFile::BinData bin;
   quint8 contentId;
 
   {
@@ -890,9 +1007,11 @@ quint32 SlobDictionary::readArticle( quint32 articleNumber, std::string & result
     if ( entry.key.isEmpty() ) {
       sf.getRefEntry( articleNumber, entry );
     }
-    contentId = sf.getItem( entry, &data );
+    contentId = sf.getItem( entry, &bin );
   }
 
+  std::string_view const & data = bin.data;
+
   if ( contentId == 0xFF ) {
     return 0xFFFFFFFF;
   }
@@ -915,7 +1034,7 @@ quint32 SlobDictionary::readArticle( quint32 articleNumber, std::string & result
     result = string( content.toUtf8().data() );
   }
   else {
-    result = data;
+    result.assign( data.data(), data.size() );
   }
 
   return contentId;
@@ -931,6 +1050,31 @@ quint64 SlobDictionary::getArticlePos( uint32_t articleNumber )
   return ( ( (quint64)( entry.binIndex ) ) << 32 ) | entry.itemIndex;
 }
 
+void SlobDictionary::sortInStorageOrder( vector< uint32_t > & articleAddresses )
+{
+  // The refs are sorted by key, while the items they point to are compressed
+  // in bins in any order
+  vector< std::pair< quint64, uint32_t > > positions;
+  positions.reserve( articleAddresses.size() );
+
+  {
+    QMutexLocker _( &slobMutex );
+
+    RefEntry entry;
+
+    for ( uint32_t address : articleAddresses ) {
+      sf.getRefEntry( address, entry );
+      positions.emplace_back( ( (quint64)entry.itemIndex << 16 ) | entry.binIndex, address );
+    }
+  }
+
+  std::sort( positions.begin(), positions.end() );
+
+  for ( size_t x = 0; x < positions.size(); ++x ) {
+    articleAddresses[ x ] = positions[ x ].second;
+  }
+}
+
 void SlobDictionary::makeFTSIndex( QAtomicInt & isCancelled )
 {
   if ( !( Dictionary::needToRebuildIndex( getDictionaryFilenames(), ftsIdxName )
@@ -14,6 +14,10 @@ vector< sptr< Dictionary::Class > > makeDictionaries( vector< string > const & f
                                                       Dictionary::Initializing &,
                                                       unsigned maxHeadwordsToExpand );
 
+/// Sets the memory limit for the decompressed items cached for each of the
+/// opened files, in bytes. Zero disables the cache.
+void setItemCacheSize( size_t bytes );
+
 } // namespace Slob
 
 #endif // __SLOB_HH_INCLUDED__
@@ -14,6 +14,7 @@
 #include "utils.hh"
 
 #include <set>
+#include <cstring>
 #include <QDir>
 #include <QFileInfo>
 #include <QDirIterator>
@@ -183,8 +184,8 @@ sptr< Dictionary::DataRequest > SoundDirDictionary::getArticle( wstring const &
   multimap< wstring, uint32_t >::const_iterator i;
 
   string displayedName;
-  vector< char > chunk;
-  char * nameBlock;
+  ChunkedStorage::Reader::Chunk chunk;
+  char const * nameBlock;
 
   result += "<table class=\"lsa_play\">";
 
@@ -199,14 +200,14 @@ sptr< Dictionary::DataRequest > SoundDirDictionary::getArticle( wstring const &
         QMutexLocker _( &idxMutex );
         nameBlock = chunks.getBlock( address, chunk );
 
-        if ( nameBlock >= &chunk.front() + chunk.size() ) {
+        if ( nameBlock >= chunk->data() + chunk->size() ) {
           // chunks reader thinks it's okay since zero-sized records can exist,
           // but we don't allow that.
           throw ChunkedStorage::exAddressOutOfRange();
         }
 
-        chunk.back()  = 0; // It must end with 0 anyway, but just in case
-        displayedName = string( nameBlock );
+        // It must end with 0 anyway, but just in case
+        displayedName = string( nameBlock, strnlen( nameBlock, chunk->data() + chunk->size() - nameBlock ) );
       }
       catch ( ChunkedStorage::exAddressOutOfRange & ) {
         // Bad address
@@ -247,14 +248,14 @@ sptr< Dictionary::DataRequest > SoundDirDictionary::getArticle( wstring const &
         QMutexLocker _( &idxMutex );
         nameBlock = chunks.getBlock( address, chunk );
 
-        if ( nameBlock >= &chunk.front() + chunk.size() ) {
+        if ( nameBlock >= chunk->data() + chunk->size() ) {
           // chunks reader thinks it's okay since zero-sized records can exist,
           // but we don't allow that.
           throw ChunkedStorage::exAddressOutOfRange();
         }
 
-        chunk.back()  = 0; // It must end with 0 anyway, but just in case
-        displayedName = string( nameBlock );
+        // It must end with 0 anyway, but just in case
+        displayedName = string( nameBlock, strnlen( nameBlock, chunk->data() + chunk->size() - nameBlock ) );
       }
       catch ( ChunkedStorage::exAddressOutOfRange & ) {
         // Bad address
@@ -313,15 +314,15 @@ void SoundDirDictionary::loadIcon() noexcept
 
 bool SoundDirDictionary::get_file_name( uint32_t articleOffset, QString & file_name )
 {
-  vector< char > chunk;
-  char * articleData;
+  ChunkedStorage::Reader::Chunk chunk;
+  char const * articleData;
 
   try {
     QMutexLocker _( &idxMutex );
 
     articleData = chunks.getBlock( articleOffset, chunk );
 
-    if ( articleData >= &chunk.front() + chunk.size() ) {
+    if ( articleData >= chunk->data() + chunk->size() ) {
       // chunks reader thinks it's okay since zero-sized records can exist,
       // but we don't allow that.
       throw ChunkedStorage::exAddressOutOfRange();
@@ -331,8 +332,8 @@ bool SoundDirDictionary::get_file_name( uint32_t articleOffset, QString & file_n
     return false; // No such resource
   }
 
-  chunk.back() = 0; // It must end with 0 anyway, but just in case
-  file_name    = QString::fromUtf8( articleData );
+  // It must end with 0 anyway, but just in case
+  file_name = QString::fromUtf8( articleData, strnlen( articleData, chunk->data() + chunk->size() - articleData ) );
   return true;
 }
 
@@ -135,7 +135,6 @@ class StardictDictionary: public BtreeIndexing::BtreeDictionary
   string bookName;
   string sameTypeSequence;
   ChunkedStorage::Reader chunks;
-  QMutex dzMutex;
   dictData * dz;
   QMutex resourceZipMutex;
   IndexedZip resourceZip;
@@ -197,6 +196,8 @@ public:
   getSearchResults( QString const & searchString, int searchMode, bool matchCase, bool ignoreDiacritics ) override;
   void getArticleText( uint32_t articleAddress, QString & headword, QString & text ) override;
 
+  void sortInStorageOrder( vector< uint32_t > & articleAddresses ) override;
+
   void makeFTSIndex( QAtomicInt & isCancelled ) override;
 
   void setFTSParameters( Config::FullTextSearch const & fts ) override
@@ -320,11 +321,11 @@ void StardictDictionary::getArticleProps( uint32_t articleAddress,
                                           uint32_t & offset,
                                           uint32_t & size )
 {
-  vector< char > chunk;
+  ChunkedStorage::Reader::Chunk chunk;
 
   QMutexLocker _( &idxMutex );
 
-  char * articleData = chunks.getBlock( articleAddress, chunk );
+  char const * articleData = chunks.getBlock( articleAddress, chunk );
 
   memcpy( &offset, articleData, sizeof( uint32_t ) );
   articleData += sizeof( uint32_t );
@@ -920,14 +921,8 @@ void StardictDictionary::loadArticle( uint32_t address, string & headword, strin
 
   getArticleProps( address, headword, offset, size );
 
-  char * articleBody;
-
-  {
-    QMutexLocker _( &dzMutex );
-
-    // Note that the function always zero-pads the result.
-    articleBody = dict_data_read_( dz, offset, size, 0, 0 );
-  }
+  // Note that the function always zero-pads the result.
+  char * articleBody = dict_data_read_( dz, offset, size, 0, 0 );
 
   if ( !articleBody ) {
     //    throw exCantReadFile( getDictionaryFilenames()[ 2 ] );
@@ -1180,6 +1175,28 @@ void StardictDictionary::getArticleText( uint32_t articleAddress, QString & head
   }
 }
 
+void StardictDictionary::sortInStorageOrder( vector< uint32_t > & articleAddresses )
+{
+  // The addresses follow the .idx file, which is sorted by headword, while
+  // the .dict file can have the articles in any order
+  vector< std::pair< uint32_t, uint32_t > > positions;
+  positions.reserve( articleAddresses.size() );
+
+  string headword;
+  uint32_t offset, size;
+
+  for ( uint32_t address : articleAddresses ) {
+    getArticleProps( address, headword, offset, size );
+    positions.emplace_back( offset, address );
+  }
+
+  std::sort( positions.begin(), positions.end() );
+
+  for ( size_t x = 0; x < positions.size(); ++x ) {
+    articleAddresses[ x ] = positions[ x ].second;
+  }
+}
+
 sptr< Dictionary::DataRequest > StardictDictionary::getSearchResults( QString const & searchString,
                                                                       int searchMode,
                                                                       bool matchCase,
@@ -1848,8 +1865,6 @@ static void handleIdxSynFile( string const & fileName,
       indexedWords.addSingleWord( Utf8::decode( word ), offset );
     }
   }
-
-  GD_DPRINTF( "%u entires made\n", (unsigned)indexedWords.size() );
 }
 
 
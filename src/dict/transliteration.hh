@@ -31,6 +31,11 @@ public:
 
   virtual map< Dictionary::Property, string > getProperties() noexcept;
 
+  virtual Dictionary::Features getFeatures() const noexcept
+  {
+    return Dictionary::ArticlesIgnoreAlts;
+  }
+
   virtual unsigned long getArticleCount() noexcept;
 
   virtual unsigned long getWordCount() noexcept;
@@ -139,7 +139,10 @@
 
 #include <sys/stat.h>
 
-#define USE_CACHE 1
+#ifndef __WIN32
+  #include <pthread.h>
+  #include <unistd.h>
+#endif
 
 #define dict_data_filter( ... )
 #define PRINTF( ... )
@@ -270,6 +273,134 @@ static void err_internal( const char * routine, const char * format, ... )
   #endif
 #endif
 
+/* The process-wide cache of decompressed chunks. The chunks of all the
+   opened files are kept in a single LRU list limited by cacheMaxBytes, and
+   each file points to its own cached chunks. Everything here is protected
+   by cacheLock, which is never held during the actual reading or inflation. */
+
+#ifdef __WIN32
+static SRWLOCK cacheLock = SRWLOCK_INIT;
+  #define CACHE_LOCK()   AcquireSRWLockExclusive( &cacheLock )
+  #define CACHE_UNLOCK() ReleaseSRWLockExclusive( &cacheLock )
+#else
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+  #define CACHE_LOCK()   pthread_mutex_lock( &cacheLock )
+  #define CACHE_UNLOCK() pthread_mutex_unlock( &cacheLock )
+#endif
+
+static dictCache * cacheFirst      = NULL; /* Most recently used */
+static dictCache * cacheLast       = NULL; /* Least recently used */
+static unsigned long cacheBytes    = 0;
+static unsigned long cacheMaxBytes = 32 * 1024 * 1024;
+
+static void cache_unlink( dictCache * entry )
+{
+  if ( entry->prev ) {
+    entry->prev->next = entry->next;
+  }
+  else {
+    cacheFirst = entry->next;
+  }
+
+  if ( entry->next ) {
+    entry->next->prev = entry->prev;
+  }
+  else {
+    cacheLast = entry->prev;
+  }
+}
+
+static void cache_link_first( dictCache * entry )
+{
+  entry->prev = NULL;
+  entry->next = cacheFirst;
+
+  if ( cacheFirst ) {
+    cacheFirst->prev = entry;
+  }
+  else {
+    cacheLast = entry;
+  }
+
+  cacheFirst = entry;
+}
+
+static void cache_remove( dictCache * entry )
+{
+  cache_unlink( entry );
+  entry->owner->cache[ entry->chunk ] = NULL;
+  cacheBytes -= entry->owner->chunkLength;
+  xfree( entry->inBuffer );
+  xfree( entry );
+}
+
+/* Evicts the least recently used chunks until the cache fits the limit */
+static void cache_shrink( unsigned long limit )
+{
+  while ( cacheLast && cacheBytes > limit ) {
+    cache_remove( cacheLast );
+  }
+}
+
+void dict_data_set_cache_size( unsigned long bytes )
+{
+  CACHE_LOCK();
+  cacheMaxBytes = bytes;
+  cache_shrink( cacheMaxBytes );
+  CACHE_UNLOCK();
+}
+
+/* Sets the error string of the file. Several threads might fail at once, so
+   the string is formatted aside and only copied under the lock. */
+static void dict_data_set_error( dictData * h, const char * format, ... )
+{
+  char error[ sizeof( h->errorString ) ];
+  va_list ap;
+
+  va_start( ap, format );
+  vsnprintf( error, sizeof( error ), format, ap );
+  va_end( ap );
+
+  CACHE_LOCK();
+  strcpy( h->errorString, error );
+  CACHE_UNLOCK();
+}
+
+/* Reads exactly size bytes at the given offset. The file position isn't
+   used, so this may be called from several threads at once. Returns 0 on
+   failure. */
+static int dict_data_pread( dictData * h, void * buf, unsigned long size, unsigned long offset )
+{
+#ifdef __WIN32
+  OVERLAPPED overlapped;
+  DWORD readed = 0;
+
+  memset( &overlapped, 0, sizeof( overlapped ) );
+  overlapped.Offset     = (DWORD)offset;
+  overlapped.OffsetHigh = (DWORD)( (unsigned long long)offset >> 32 );
+
+  return ReadFile( h->fd, buf, size, &readed, &overlapped ) && readed == size;
+#else
+  char * pt = buf;
+  ssize_t count;
+
+  while ( size ) {
+    count = pread( fileno( h->fd ), pt, size, offset );
+    if ( count < 0 && errno == EINTR ) {
+      continue;
+    }
+    if ( count <= 0 ) {
+      return 0;
+    }
+    pt += count;
+    offset += count;
+    size -= count;
+  }
+
+  return 1;
+#endif
+}
+
 static enum DZ_ERRORS dict_read_header( const char * filename, dictData * header, int computeCRC )
 {
   FILE * str;
@@ -469,7 +600,6 @@ dictData * dict_data_open( const char * filename, enum DZ_ERRORS * error, int co
 {
   dictData * h = NULL;
   //   struct stat sb;
-  int j;
 
   if ( !filename ) {
     *error = DZ_ERR_OPENFILE;
@@ -486,7 +616,6 @@ dictData * dict_data_open( const char * filename, enum DZ_ERRORS * error, int co
 #ifdef __WIN32
   h->fd = INVALID_HANDLE_VALUE;
 #endif
-  h->initialized = 0;
 
   for ( ;; ) {
 #ifdef __WIN32
@@ -533,11 +662,12 @@ dictData * dict_data_open( const char * filename, enum DZ_ERRORS * error, int co
     h->size = ftell( h->fd );
 #endif
 
-    for ( j = 0; j < DICT_CACHE_SIZE; j++ ) {
-      h->cache[ j ].chunk    = -1;
-      h->cache[ j ].stamp    = -1;
-      h->cache[ j ].inBuffer = NULL;
-      h->cache[ j ].count    = 0;
+    if ( h->type == DICT_DZIP ) {
+      h->cache = calloc( h->chunkCount, sizeof( h->cache[ 0 ] ) );
+      if ( !h->cache ) {
+        *error = DZ_ERR_NOMEMORY;
+        break;
+      }
     }
 
     *error = DZ_NOERROR;
@@ -571,19 +701,42 @@ void dict_data_close( dictData * header )
     xfree( header->offsets );
 }
 
-  if ( header->initialized ) {
-    if ( inflateEnd( &header->zStream ) ) {
-      err_internal( __func__, "Cannot shut down inflation engine: %s\n", header->zStream.msg );
-}
+  if ( header->cache ) {
+    CACHE_LOCK();
+    for ( i = 0; i < header->chunkCount; ++i ) {
+      if ( header->cache[ i ] ) {
+        cache_remove( header->cache[ i ] );
+      }
+    }
+    CACHE_UNLOCK();
+    xfree( header->cache );
   }
 
-  for ( i = 0; i < DICT_CACHE_SIZE; ++i ) {
-    if ( header->cache[ i ].inBuffer ) {
-      xfree( header->cache[ i ].inBuffer );
+  xfree( header );
 }
+
+/* Copies the part of the decompressed chunk which the read needs. Returns 0
+   if the chunk turns out to be shorter than that. */
+static int dict_data_copy_chunk( dictData * h,
+                                 int chunk,
+                                 int firstChunk,
+                                 int firstOffset,
+                                 int lastChunk,
+                                 int lastOffset,
+                                 const char * inBuffer,
+                                 int count,
+                                 char ** pt )
+{
+  int from = chunk == firstChunk ? firstOffset : 0;
+  int to   = chunk == lastChunk ? lastOffset : h->chunkLength;
+
+  if ( ( chunk != lastChunk && count != h->chunkLength ) || to > count ) {
+    return 0;
   }
 
-  xfree( header );
+  memcpy( *pt, inBuffer + from, to - from );
+  *pt += to - from;
+  return 1;
 }
 
 char * dict_data_read_(
@@ -593,12 +746,14 @@ char * dict_data_read_(
   char * pt;
   unsigned long end;
   int count;
-  char * inBuffer;
   char outBuffer[ OUT_BUFFER_SIZE ];
+  char * inBuffer = NULL; /* The decompressed chunk not handed over to the cache */
+  z_stream zStream;
+  int zStreamInitialized = 0;
   int firstChunk, lastChunk;
   int firstOffset, lastOffset;
-  int i, j;
-  int found, target, lastStamp;
+  int i, copied;
+  dictCache * entry;
   (void)preFilter;
   (void)postFilter;
 
@@ -606,7 +761,7 @@ char * dict_data_read_(
 
   buffer = xmalloc( size + 1 );
   if ( !buffer ) {
-    strcpy( h->errorString, dz_error_str( DZ_ERR_NOMEMORY ) );
+    dict_data_set_error( h, "%s", dz_error_str( DZ_ERR_NOMEMORY ) );
     return 0;
   }
 
@@ -627,50 +782,17 @@ char * dict_data_read_(
 		 " or dzip format (for space savings).\n" );
       break;
 */
-      strcpy( h->errorString, "Cannot seek on pure gzip format files" );
-      xfree( buffer );
-      return 0;
-    case DICT_TEXT: {
-#ifdef __WIN32
-      long hiPtr   = 0;
-      DWORD pos    = SetFilePointer( h->fd, start, &hiPtr, FILE_BEGIN );
-      DWORD readed = 0;
-      if ( pos != INVALID_SET_FILE_POINTER || GetLastError() != NO_ERROR )
-        ReadFile( h->fd, buffer, size, &readed, 0 );
-      if ( size != readed )
-#else
-      if ( fseek( h->fd, start, SEEK_SET ) != 0 || fread( buffer, size, 1, h->fd ) != 1 )
-#endif
-      {
-        strcpy( h->errorString, dz_error_str( DZ_ERR_READFILE ) );
-        xfree( buffer );
-        return 0;
+      dict_data_set_error( h, "Cannot seek on pure gzip format files" );
+      goto fail;
+    case DICT_TEXT:
+      if ( !dict_data_pread( h, buffer, size, start ) ) {
+        dict_data_set_error( h, "%s", dz_error_str( DZ_ERR_READFILE ) );
+        goto fail;
       }
 
       buffer[ size ] = '\0';
-    } break;
+      break;
     case DICT_DZIP:
-      if ( !h->initialized ) {
-        h->zStream.zalloc    = NULL;
-        h->zStream.zfree     = NULL;
-        h->zStream.opaque    = NULL;
-        h->zStream.next_in   = 0;
-        h->zStream.avail_in  = 0;
-        h->zStream.next_out  = NULL;
-        h->zStream.avail_out = 0;
-        if ( inflateInit2( &h->zStream, -15 ) != Z_OK )
-        /*
-	    err_internal( __func__,
-			  "Cannot initialize inflation engine: %s\n",
-			  h->zStream.msg );
-*/
-        {
-          sprintf( h->errorString, "Cannot initialize inflation engine: %s", h->zStream.msg );
-          xfree( buffer );
-          return 0;
-        }
-        ++h->initialized;
-      }
       firstChunk  = start / h->chunkLength;
       firstOffset = start - firstChunk * h->chunkLength;
       lastChunk   = end / h->chunkLength;
@@ -685,158 +807,158 @@ char * dict_data_read_(
                 firstOffset,
                 lastChunk,
                 lastOffset ) );
-      for ( pt = buffer, i = firstChunk; i <= lastChunk; i++ ) {
 
-        /* Access cache */
-        found     = 0;
-        target    = 0;
-        lastStamp = INT_MAX;
-        for ( j = 0; j < DICT_CACHE_SIZE; j++ ) {
-#if USE_CACHE
-          if ( h->cache[ j ].chunk == i ) {
-            found  = 1;
-            target = j;
-            break;
-          }
-#endif
-          if ( h->cache[ j ].stamp < lastStamp ) {
-            lastStamp = h->cache[ j ].stamp;
-            target    = j;
-          }
-        }
+      if ( lastChunk >= h->chunkCount && ( lastChunk > h->chunkCount || lastOffset ) ) {
+        dict_data_set_error( h, "Read past the end of the data (%lu > %lu)", end, h->length );
+        goto fail;
+      }
 
-        h->cache[ target ].stamp = ++h->stamp;
-        if ( h->stamp < 0 ) {
-          h->stamp = 0;
-          for ( j = 0; j < DICT_CACHE_SIZE; j++ ) {
-            h->cache[ j ].stamp = -1;
-}
+      for ( pt = buffer, i = firstChunk; i <= lastChunk; i++ ) {
+        if ( i == h->chunkCount ) {
+          break; /* The read ends exactly at the end of the data */
         }
-        if ( found ) {
-          count    = h->cache[ target ].count;
-          inBuffer = h->cache[ target ].inBuffer;
+
+        /* Access cache. The chunk is copied out under the lock, since it
+           might get evicted by some other thread right afterwards. */
+        CACHE_LOCK();
+        entry = h->cache[ i ];
+        if ( entry ) {
+          cache_unlink( entry );
+          cache_link_first( entry );
+          copied =
+            dict_data_copy_chunk( h, i, firstChunk, firstOffset, lastChunk, lastOffset, entry->inBuffer, entry->count, &pt );
+          count = entry->count;
         }
-        else {
-#ifdef __WIN32
-          DWORD pos;
-          DWORD readed;
-#endif
-          h->cache[ target ].chunk = -1;
-          if ( !h->cache[ target ].inBuffer ) {
-            h->cache[ target ].inBuffer = xmalloc( h->chunkLength );
-}
-          inBuffer = h->cache[ target ].inBuffer;
-          if ( !inBuffer ) {
-            strcpy( h->errorString, dz_error_str( DZ_ERR_NOMEMORY ) );
-            xfree( buffer );
-            return 0;
-          }
+        CACHE_UNLOCK();
 
+        if ( !entry ) {
           if ( h->chunks[ i ] >= OUT_BUFFER_SIZE ) {
             /*
 	       err_internal( __func__,
 			     "h->chunks[%d] = %d >= %ld (OUT_BUFFER_SIZE)\n",
 			     i, h->chunks[i], OUT_BUFFER_SIZE );
 */
-            sprintf( h->errorString,
-                     "h->chunks[%d] = %d >= %ld (OUT_BUFFER_SIZE)\n",
-                     i,
-                     h->chunks[ i ],
-                     OUT_BUFFER_SIZE );
-            xfree( buffer );
-            return 0;
+            dict_data_set_error( h,
+                                 "h->chunks[%d] = %d >= %ld (OUT_BUFFER_SIZE)\n",
+                                 i,
+                                 h->chunks[ i ],
+                                 OUT_BUFFER_SIZE );
+            goto fail;
           }
 
-#ifdef __WIN32
-          pos    = SetFilePointer( h->fd, h->offsets[ i ], 0, FILE_BEGIN );
-          readed = 0;
-          if ( pos != INVALID_SET_FILE_POINTER || GetLastError() != NO_ERROR )
-            ReadFile( h->fd, outBuffer, h->chunks[ i ], &readed, 0 );
-          if ( h->chunks[ i ] != (int)readed )
-#else
-          if ( fseek( h->fd, h->offsets[ i ], SEEK_SET ) != 0 || fread( outBuffer, h->chunks[ i ], 1, h->fd ) != 1 )
-#endif
-          {
-            strcpy( h->errorString, dz_error_str( DZ_ERR_READFILE ) );
-            xfree( buffer );
-            return 0;
+          if ( !inBuffer && !( inBuffer = xmalloc( h->chunkLength ) ) ) {
+            dict_data_set_error( h, "%s", dz_error_str( DZ_ERR_NOMEMORY ) );
+            goto fail;
+          }
+
+          if ( !dict_data_pread( h, outBuffer, h->chunks[ i ], h->offsets[ i ] ) ) {
+            dict_data_set_error( h, "%s", dz_error_str( DZ_ERR_READFILE ) );
+            goto fail;
           }
 
           dict_data_filter( outBuffer, &count, OUT_BUFFER_SIZE, preFilter );
 
-          h->zStream.next_in   = (Bytef *)outBuffer;
-          h->zStream.avail_in  = h->chunks[ i ];
-          h->zStream.next_out  = (Bytef *)inBuffer;
-          h->zStream.avail_out = h->chunkLength;
-          if ( inflate( &h->zStream, Z_PARTIAL_FLUSH ) != Z_OK ) {
+          /* Each chunk is flushed fully by dictzip, so it can be inflated
+             on its own, with a fresh state */
+          if ( !zStreamInitialized ) {
+            memset( &zStream, 0, sizeof( zStream ) );
+            if ( inflateInit2( &zStream, -15 ) != Z_OK )
+            /*
+	    err_internal( __func__,
+			  "Cannot initialize inflation engine: %s\n",
+			  h->zStream.msg );
+*/
+            {
+              dict_data_set_error( h, "Cannot initialize inflation engine: %s", zStream.msg );
+              goto fail;
+            }
+            zStreamInitialized = 1;
+          }
+          else {
+            inflateReset( &zStream );
+          }
+
+          zStream.next_in   = (Bytef *)outBuffer;
+          zStream.avail_in  = h->chunks[ i ];
+          zStream.next_out  = (Bytef *)inBuffer;
+          zStream.avail_out = h->chunkLength;
+          if ( inflate( &zStream, Z_PARTIAL_FLUSH ) != Z_OK ) {
             //	       err_fatal( __func__, "inflate: %s\n", h->zStream.msg );
-            sprintf( h->errorString, "inflate: %s\n", h->zStream.msg );
-            xfree( buffer );
-            return 0;
+            dict_data_set_error( h, "inflate: %s\n", zStream.msg );
+            goto fail;
           }
-          if ( h->zStream.avail_in )
+          if ( zStream.avail_in )
           /*
 	       err_internal( __func__,
 			     "inflate did not flush (%d pending, %d avail)\n",
 			     h->zStream.avail_in, h->zStream.avail_out );
 */
           {
-            sprintf( h->errorString,
-                     "inflate did not flush (%d pending, %d avail)\n",
-                     h->zStream.avail_in,
-                     h->zStream.avail_out );
-            xfree( buffer );
-            return 0;
+            dict_data_set_error( h,
+                                 "inflate did not flush (%d pending, %d avail)\n",
+                                 zStream.avail_in,
+                                 zStream.avail_out );
+            goto fail;
           }
 
-          count = h->chunkLength - h->zStream.avail_out;
+          count = h->chunkLength - zStream.avail_out;
           dict_data_filter( inBuffer, &count, h->chunkLength, postFilter );
 
-          h->cache[ target ].count = count;
-          h->cache[ target ].chunk = i;
+          copied = dict_data_copy_chunk( h, i, firstChunk, firstOffset, lastChunk, lastOffset, inBuffer, count, &pt );
+
+          /* Hand the chunk over to the cache, unless some other thread has
+             put it there in the meantime */
+          CACHE_LOCK();
+          if ( !h->cache[ i ] && (unsigned long)h->chunkLength <= cacheMaxBytes
+               && ( entry = xmalloc( sizeof( dictCache ) ) ) ) {
+            entry->owner    = h;
+            entry->chunk    = i;
+            entry->inBuffer = inBuffer;
+            entry->count    = count;
+            h->cache[ i ]   = entry;
+            cache_link_first( entry );
+            cacheBytes += h->chunkLength;
+            cache_shrink( cacheMaxBytes );
+            inBuffer = NULL;
+          }
+          CACHE_UNLOCK();
         }
 
-        if ( i == firstChunk ) {
-          if ( i == lastChunk ) {
-            memcpy( pt, inBuffer + firstOffset, lastOffset - firstOffset );
-            pt += lastOffset - firstOffset;
-          }
-          else {
-            if ( count != h->chunkLength )
-            /*
+        if ( !copied ) {
+          /*
 		  err_internal( __func__,
 				"Length = %d instead of %d\n",
 				count, h->chunkLength );
 */
-            {
-              sprintf( h->errorString, "Length = %d instead of %d\n", count, h->chunkLength );
-              xfree( buffer );
-              return 0;
-            }
-            memcpy( pt, inBuffer + firstOffset, h->chunkLength - firstOffset );
-            pt += h->chunkLength - firstOffset;
-          }
-        }
-        else if ( i == lastChunk ) {
-          memcpy( pt, inBuffer, lastOffset );
-          pt += lastOffset;
-        }
-        else {
-          assert( count == h->chunkLength );
-          memcpy( pt, inBuffer, h->chunkLength );
-          pt += h->chunkLength;
+          dict_data_set_error( h, "Length = %d instead of %d\n", count, h->chunkLength );
+          goto fail;
         }
       }
       *pt = '\0';
       break;
     case DICT_UNKNOWN:
       //      err_fatal( __func__, "Cannot read unknown file type\n" );
-      strcpy( h->errorString, "Cannot read unknown file type" );
-      xfree( buffer );
-      return 0;
+      dict_data_set_error( h, "Cannot read unknown file type" );
+      goto fail;
+  }
+
+  if ( zStreamInitialized ) {
+    inflateEnd( &zStream );
+  }
+  if ( inBuffer ) {
+    xfree( inBuffer );
   }
-  h->errorString[ 0 ] = 0;
   return buffer;
+
+fail:
+  if ( zStreamInitialized ) {
+    inflateEnd( &zStream );
+  }
+  if ( inBuffer ) {
+    xfree( inBuffer );
+  }
+  xfree( buffer );
+  return 0;
 }
 
 char * dict_error_str( dictData * data )
@@ -38,14 +38,15 @@ extern "C" {
 
 /* Excerpts from defs.h */
 
-#define DICT_CACHE_SIZE 5
-
+/* A decompressed chunk kept in the process-wide chunk cache */
 typedef struct dictCache
 {
+  struct dictData * owner;
   int chunk;
   char * inBuffer;
-  int stamp;
   int count;
+  struct dictCache * prev; /* Neighbours in the LRU list, most recently */
+  struct dictCache * next; /* used first */
 } dictCache;
 
 enum DZ_ERRORS {
@@ -70,8 +71,6 @@ typedef struct dictData
 
   int type;
   const char * filename;
-  z_stream zStream;
-  int initialized;
 
   int headerLength;
   int method;
@@ -89,8 +88,7 @@ typedef struct dictData
   unsigned long crc;
   unsigned long length;
   unsigned long compressedLength;
-  int stamp;
-  dictCache cache[ DICT_CACHE_SIZE ];
+  dictCache ** cache; /* Per chunk, null if the chunk isn't cached */
   char errorString[ 512 ];
 } dictData;
 
@@ -100,11 +98,19 @@ extern dictData * dict_data_open( const char * filename, enum DZ_ERRORS * error,
 /* */
 extern void dict_data_close( dictData * data );
 
+/* Reads the given range of the uncompressed data. The result is allocated
+   with malloc() and is to be freed by the caller. The function is reentrant:
+   it doesn't depend on the file position and uses its own inflation state,
+   so any number of threads may read the same dictData at once. */
 extern char * dict_data_read_(
   dictData * data, unsigned long start, unsigned long end, const char * preFilter, const char * postFilter );
 
 extern char * dict_error_str( dictData * data );
 
+/* Sets the memory limit for the decompressed chunks cached for all the
+   opened files, in bytes. Zero disables the cache. */
+extern void dict_data_set_cache_size( unsigned long bytes );
+
 extern const char * dz_error_str( enum DZ_ERRORS error );
 
 extern int mmap_mode;
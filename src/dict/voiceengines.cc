@@ -52,6 +52,11 @@ public:
     return map< Property, string >();
   }
 
+  Features getFeatures() const noexcept override
+  {
+    return ArticlesIgnoreAlts;
+  }
+
   unsigned long getArticleCount() noexcept override
   {
     return 0;
@@ -141,7 +141,6 @@ class XdxfDictionary: public BtreeIndexing::BtreeDictionary
   File::Index idx;
   IdxHeader idxHeader;
   sptr< ChunkedStorage::Reader > chunks;
-  QMutex dzMutex;
   dictData * dz;
   QMutex resourceZipMutex;
   IndexedZip resourceZip;
@@ -237,7 +236,7 @@ XdxfDictionary::XdxfDictionary( string const & id, string const & indexFile, vec
   chunks = std::shared_ptr< ChunkedStorage::Reader >( new ChunkedStorage::Reader( idx, idxHeader.chunksOffset ) );
 
   if ( idxHeader.nameSize ) {
-    vector< char > chunk;
+    ChunkedStorage::Reader::Chunk chunk;
 
     dictionaryName = string( chunks->getBlock( idxHeader.nameAddress, chunk ), idxHeader.nameSize );
   }
@@ -254,9 +253,9 @@ XdxfDictionary::XdxfDictionary( string const & id, string const & indexFile, vec
   // Read the abrv, if any
 
   if ( idxHeader.hasAbrv ) {
-    vector< char > chunk;
+    ChunkedStorage::Reader::Chunk chunk;
 
-    char * abrvBlock = chunks->getBlock( idxHeader.abrvAddress, chunk );
+    char const * abrvBlock = chunks->getBlock( idxHeader.abrvAddress, chunk );
 
     uint32_t total;
     memcpy( &total, abrvBlock, sizeof( uint32_t ) );
@@ -267,7 +266,7 @@ XdxfDictionary::XdxfDictionary( string const & id, string const & indexFile, vec
       memcpy( &keySz, abrvBlock, sizeof( uint32_t ) );
       abrvBlock += sizeof( uint32_t );
 
-      char * key = abrvBlock;
+      char const * key = abrvBlock;
 
       abrvBlock += keySz;
 
@@ -358,8 +357,8 @@ QString const & XdxfDictionary::getDescription()
   }
   else {
     try {
-      vector< char > chunk;
-      char * descr;
+      ChunkedStorage::Reader::Chunk chunk;
+      char const * descr;
       {
         QMutexLocker _( &idxMutex );
         descr = chunks->getBlock( idxHeader.descriptionAddress, chunk );
@@ -590,9 +589,9 @@ void XdxfDictionary::loadArticle( uint32_t address, string & articleText, QStrin
 {
   // Read the properties
 
-  vector< char > chunk;
+  ChunkedStorage::Reader::Chunk chunk;
 
-  char * propertiesData;
+  char const * propertiesData;
 
   {
     QMutexLocker _( &idxMutex );
@@ -600,7 +599,7 @@ void XdxfDictionary::loadArticle( uint32_t address, string & articleText, QStrin
     propertiesData = chunks->getBlock( address, chunk );
   }
 
-  if ( &chunk.front() + chunk.size() - propertiesData < 9 ) {
+  if ( chunk->data() + chunk->size() - propertiesData < 9 ) {
     articleText = string( "<div class=\"xdxf\">Index seems corrupted</div>" );
     return;
   }
@@ -614,14 +613,8 @@ void XdxfDictionary::loadArticle( uint32_t address, string & articleText, QStrin
 
   // Load the article
 
-  char * articleBody;
-
-  {
-    QMutexLocker _( &dzMutex );
-
-    // Note that the function always zero-pads the result.
-    articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
-  }
+  // Note that the function always zero-pads the result.
+  char * articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
 
   if ( !articleBody ) {
     //    throw exCantReadFile( getDictionaryFilenames()[ 0 ] );
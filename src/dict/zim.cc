@@ -16,6 +16,7 @@
   #include "tiff.hh"
   #include "ftshelpers.hh"
   #include "htmlescape.hh"
+  #include "htmlrewriter.hh"
 
   #ifdef _MSC_VER
     #include <stub_msvc.h>
@@ -34,6 +35,7 @@
   #include <set>
   #include <map>
   #include <algorithm>
+  #include <unordered_set>
   #include <QtConcurrent>
   #include <utility>
   #include "globalregex.hh"
@@ -208,10 +210,18 @@ public:
   /// Loads the resource.
   void loadResource( std::string & resourceName, string & data );
 
+  /// Returns the item holding the resource. Throws if there's none.
+  zim::Item getResourceItem( string const & resourceName );
+
+  /// Loads the given part of the resource item.
+  zim::Blob loadResourcePart( zim::Item const & item, zim::offset_type offset, zim::size_type size );
+
   sptr< Dictionary::DataRequest >
   getSearchResults( QString const & searchString, int searchMode, bool matchCase, bool ignoreDiacritics ) override;
   void getArticleText( uint32_t articleAddress, QString & headword, QString & text ) override;
 
+  void sortInStorageOrder( vector< uint32_t > & articleAddresses ) override;
+
   void makeFTSIndex( QAtomicInt & isCancelled ) override;
 
   void setFTSParameters( Config::FullTextSearch const & fts ) override
@@ -313,154 +323,220 @@ quint32 ZimDictionary::loadArticle( quint32 address, string & articleText, bool
   return ret;
 }
 
-string ZimDictionary::convert( const string & in )
-{
-  QString text = QString::fromUtf8( in.c_str() );
+namespace {
 
-  // replace background
-  text.replace( QRegularExpression( R"(<\s*body\s+([^>]*)(background(|-color)):([^;"]*(;|)))" ),
-                QString( "<body \\1" ) );
+/// Removes the leading "/", "./" or "../"
+std::string_view stripLeadingDotSlash( std::string_view url )
+{
+  for ( std::string_view prefix : { "../", "./", "/" } ) {
+    if ( url.substr( 0, prefix.size() ) == prefix ) {
+      return url.substr( prefix.size() );
+    }
+  }
 
-  // pattern of img and script
-  // text.replace( QRegularExpression( "<\\s*(img|script)\\s+([^>]*)src=(\")([^\"]*)\\3" ),
-  //               QString( "<\\1 \\2src=\\3bres://%1/").arg( getId().c_str() ) );
+  return url;
+}
 
-  QRegularExpression rxImgScript( R"(<\s*(img|script|source)\s+([^>]*)src=(")([^"]*)\3)" );
-  QRegularExpressionMatchIterator it = rxImgScript.globalMatch( text );
-  int pos                            = 0;
-  QString newText;
-  while ( it.hasNext() ) {
-    QRegularExpressionMatch match = it.next();
+/// Returns the article name if the url points to an English Wikimedia
+/// project article, e.g. "https://en.wikipedia.org/wiki/<name>"
+std::string_view wikimediaArticleName( std::string_view url )
+{
+  static std::string_view const projects[] = { "wikipedia.", "wikibooks.",   "wikinews.",   "wikiquote.",
+                                               "wikisource.", "wikivoyage.", "wikiversity.", "wiktionary." };
 
-    newText += text.mid( pos, match.capturedStart() - pos );
-    pos = match.capturedEnd();
+  for ( std::string_view scheme : { "http://en.", "https://en." } ) {
+    if ( url.substr( 0, scheme.size() ) != scheme ) {
+      continue;
+    }
 
-    QStringList list = match.capturedTexts();
+    url.remove_prefix( scheme.size() );
 
-    QString url = list[ 4 ]; // a url
+    for ( auto project : projects ) {
+      if ( url.substr( 0, project.size() ) != project ) {
+        continue;
+      }
 
-    QString urlLink = match.captured();
+      url.remove_prefix( project.size() );
 
-    QString replacedLink = urlLink;
-    if ( !url.isEmpty() && !url.startsWith( "//" ) && !url.startsWith( "http://" ) && !url.startsWith( "https://" ) ) {
-      //the pattern like : <\\1 \\2src=\\3bres://%1/
+      for ( std::string_view domain : { "org/wiki/", "com/wiki/" } ) {
+        if ( url.substr( 0, domain.size() ) == domain && url.find( ':', domain.size() ) == std::string_view::npos ) {
+          return url.substr( domain.size() );
+        }
+      }
 
-      //remove leading dot and slash
-      url.remove( RX::Zim::leadingDotSlash );
-      replacedLink =
-        QString( "<%1 %2 src=\"bres://%3/%4\"" ).arg( list[ 1 ], list[ 2 ], QString::fromStdString( getId() ), url );
+      return {};
     }
 
-    newText += replacedLink;
+    return {};
   }
-  if ( pos ) {
-    newText += text.mid( pos );
-    text = newText;
+
+  return {};
+}
+
+/// Removes the background declarations from the inline style
+string stripBackground( std::string_view style )
+{
+  string result;
+
+  while ( !style.empty() ) {
+    size_t end                   = style.find( ';' );
+    std::string_view declaration = style.substr( 0, end );
+    style.remove_prefix( end == std::string_view::npos ? style.size() : end + 1 );
+
+    std::string_view name = declaration.substr( 0, declaration.find( ':' ) );
+    name.remove_prefix( std::min( name.find_first_not_of( " \t\r\n" ), name.size() ) );
+    name = name.substr( 0, name.find_last_not_of( " \t\r\n" ) + 1 );
+
+    bool const isBackground = name.size() == 10 ? Html::startsWithIgnoreCase( name, "background" ) :
+                                                  name.size() == 16 && Html::startsWithIgnoreCase( name, "background-color" );
+
+    if ( !isBackground ) {
+      result.append( declaration );
+      if ( end != std::string_view::npos ) {
+        result.push_back( ';' );
+      }
+    }
   }
-  newText.clear();
 
+  return result;
+}
+
+/// Points the resource links to the dictionary and the article links to
+/// the lookups
+class ZimLinkRewriter: public Html::Rewriter
+{
+  string const & id;
 
-  // Fix links without '"'
-  text.replace( QRegularExpression( R"(href=(\.\.|)/([^\s>]+))" ), QString( R"(href="\1/\2")" ) );
+public:
 
-  // pattern <link... href="..." ...>
-  text.replace( QRegularExpression( R"(<\s*link\s+([^>]*)href="(\.\.|)/)" ),
-                QString( "<link \\1href=\"bres://%1/" ).arg( getId().c_str() ) );
+  explicit ZimLinkRewriter( string const & id ):
+    id( id )
+  {
+  }
 
-  // localize the http://en.wiki***.com|org/wiki/<key> series links
-  // excluding those keywords that have ":" in it
-  QString urlWiki =
-    "\"http(s|)://en\\.(wiki(pedia|books|news|quote|source|voyage|versity)|wiktionary)\\.(org|com)/wiki/([^:\"]*)\"";
-  text.replace( QRegularExpression( R"(<\s*a\s+(class="external"\s+|)href=)" + urlWiki ),
-                QString( R"(<a href="gdlookup://localhost/\6")" ) );
+protected:
 
-  // pattern <a href="..." ...>, excluding any known protocols such as http://, mailto:, #(comment)
-  // these links will be translated into local definitions
-  // <meta http-equiv="Refresh" content="0;url=../dsalsrv02.uchicago.edu/cgi-bin/0994.html">
-  QRegularExpression rxLink(
-    R"lit(<\s*(?:a|meta)\s+([^>]*)(?:href|url)="?(?!(?:\w+://|#|mailto:|tel:))()([^"]*)"\s*(title="[^"]*")?[^>]*>)lit" );
-  it  = rxLink.globalMatch( text );
-  pos = 0;
-  while ( it.hasNext() ) {
-    QRegularExpressionMatch match = it.next();
+  void handleTag( Tag & tag ) override;
+};
 
-    newText += text.mid( pos, match.capturedStart() - pos );
-    pos = match.capturedEnd();
+void ZimLinkRewriter::handleTag( Tag & tag )
+{
+  if ( tag.is( "img" ) || tag.is( "script" ) || tag.is( "source" ) ) {
+    Attribute * src = tag.find( "src" );
 
-    QStringList list = match.capturedTexts();
-    // Add empty strings for compatibility with regex behaviour
-    for ( int i = list.size(); i < 5; i++ ) {
-      list.append( QString() );
+    if ( src && !src->value.empty() && src->value.substr( 0, 2 ) != "//"
+         && !Html::startsWithIgnoreCase( src->value, "http://" )
+         && !Html::startsWithIgnoreCase( src->value, "https://" ) ) {
+      src->set( "bres://" + id + "/" + string( stripLeadingDotSlash( src->value ) ) );
     }
+  }
+  else if ( tag.is( "link" ) ) {
+    Attribute * href = tag.find( "href" );
 
-    QString formatTag;
-    QString tag = list[ 3 ]; // a url, ex: Precambrian_Chaotian.html
-    QString url = tag;
-    if ( !list[ 4 ].isEmpty() ) // a title, ex: title="Precambrian/Chaotian"
-    {
-      tag       = list[ 4 ];
-      formatTag = tag.split( "\"" )[ 1 ];
+    if ( href && ( href->value.substr( 0, 1 ) == "/" || href->value.substr( 0, 3 ) == "../" ) ) {
+      href->set( "bres://" + id + "/" + string( href->value.substr( href->value.find( '/' ) + 1 ) ) );
     }
-    else {
-      //tag from list[3]
-      formatTag = tag;
-      formatTag.remove( RX::Zim::leadingDotSlash );
+  }
+  else if ( tag.is( "a" ) ) {
+    Attribute * href = tag.find( "href" );
+
+    if ( !href || href->value.empty() ) {
+      return;
     }
 
-    QString urlLink = match.captured();
+    // Localize the links to the English Wikimedia projects, except the ones
+    // having ":" in them
+    std::string_view name = wikimediaArticleName( href->value );
+
+    if ( !name.empty() ) {
+      href->set( "gdlookup://localhost/" + string( name ) );
+
+      if ( Attribute * cls = tag.find( "class" ); cls && cls->value == "external" ) {
+        cls->removed = true;
+      }
 
-    QString replacedLink = urlLink;
-    if ( !url.isEmpty() && !url.startsWith( "//" ) ) {
-      replacedLink = urlLink.replace( url, "gdlookup://localhost/" + formatTag );
+      return;
     }
 
-    newText += replacedLink;
-  }
-  if ( pos != 0 ) {
-    newText += text.mid( pos );
-    text = newText;
-  }
-  newText.clear();
+    // Links without a known protocol, e.g. "Precambrian_Chaotian.html", are
+    // turned into local definitions. The title holds the name of the article
+    // they point to, if there's one.
+    std::string_view url = href->value;
 
-  // Occasionally words needs to be displayed in vertical, but <br/> were changed to <br\> somewhere
-  // proper style: <a href="gdlookup://localhost/Neoptera" ... >N<br/>e<br/>o<br/>p<br/>t<br/>e<br/>r<br/>a</a>
-  QRegularExpression rxBR(
-    R"((<a href="gdlookup://localhost/[^"]*"\s*[^>]*>)\s*((\w\s*&lt;br(\\|/|)&gt;\s*)+\w)\s*</a>)",
-    QRegularExpression::UseUnicodePropertiesOption );
-  pos                                 = 0;
-  QRegularExpressionMatchIterator it2 = rxBR.globalMatch( text );
-  while ( it2.hasNext() ) {
-    QRegularExpressionMatch match = it2.next();
+    if ( Html::hasSchemeSlashes( url ) || url[ 0 ] == '#' || url.substr( 0, 2 ) == "//"
+         || Html::startsWithIgnoreCase( url, "mailto:" ) || Html::startsWithIgnoreCase( url, "tel:" ) ) {
+      return;
+    }
 
-    newText += text.mid( pos, match.capturedStart() - pos );
-    pos = match.capturedEnd();
+    Attribute const * title = tag.find( "title" );
+    href->set( "gdlookup://localhost/" + string( title ? title->value : stripLeadingDotSlash( url ) ) );
+  }
+  else if ( tag.is( "meta" ) ) {
+    // <meta http-equiv="Refresh" content="0;url=../dsalsrv02.uchicago.edu/cgi-bin/0994.html">
+    Attribute * content = tag.find( "content" );
+    size_t pos;
 
-    QStringList list = match.capturedTexts();
-    // Add empty strings for compatibility with regex behaviour
-    for ( int i = match.lastCapturedIndex() + 1; i < 3; i++ ) {
-      list.append( QString() );
+    if ( !content || ( pos = content->value.find( "url=" ) ) == std::string_view::npos ) {
+      return;
     }
 
-    QString tag = list[ 2 ];
-    tag
-      .replace(
-        QRegularExpression( "&lt;br( |)(\\\\|/|)&gt;", QRegularExpression::PatternOption::CaseInsensitiveOption ),
-        "<br/>" )
-      .prepend( list[ 1 ] )
-      .append( "</a>" );
+    std::string_view url = content->value.substr( pos + 4 );
 
-    newText += tag;
+    if ( url.empty() || Html::hasSchemeSlashes( url ) || url[ 0 ] == '#' || url.substr( 0, 2 ) == "//" ) {
+      return;
+    }
+
+    content->set( string( content->value.substr( 0, pos + 4 ) ) + "gdlookup://localhost/"
+                  + string( stripLeadingDotSlash( url ) ) );
   }
-  if ( pos ) {
-    newText += text.mid( pos );
-    text = newText;
+  else if ( tag.is( "body" ) ) {
+    if ( Attribute * style = tag.find( "style" ) ) {
+      style->set( stripBackground( style->value ) );
+    }
+  }
+}
+
+} // namespace
+
+string ZimDictionary::convert( const string & in )
+{
+  string text;
+  ZimLinkRewriter( getId() ).rewrite( in, text );
+
+  // Occasionally words needs to be displayed in vertical, but <br/> were changed to <br\> somewhere
+  // proper style: <a href="gdlookup://localhost/Neoptera" ... >N<br/>e<br/>o<br/>p<br/>t<br/>e<br/>r<br/>a</a>
+  if ( text.find( "&lt;br" ) != string::npos ) {
+    static QRegularExpression const rxBR(
+      R"((<a href="gdlookup://localhost/[^"]*"\s*[^>]*>)\s*((\w\s*&lt;br(\\|/|)&gt;\s*)+\w)\s*</a>)",
+      QRegularExpression::UseUnicodePropertiesOption );
+    static QRegularExpression const rxEscapedBR( "&lt;br( |)(\\\\|/|)&gt;",
+                                                 QRegularExpression::PatternOption::CaseInsensitiveOption );
+
+    QString qtext = QString::fromUtf8( text.c_str() );
+    QString newText;
+    int pos                            = 0;
+    QRegularExpressionMatchIterator it = rxBR.globalMatch( qtext );
+    while ( it.hasNext() ) {
+      QRegularExpressionMatch match = it.next();
+
+      newText += qtext.mid( pos, match.capturedStart() - pos );
+      pos = match.capturedEnd();
+
+      QString tag = match.captured( 2 );
+      tag.replace( rxEscapedBR, "<br/>" ).prepend( match.captured( 1 ) ).append( "</a>" );
+
+      newText += tag;
+    }
+    if ( pos ) {
+      newText += qtext.mid( pos );
+      text = newText.toUtf8().data();
+    }
   }
-  newText.clear();
 
   // Fix outstanding elements
   text += "<br style=\"clear:both;\" />";
 
-  return text.toUtf8().data();
+  return text;
 }
 
 void ZimDictionary::loadResource( std::string & resourceName, string & data )
@@ -472,6 +548,18 @@ void ZimDictionary::loadResource( std::string & resourceName, string & data )
   readArticleByPath( df, resourceName, data );
 }
 
+zim::Item ZimDictionary::getResourceItem( string const & resourceName )
+{
+  QMutexLocker _( &zimMutex );
+  return df.getEntryByPath( resourceName ).getItem( true );
+}
+
+zim::Blob ZimDictionary::loadResourcePart( zim::Item const & item, zim::offset_type offset, zim::size_type size )
+{
+  QMutexLocker _( &zimMutex );
+  return item.getData( offset, size );
+}
+
 QString const & ZimDictionary::getDescription()
 {
   if ( !dictionaryDescription.isEmpty() ) {
@@ -522,6 +610,39 @@ void ZimDictionary::getArticleText( uint32_t articleAddress, QString & headword,
   }
 }
 
+void ZimDictionary::sortInStorageOrder( vector< uint32_t > & articleAddresses )
+{
+  // The addresses are the indices of the entries, which are sorted by path,
+  // while the items are compressed in clusters in any order. The archive
+  // can go through its entries in the order of the clusters though.
+  std::unordered_set< uint32_t > unordered( articleAddresses.begin(), articleAddresses.end() );
+
+  vector< uint32_t > ordered;
+  ordered.reserve( articleAddresses.size() );
+
+  try {
+    QMutexLocker _( &zimMutex );
+
+    for ( auto const & entry : df.iterEfficient() ) {
+      if ( !entry.isRedirect() && unordered.erase( entry.getIndex() ) ) {
+        ordered.push_back( entry.getIndex() );
+      }
+    }
+  }
+  catch ( std::exception & e ) {
+    gdWarning( "Zim: Failed ordering the articles of \"%s\", reason: %s\n", getName().c_str(), e.what() );
+  }
+
+  // The ones not met keep their order after the rest
+  for ( uint32_t address : articleAddresses ) {
+    if ( unordered.count( address ) ) {
+      ordered.push_back( address );
+    }
+  }
+
+  articleAddresses.swap( ordered );
+}
+
 sptr< Dictionary::DataRequest >
 ZimDictionary::getSearchResults( QString const & searchString, int searchMode, bool matchCase, bool ignoreDiacritics )
 {
@@ -737,41 +858,69 @@ void ZimResourceRequest::run()
   }
 
   try {
-    string resource;
-    dict.loadResource( resourceName, resource );
-    if ( resource.empty() ) {
-      throw File::Ex();
-    }
-
-    if ( Filetype::isNameOfCSS( resourceName ) ) {
-      QString css = QString::fromUtf8( resource.data(), resource.size() );
-      dict.isolateCSS( css, ".zimdict" );
-      QByteArray bytes = css.toUtf8();
+    if ( Filetype::isNameOfCSS( resourceName ) || Filetype::isNameOfTiff( resourceName ) ) {
+      // These are converted, so they're only published once fully loaded
+      string resource;
+      dict.loadResource( resourceName, resource );
+      if ( resource.empty() ) {
+        throw File::Ex();
+      }
 
       QMutexLocker _( &dataMutex );
-      data.resize( bytes.size() );
-      memcpy( &data.front(), bytes.constData(), bytes.size() );
-    }
-    else if ( Filetype::isNameOfTiff( resourceName ) ) {
-      // Convert it
-      QMutexLocker _( &dataMutex );
-      GdTiff::tiff2img( data );
+
+      if ( Filetype::isNameOfCSS( resourceName ) ) {
+        QString css = QString::fromUtf8( resource.data(), resource.size() );
+        dict.isolateCSS( css, ".zimdict" );
+        QByteArray bytes = css.toUtf8();
+
+        data.resize( bytes.size() );
+        memcpy( &data.front(), bytes.constData(), bytes.size() );
+      }
+      else {
+        data.assign( resource.begin(), resource.end() );
+
+        // Convert it
+        GdTiff::tiff2img( data );
+      }
+
+      hasAnyData = true;
     }
     else {
-      QMutexLocker _( &dataMutex );
-      data.resize( resource.size() );
-      memcpy( &data.front(), resource.data(), data.size() );
-    }
+      // Anything else is read and published a part at a time, so that large
+      // media files start playing before they're fully read
+      zim::Item const item      = dict.getResourceItem( resourceName );
+      zim::size_type const size = item.getSize();
+      if ( !size ) {
+        throw File::Ex();
+      }
+
+      {
+        QMutexLocker _( &dataMutex );
+        data.reserve( size );
+      }
+
+      for ( zim::offset_type offset = 0; offset < size; offset += DataPartSize ) {
+        if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+          break;
+        }
 
-    QMutexLocker _( &dataMutex );
-    hasAnyData = true;
+        zim::Blob const part =
+          dict.loadResourcePart( item, offset, std::min< zim::size_type >( DataPartSize, size - offset ) );
+        publishDataPart( part.data(), part.size() );
+      }
+
+      if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+        dropPublishedData( "Cancelled" );
+      }
+    }
   }
   catch ( std::exception & ex ) {
     gdWarning( "ZIM: Failed loading resource \"%s\" from \"%s\", reason: %s\n",
                resourceName.c_str(),
                dict.getName().c_str(),
                ex.what() );
-    // Resource not loaded -- we don't set the hasAnyData flag then
+    // Resource not loaded -- whatever part of it was published is dropped
+    dropPublishedData( QString::fromUtf8( ex.what() ) );
   }
 
   finish();
@@ -225,15 +225,15 @@ sptr< Dictionary::DataRequest > ZipSoundsDictionary::getArticle( wstring const &
 
   result += "<table class=\"lsa_play\">";
 
-  vector< char > chunk;
-  char * nameBlock;
+  ChunkedStorage::Reader::Chunk chunk;
+  char const * nameBlock;
 
   for ( i = mainArticles.begin(); i != mainArticles.end(); ++i ) {
     try {
       QMutexLocker _( &idxMutex );
       nameBlock = chunks->getBlock( i->second, chunk );
 
-      if ( nameBlock >= &chunk.front() + chunk.size() ) {
+      if ( nameBlock >= chunk->data() + chunk->size() ) {
         // chunks reader thinks it's okay since zero-sized records can exist,
         // but we don't allow that.
         throw ChunkedStorage::exAddressOutOfRange();
@@ -275,7 +275,7 @@ sptr< Dictionary::DataRequest > ZipSoundsDictionary::getArticle( wstring const &
       QMutexLocker _( &idxMutex );
       nameBlock = chunks->getBlock( i->second, chunk );
 
-      if ( nameBlock >= &chunk.front() + chunk.size() ) {
+      if ( nameBlock >= chunk->data() + chunk->size() ) {
         // chunks reader thinks it's okay since zero-sized records can exist,
         // but we don't allow that.
         throw ChunkedStorage::exAddressOutOfRange();
@@ -336,8 +336,8 @@ sptr< Dictionary::DataRequest > ZipSoundsDictionary::getResource( string const &
 
   uint32_t dataOffset = 0;
   for ( int x = chain.size() - 1; x >= 0; x-- ) {
-    vector< char > chunk;
-    char * nameBlock = chunks->getBlock( chain[ x ].articleOffset, chunk );
+    ChunkedStorage::Reader::Chunk chunk;
+    char const * nameBlock = chunks->getBlock( chain[ x ].articleOffset, chunk );
 
     uint16_t sz;
     memcpy( &sz, nameBlock, sizeof( uint16_t ) );
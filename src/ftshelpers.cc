@@ -10,12 +10,20 @@
 #include "gddebug.hh"
 #include "folding.hh"
 #include "utils.hh"
+#include "globalbroadcaster.hh"
 
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <list>
+#include <map>
 #include <vector>
 #include <string>
 
 using std::vector;
 using std::string;
+using std::map;
 
 DEF_EX( exUserAbort, "User abort", Dictionary::Ex )
 
@@ -23,6 +31,134 @@ namespace FtsHelpers {
 // finished  reversed   dehsinif
 const static std::string finish_mark = std::string( "dehsinif" );
 
+/// The value slot of the documents holding the headword of their article, so
+/// that the results can be labelled without going through the btree index.
+/// The indices made before it was added don't have it.
+enum {
+  HeadwordSlot = 0
+};
+
+namespace {
+
+/// Keeps the full-text indices open between the searches. A Xapian::Database
+/// can only be used by one thread at a time, so each search leases a handle
+/// of its own, which is brought to the latest revision of the index first.
+/// The number of idle handles is limited, since each one keeps several files
+/// open.
+class DatabasePool
+{
+public:
+
+  static DatabasePool & instance()
+  {
+    static DatabasePool pool;
+    return pool;
+  }
+
+  /// Grants the exclusive use of a handle of the given index while it exists
+  class Lease
+  {
+  public:
+
+    explicit Lease( string const & path_ ):
+      path( path_ ),
+      db( instance().take( path_, generation ) )
+    {
+    }
+
+    ~Lease()
+    {
+      instance().give( path, generation, db );
+    }
+
+    Xapian::Database & operator*()
+    {
+      return db;
+    }
+
+    Q_DISABLE_COPY_MOVE( Lease )
+
+  private:
+
+    string path;
+    unsigned generation;
+    Xapian::Database db;
+  };
+
+  /// Closes the idle handles of the given index, and has the ones in use
+  /// closed once they're released. Used before the index gets replaced.
+  void drop( string const & path );
+
+private:
+
+  enum {
+    MaxIdle = 64
+  };
+
+  Xapian::Database take( string const & path, unsigned & generation );
+  void give( string const & path, unsigned generation, Xapian::Database const & );
+
+  QMutex mutex;
+  std::list< std::pair< string, Xapian::Database > > idle; // Most recently used first
+  map< string, unsigned > generations;
+};
+
+Xapian::Database DatabasePool::take( string const & path, unsigned & generation )
+{
+  {
+    QMutexLocker _( &mutex );
+
+    generation = generations[ path ];
+
+    for ( auto i = idle.begin(); i != idle.end(); ++i ) {
+      if ( i->first == path ) {
+        Xapian::Database db = i->second;
+        idle.erase( i );
+        _.unlock();
+
+        try {
+          db.reopen();
+          return db;
+        }
+        catch ( Xapian::Error & ) {
+          // The index was replaced in a way the handle can't follow
+          break;
+        }
+      }
+    }
+  }
+
+  return Xapian::Database( path );
+}
+
+void DatabasePool::give( string const & path, unsigned generation, Xapian::Database const & db )
+{
+  QMutexLocker _( &mutex );
+
+  if ( generations[ path ] != generation ) {
+    return; // Dropped meanwhile
+  }
+
+  idle.emplace_front( path, db );
+
+  if ( idle.size() > MaxIdle ) {
+    idle.pop_back();
+  }
+}
+
+void DatabasePool::drop( string const & path )
+{
+  QMutexLocker _( &mutex );
+
+  ++generations[ path ];
+
+  idle.remove_if( [ &path ]( std::pair< string, Xapian::Database > const & x ) {
+    return x.first == path;
+  } );
+}
+
+} // namespace
+
 bool ftsIndexIsOldOrBad( BtreeIndexing::BtreeDictionary * dict )
 {
   try {
@@ -37,6 +173,7 @@ bool ftsIndexIsOldOrBad( BtreeIndexing::BtreeDictionary * dict )
   catch ( Xapian::Error & e ) {
     qWarning() << e.get_description().c_str();
     //the file is corrupted,remove it.
+    DatabasePool::instance().drop( dict->ftsIndexName() );
     QFile::remove( QString::fromStdString( dict->ftsIndexName() ) );
     return true;
   }
@@ -45,6 +182,254 @@ bool ftsIndexIsOldOrBad( BtreeIndexing::BtreeDictionary * dict )
   }
 }
 
+namespace {
+
+/// Turns the articles into Xapian documents on several threads, handing them
+/// over in the order they're stored in, a batch at a time. The articles are
+/// read by one thread at a time, going through the storage sequentially, so
+/// each compressed chunk is only inflated once, while their text is indexed
+/// on all the threads at once. The number of batches done ahead of the
+/// consumer is limited, so the memory used doesn't depend on the dictionary
+/// size.
+class DocumentProducer
+{
+public:
+
+  DocumentProducer( BtreeIndexing::BtreeDictionary * dict,
+                    BtreeIndexing::ArticleIterator & articles,
+                    int threadCount,
+                    QAtomicInt & isCancelled );
+
+  ~DocumentProducer();
+
+  /// Retrieves the next batch of documents, waiting for it if necessary.
+  /// Returns false once all the batches are retrieved, or the indexing was
+  /// cancelled.
+  bool next( vector< Xapian::Document > & );
+
+  enum {
+    BatchSize = 64
+  };
+
+private:
+
+  struct Article
+  {
+    uint32_t address;
+    QString headword, text;
+  };
+
+  void run();
+
+  /// Reads the articles of the next batch, at most BatchSize of them
+  void readBatch( vector< Article > & );
+
+  /// Makes the documents of the articles given
+  void makeBatch( vector< Article > const &, Xapian::TermGenerator &, vector< Xapian::Document > & );
+
+  void stop();
+
+  BtreeIndexing::BtreeDictionary * dict;
+  BtreeIndexing::ArticleIterator & articles;
+  size_t batchCount, maxPendingBatches;
+  QAtomicInt & isCancelled;
+
+  QMutex readMutex; // Held while reading the articles
+
+  QMutex mutex;
+  QWaitCondition batchReady, batchTaken;
+  map< size_t, vector< Xapian::Document > > readyBatches;
+  size_t nextBatchToRead, nextBatchToTake;
+  bool stopped;
+
+  QThreadPool threadPool;
+};
+
+DocumentProducer::DocumentProducer( BtreeIndexing::BtreeDictionary * dict_,
+                                    BtreeIndexing::ArticleIterator & articles_,
+                                    int threadCount,
+                                    QAtomicInt & isCancelled_ ):
+  dict( dict_ ),
+  articles( articles_ ),
+  batchCount( ( articles_.remaining() + BatchSize - 1 ) / BatchSize ),
+  maxPendingBatches( threadCount * 2 ),
+  isCancelled( isCancelled_ ),
+  nextBatchToRead( 0 ),
+  nextBatchToTake( 0 ),
+  stopped( false )
+{
+  // A pool of our own, since the global one runs the indexing itself and
+  // could have no threads left to run the producers.
+  threadPool.setMaxThreadCount( threadCount );
+
+  for ( int x = 0; x < threadCount; ++x ) {
+    threadPool.start( [ this ]() {
+      run();
+    } );
+  }
+}
+
+DocumentProducer::~DocumentProducer()
+{
+  stop();
+  threadPool.waitForDone();
+}
+
+void DocumentProducer::stop()
+{
+  QMutexLocker _( &mutex );
+  stopped = true;
+  batchReady.wakeAll();
+  batchTaken.wakeAll();
+}
+
+bool DocumentProducer::next( vector< Xapian::Document > & documents )
+{
+  documents.clear();
+
+  QMutexLocker _( &mutex );
+
+  if ( nextBatchToTake == batchCount ) {
+    return false;
+  }
+
+  map< size_t, vector< Xapian::Document > >::iterator i;
+
+  while ( ( i = readyBatches.find( nextBatchToTake ) ) == readyBatches.end() ) {
+    if ( stopped ) {
+      return false;
+    }
+
+    batchReady.wait( &mutex );
+  }
+
+  documents.swap( i->second );
+  readyBatches.erase( i );
+  ++nextBatchToTake;
+  batchTaken.wakeAll();
+
+  return true;
+}
+
+void DocumentProducer::run()
+{
+  // Term generators aren't thread-safe, so each thread has one of its own
+  Xapian::TermGenerator indexer;
+  indexer.set_flags( Xapian::TermGenerator::FLAG_CJK_NGRAM );
+
+  vector< Article > batchArticles;
+
+  for ( ;; ) {
+    size_t batch;
+
+    {
+      // The batch is numbered while reading it, so the batches are numbered
+      // in the order their articles are read in
+      QMutexLocker reading( &readMutex );
+
+      {
+        QMutexLocker _( &mutex );
+
+        while ( !stopped && nextBatchToRead < batchCount
+                && nextBatchToRead >= nextBatchToTake + maxPendingBatches ) {
+          batchTaken.wait( &mutex );
+        }
+
+        if ( stopped || nextBatchToRead == batchCount ) {
+          return;
+        }
+
+        batch = nextBatchToRead++;
+      }
+
+      readBatch( batchArticles );
+    }
+
+    vector< Xapian::Document > documents;
+
+    makeBatch( batchArticles, indexer, documents );
+
+    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+      stop();
+      return;
+    }
+
+    // Xapian objects aren't thread-safe either, so the documents are only
+    // handed over once no references to them are left in this thread.
+    indexer.set_document( Xapian::Document() );
+
+    QMutexLocker _( &mutex );
+
+    if ( stopped ) {
+      return;
+    }
+
+    readyBatches[ batch ].swap( documents );
+    batchReady.wakeAll();
+  }
+}
+
+void DocumentProducer::readBatch( vector< Article > & batchArticles )
+{
+  batchArticles.resize( BatchSize );
+
+  size_t count = 0;
+
+  while ( count < BatchSize && !Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+    Article & article = batchArticles[ count ];
+
+    try {
+      if ( !articles.next( article.address, article.headword, article.text ) ) {
+        break;
+      }
+
+      ++count;
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "FTS: failed to read an article of \"%s\": %s\n", dict->getName().c_str(), e.what() );
+    }
+  }
+
+  batchArticles.resize( count );
+}
+
+void DocumentProducer::makeBatch( vector< Article > const & batchArticles,
+                                  Xapian::TermGenerator & indexer,
+                                  vector< Xapian::Document > & documents )
+{
+  documents.reserve( batchArticles.size() );
+
+  for ( auto const & article : batchArticles ) {
+    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+      return;
+    }
+
+    try {
+      Xapian::Document doc;
+
+      indexer.set_document( doc );
+
+      indexer.index_text( article.text.toStdString() );
+
+      doc.set_data( std::to_string( article.address ) );
+
+      if ( !article.headword.isEmpty() ) {
+        doc.add_value( HeadwordSlot, article.headword.toStdString() );
+      }
+
+      documents.push_back( doc );
+    }
+    catch ( Xapian::Error & e ) {
+      qWarning() << "FTS: failed to index an article:" << QString::fromStdString( e.get_description() );
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "FTS: failed to index an article of \"%s\": %s\n", dict->getName().c_str(), e.what() );
+    }
+  }
+}
+
+} // namespace
+
 void makeFTSIndex( BtreeIndexing::BtreeDictionary * dict, QAtomicInt & isCancelled )
 {
   QMutexLocker const _( &dict->getFtsMutex() );
@@ -62,14 +447,6 @@ void makeFTSIndex( BtreeIndexing::BtreeDictionary * dict, QAtomicInt & isCancell
     // Open the database for update, creating a new database if necessary.
     Xapian::WritableDatabase db( dict->ftsIndexName() + "_temp", Xapian::DB_CREATE_OR_OPEN );
 
-    Xapian::TermGenerator indexer;
-    //  Xapian::Stem stemmer("english");
-    //  indexer.set_stemmer(stemmer);
-    //  indexer.set_stemming_strategy(indexer.STEM_SOME_FULL_POS);
-    indexer.set_flags( Xapian::TermGenerator::FLAG_CJK_NGRAM );
-
-    BtreeIndexing::IndexedWords indexedWords;
-
     QSet< uint32_t > setOfOffsets;
     setOfOffsets.reserve( dict->getArticleCount() );
 
@@ -79,14 +456,10 @@ void makeFTSIndex( BtreeIndexing::BtreeDictionary * dict, QAtomicInt & isCancell
       throw exUserAbort();
     }
 
-    QList< uint32_t > offsets;
-    offsets.resize( setOfOffsets.size() );
-    uint32_t * ptr = offsets.data();
-
-    for ( QSet< uint32_t >::ConstIterator it = setOfOffsets.constBegin(); it != setOfOffsets.constEnd(); ++it ) {
-      *ptr = *it;
-      ptr++;
-    }
+    // The articles are indexed in the order they're stored in. This way
+    // they're read sequentially, and an interrupted indexing can be resumed
+    // after the last article indexed.
+    BtreeIndexing::ArticleIterator articles( *dict, vector< uint32_t >( setOfOffsets.cbegin(), setOfOffsets.cend() ) );
 
     // Free memory
     setOfOffsets.clear();
@@ -95,57 +468,62 @@ void makeFTSIndex( BtreeIndexing::BtreeDictionary * dict, QAtomicInt & isCancell
       throw exUserAbort();
     }
 
+    size_t const totalDocs = articles.remaining();
+
     // incremental build the index.
     // get the last address.
-    bool skip            = true;
-    uint32_t lastAddress = -1;
     try {
       if ( db.get_lastdocid() > 0 ) {
-        Xapian::Document lastDoc = db.get_document( db.get_lastdocid() );
-        lastAddress              = atoi( lastDoc.get_data().c_str() );
-      }
-      else {
-        skip = false;
+        Xapian::Document lastDoc   = db.get_document( db.get_lastdocid() );
+        uint32_t const lastAddress = atoi( lastDoc.get_data().c_str() );
+
+        if ( !articles.skipPast( lastAddress ) ) {
+          // The dictionary has changed since, start it over
+          db.close();
+          db = Xapian::WritableDatabase( dict->ftsIndexName() + "_temp", Xapian::DB_CREATE_OR_OVERWRITE );
+        }
       }
     }
     catch ( Xapian::Error & e ) {
       qDebug() << "get last doc failed: " << e.get_description().c_str();
-      skip = false;
     }
 
-    long indexedDoc = 0L;
+    size_t indexedDoc = totalDocs - articles.remaining();
 
-    for ( auto const & address : offsets ) {
-      indexedDoc++;
-
-      if ( address == lastAddress && skip ) {
-        skip = false;
-        continue;
-      }
-      //skip until to the lastAddress;
-      if ( skip ) {
-        continue;
-      }
-
-      if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
-        return;
-      }
+    Config::Preferences const * preferences = GlobalBroadcaster::instance()->getPreference();
+    int const threadCount                   = std::max( (int)preferences->fts.indexingThreads, 1 );
+    size_t const commitInterval             = preferences->fts.commitInterval;
 
-      QString headword, articleStr;
+    {
+      // The documents are made on several threads, while this one only adds
+      // them to the database, in the same order.
+      DocumentProducer producer( dict, articles, threadCount, isCancelled );
 
-      dict->getArticleText( address, headword, articleStr );
+      vector< Xapian::Document > documents;
+      size_t uncommittedDocs = 0;
 
-      Xapian::Document doc;
+      while ( producer.next( documents ) ) {
+        for ( auto const & doc : documents ) {
+          // Add the document to the database.
+          db.add_document( doc );
+        }
 
-      indexer.set_document( doc );
+        indexedDoc = std::min( indexedDoc + DocumentProducer::BatchSize, totalDocs );
+        dict->setIndexedFtsDoc( indexedDoc );
 
-      indexer.index_text( articleStr.toStdString() );
+        uncommittedDocs += documents.size();
 
+        if ( commitInterval && uncommittedDocs >= commitInterval ) {
+          db.commit();
+          uncommittedDocs = 0;
+        }
+      }
+    }
 
-      doc.set_data( std::to_string( address ) );
-      // Add the document to the database.
-      db.add_document( doc );
-      dict->setIndexedFtsDoc( indexedDoc );
+    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
+      // Keep what's done so far to resume from it the next time
+      db.commit();
+      return;
     }
 
     //add a special document to mark the end of the index.
@@ -154,11 +532,11 @@ void makeFTSIndex( BtreeIndexing::BtreeDictionary * dict, QAtomicInt & isCancell
     // Add the document to the database.
     db.add_document( doc );
 
-    // Free memory
-    offsets.clear();
-
     db.commit();
 
+    // The open handles of the old index would keep it from being replaced
+    DatabasePool::instance().drop( dict->ftsIndexName() );
+
     db.compact( dict->ftsIndexName() );
 
     db.close();
@@ -182,11 +560,11 @@ void FTSResultsRequest::run()
     if ( dict.haveFTSIndex() ) {
       //no need to parse the search string,  use xapian directly.
       //if the search mode is wildcard, change xapian search query flag?
-      // Open the database for searching.
-      Xapian::Database db( dict.ftsIndexName() );
+      // Take an open database for searching.
+      DatabasePool::Lease db( dict.ftsIndexName() );
 
       // Start an enquire session.
-      Xapian::Enquire enquire( db );
+      Xapian::Enquire enquire( *db );
 
       // Combine the rest of the command line arguments with spaces between
       // them, so that simple queries don't have to be quoted at the shell
@@ -195,7 +573,7 @@ void FTSResultsRequest::run()
 
       // Parse the query string to produce a Xapian::Query object.
       Xapian::QueryParser qp;
-      qp.set_database( db );
+      qp.set_database( *db );
       qp.set_default_op( Xapian::Query::op::OP_AND );
       int flag =
         Xapian::QueryParser::FLAG_DEFAULT | Xapian::QueryParser::FLAG_PURE_NOT | Xapian::QueryParser::FLAG_CJK_NGRAM;
@@ -214,23 +592,44 @@ void FTSResultsRequest::run()
       // Display the results.
       qDebug() << matches.get_matches_estimated() << " results found.\n";
       qDebug() << "Matches " << matches.size() << ":\n\n";
-      QList< uint32_t > offsetsForHeadwords;
+      QList< QString > headwords;
+      QList< int > relevances;               // Of the headwords above
+      QList< uint32_t > offsetsForHeadwords; // The ones without a stored headword
       for ( Xapian::MSetIterator i = matches.begin(); i != matches.end(); ++i ) {
-        qDebug() << i.get_rank() + 1 << ": " << i.get_weight() << " docid=" << *i << " ["
-                 << i.get_document().get_data().c_str() << "]";
-        if ( i.get_document().get_data() == finish_mark ) {
+        Xapian::Document const document = i.get_document();
+        string const data               = document.get_data();
+
+        qDebug() << i.get_rank() + 1 << ": " << i.get_weight() << " docid=" << *i << " [" << data.c_str() << "]";
+        if ( data == finish_mark ) {
           continue;
         }
-        offsetsForHeadwords.append( atoi( i.get_document().get_data().c_str() ) );
+
+        string const headword = document.get_value( HeadwordSlot );
+
+        if ( headword.empty() ) {
+          offsetsForHeadwords.append( atoi( data.c_str() ) );
+        }
+        else if ( QString word = QString::fromStdString( headword ); !headwords.contains( word ) ) {
+          headwords.append( word );
+          relevances.append( i.get_percent() );
+        }
       }
 
       if ( !offsetsForHeadwords.isEmpty() ) {
-        QList< QString > headwords;
+        // Only these need the whole btree to be walked through
+        dict.getHeadwordsFromOffsets( offsetsForHeadwords, headwords, &isCancelled );
+      }
+
+      if ( !headwords.isEmpty() ) {
         QMutexLocker _( &dataMutex );
         QString id = QString::fromUtf8( dict.getId().c_str() );
-        dict.getHeadwordsFromOffsets( offsetsForHeadwords, headwords, &isCancelled );
-        for ( const auto & headword : headwords ) {
-          foundHeadwords->append( FTS::FtsHeadword( headword, id, QStringList(), matchCase ) );
+        for ( int x = 0; x < headwords.size(); ++x ) {
+          foundHeadwords->append( FTS::FtsHeadword( headwords[ x ], id, QStringList(), matchCase ) );
+
+          // The ones found through the btree come last, and aren't ranked
+          if ( x < relevances.size() ) {
+            foundHeadwords->back().relevance = relevances[ x ];
+          }
         }
       }
     }
@@ -8,6 +8,7 @@
 
 #include <QThreadPool>
 #include <QMessageBox>
+#include <QHash>
 #include "globalregex.hh"
 
 namespace FTS {
@@ -133,63 +134,45 @@ QString FtsIndexing::nowIndexingName()
   return nowIndexing;
 }
 
-void addSortedHeadwords( QList< FtsHeadword > & base_list, QList< FtsHeadword > const & add_list )
+/// Adds the headwords to the list, merging the ones already there, and keeps
+/// the list ordered by relevance, then alphabetically.
+void mergeHeadwords( QList< FtsHeadword > & base_list, QList< FtsHeadword > const & add_list )
 {
-  QList< FtsHeadword > list;
-
   if ( add_list.isEmpty() ) {
     return;
   }
 
-  if ( base_list.isEmpty() ) {
-    base_list = add_list;
-    return;
-  }
+  QHash< QString, qsizetype > positions; // By the case-folded headword
+  positions.reserve( base_list.size() + add_list.size() );
 
-  list.reserve( base_list.size() + add_list.size() );
+  for ( qsizetype x = 0; x < base_list.size(); ++x ) {
+    positions.insert( base_list[ x ].headword.toCaseFolded(), x );
+  }
 
-  QList< FtsHeadword >::iterator base_it      = base_list.begin();
-  QList< FtsHeadword >::const_iterator add_it = add_list.constBegin();
+  for ( auto const & add : add_list ) {
+    auto const i = positions.constFind( add.headword.toCaseFolded() );
 
-  while ( base_it != base_list.end() || add_it != add_list.end() ) {
-    if ( base_it == base_list.end() ) {
-      while ( add_it != add_list.end() ) {
-        list.append( *add_it );
-        ++add_it;
-      }
-      break;
+    if ( i == positions.constEnd() ) {
+      positions.insert( add.headword.toCaseFolded(), base_list.size() );
+      base_list.append( add );
+      continue;
     }
 
-    if ( add_it == add_list.end() ) {
-      while ( base_it != base_list.end() ) {
-        list.append( *base_it );
-        ++base_it;
-      }
-      break;
-    }
+    FtsHeadword & base = base_list[ i.value() ];
 
-    if ( *add_it < *base_it ) {
-      list.append( *add_it );
-      ++add_it;
-    }
-    else if ( *add_it == *base_it ) {
-      base_it->dictIDs.append( add_it->dictIDs );
-      for ( QStringList::const_iterator itr = add_it->foundHiliteRegExps.constBegin();
-            itr != add_it->foundHiliteRegExps.constEnd();
-            ++itr ) {
-        if ( !base_it->foundHiliteRegExps.contains( *itr ) ) {
-          base_it->foundHiliteRegExps.append( *itr );
-        }
+    base.dictIDs.append( add.dictIDs );
+    base.relevance = std::max( base.relevance, add.relevance );
+
+    for ( auto const & hilite : add.foundHiliteRegExps ) {
+      if ( !base.foundHiliteRegExps.contains( hilite ) ) {
+        base.foundHiliteRegExps.append( hilite );
       }
-      ++add_it;
-    }
-    else {
-      list.append( *base_it );
-      ++base_it;
     }
   }
 
-  base_list.swap( list );
+  std::stable_sort( base_list.begin(), base_list.end(), []( FtsHeadword const & a, FtsHeadword const & b ) {
+    return a.relevance != b.relevance ? a.relevance > b.relevance : a < b;
+  } );
 }
 
 FullTextSearchDialog::FullTextSearchDialog( QWidget * parent,
@@ -400,9 +383,8 @@ void FullTextSearchDialog::searchReqFinished()
             try {
               ( *it )->getDataSlice( 0, sizeof( headwords ), &headwords );
               hws.swap( *headwords );
-              std::sort( hws.begin(), hws.end() );
               delete headwords;
-              addSortedHeadwords( allHeadwords, hws );
+              mergeHeadwords( allHeadwords, hws );
             }
             catch ( std::exception & e ) {
               gdWarning( "getDataSlice error: %s\n", e.what() );
@@ -584,7 +566,7 @@ void HeadwordsListModel::addResults( const QModelIndex & parent, QList< FtsHeadw
   Q_UNUSED( parent );
   beginResetModel();
 
-  addSortedHeadwords( headwords, hws );
+  mergeHeadwords( headwords, hws );
 
   endResetModel();
   emit contentChanged();
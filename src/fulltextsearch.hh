@@ -46,6 +46,9 @@ struct FtsHeadword
   QStringList dictIDs;
   QStringList foundHiliteRegExps;
   bool matchCase;
+  /// How well the article matched the query, in percents, as ranked by the
+  /// full-text index. The best one among the dictionaries is kept.
+  int relevance = 0;
 
   FtsHeadword( QString const & headword_, QString const & dictid_, QStringList hilites, bool match_case ):
     headword( headword_ ),
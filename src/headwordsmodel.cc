@@ -87,9 +87,10 @@ void HeadwordListModel::requestFinished()
         qDebug() << "error:" << ( *i )->getErrorString();
       }
       else if ( ( *i )->matchesCount() ) {
-        auto allmatches = ( *i )->getAllMatches();
-        for ( auto & match : allmatches ) {
-          filterWords.append( QString::fromStdU32String( match.word ) );
+        for ( auto const & span : ( *i )->matchesFrom( 0 ) ) {
+          for ( auto const & match : span ) {
+            filterWords.append( QString::fromStdU32String( match.word ) );
+          }
         }
       }
       queuedRequests.erase( i++ );
@@ -1,5 +1,56 @@
 #include "resourceschemehandler.hh"
 
+DataRequestDevice::DataRequestDevice( sptr< Dictionary::DataRequest > const & req_, QObject * parent ):
+  QIODevice( parent ),
+  req( req_ ),
+  alreadyRead( 0 )
+{
+  setOpenMode( ReadOnly );
+
+  connect( req.get(), &Dictionary::Request::updated, this, &QIODevice::readyRead );
+  connect( req.get(), &Dictionary::Request::finished, this, [ this ]() {
+    emit readyRead();
+    emit readChannelFinished();
+  } );
+}
+
+DataRequestDevice::~DataRequestDevice()
+{
+  req->cancel();
+}
+
+qint64 DataRequestDevice::bytesAvailable() const
+{
+  return qint64( req->availableDataSize() ) - alreadyRead.loadAcquire() + QIODevice::bytesAvailable();
+}
+
+bool DataRequestDevice::atEnd() const
+{
+  return req->isFinished() && bytesAvailable() == 0;
+}
+
+qint64 DataRequestDevice::readData( char * data, qint64 maxSize )
+{
+  // From the doc: "This function might be called with a maxSize of 0,
+  // which can be used to perform post-reading operations".
+  if ( maxSize <= 0 ) {
+    return 0;
+  }
+
+  // Checked first, so that no data appended right before finishing is lost
+  bool const finished = req->isFinished();
+
+  size_t const read = req->readDataSlice( alreadyRead.loadAcquire(), maxSize, data );
+
+  if ( !read ) {
+    return finished ? -1 : 0;
+  }
+
+  alreadyRead.fetchAndAddOrdered( read );
+
+  return read;
+}
+
 ResourceSchemeHandler::ResourceSchemeHandler( ArticleNetworkAccessManager & articleNetMgr, QObject * parent ):
   QWebEngineUrlSchemeHandler( parent ),
   mManager( articleNetMgr )
@@ -17,42 +68,42 @@ void ResourceSchemeHandler::requestStarted( QWebEngineUrlRequestJob * requestJob
     qDebug() << "Resource failed to load: " << url.toString();
     requestJob->fail( QWebEngineUrlRequestJob::RequestFailed );
   }
-  else if ( reply->isFinished() ) {
-    replyJob( reply, requestJob, content_type );
-  }
-  else {
-    connect( reply.get(), &Dictionary::DataRequest::finished, requestJob, [ = ]() {
-      replyJob( reply, requestJob, content_type );
-    } );
+  else if ( !replyJob( reply, requestJob, content_type ) ) {
+    // Start replying as soon as the first data arrives, large resources are
+    // then streamed while they're still being read
+    auto const tryReply = [ this, reply, requestJob, content_type ]() {
+      if ( replyJob( reply, requestJob, content_type ) ) {
+        disconnect( reply.get(), nullptr, requestJob, nullptr );
+      }
+    };
+
+    connect( reply.get(), &Dictionary::DataRequest::updated, requestJob, tryReply );
+    connect( reply.get(), &Dictionary::DataRequest::finished, requestJob, tryReply );
   }
 }
 
 
-void ResourceSchemeHandler::replyJob( sptr< Dictionary::DataRequest > reply,
+bool ResourceSchemeHandler::replyJob( sptr< Dictionary::DataRequest > reply,
                                       QWebEngineUrlRequestJob * requestJob,
                                       QString content_type )
 {
-  if ( !reply.get() ) {
-    requestJob->fail( QWebEngineUrlRequestJob::UrlNotFound );
-    return;
-  }
-  const auto & data = reply->getFullData();
-  if ( data.empty() ) {
+  bool const finished = reply->isFinished();
+
+  if ( !reply->availableDataSize() ) {
+    if ( !finished ) {
+      return false;
+    }
+
     requestJob->fail( QWebEngineUrlRequestJob::UrlNotFound );
-    return;
+    return true;
   }
-  QByteArray * ba  = new QByteArray( data.data(), data.size() );
-  QBuffer * buffer = new QBuffer( ba );
-  buffer->open( QBuffer::ReadOnly );
-  buffer->seek( 0 );
+
+  auto * device = new DataRequestDevice( reply );
 
   // Reply segment
-  requestJob->reply( content_type.toLatin1(), buffer );
+  requestJob->reply( content_type.toLatin1(), device );
 
-  connect( requestJob, &QObject::destroyed, buffer, [ = ]() {
-    buffer->close();
-    ba->clear();
-    delete ba;
-    buffer->deleteLater();
-  } );
+  connect( requestJob, &QObject::destroyed, device, &QObject::deleteLater );
+
+  return true;
 }
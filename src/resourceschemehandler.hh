@@ -3,6 +3,41 @@
 
 #include "article_netmgr.hh"
 
+/// A read-only sequential device streaming the data of a DataRequest
+/// straight out of the request's own buffer, so it isn't copied before
+/// being handed over. The data can be read while the request is still in
+/// progress. The request is kept alive for as long as the device exists.
+class DataRequestDevice: public QIODevice
+{
+  Q_OBJECT
+
+public:
+
+  explicit DataRequestDevice( sptr< Dictionary::DataRequest > const & req, QObject * parent = nullptr );
+  ~DataRequestDevice();
+
+  bool isSequential() const override
+  {
+    return true;
+  }
+
+  qint64 bytesAvailable() const override;
+  bool atEnd() const override;
+
+protected:
+
+  qint64 readData( char * data, qint64 maxSize ) override;
+  qint64 writeData( char const *, qint64 ) override
+  {
+    return -1;
+  }
+
+private:
+
+  sptr< Dictionary::DataRequest > req;
+  QAtomicInteger< qint64 > alreadyRead; // Read from WebEngine's IO thread
+};
+
 class ResourceSchemeHandler: public QWebEngineUrlSchemeHandler
 {
   Q_OBJECT
@@ -12,7 +47,10 @@ public:
   void requestStarted( QWebEngineUrlRequestJob * requestJob );
 
 protected:
-  void replyJob( sptr< Dictionary::DataRequest > reply, QWebEngineUrlRequestJob * requestJob, QString content_type );
+  /// Replies with the data of the request once there's some, or fails the
+  /// job if the request has finished without any. Returns true if the job
+  /// was answered.
+  bool replyJob( sptr< Dictionary::DataRequest > reply, QWebEngineUrlRequestJob * requestJob, QString content_type );
 
 private:
   ArticleNetworkAccessManager & mManager;
@@ -10,7 +10,12 @@
 #include "mainwindow.hh"
 #include <QWebEngineProfile>
 #include "editdictionaries.hh"
+#include "dict/btreeidx.hh"
+#include "dict/groupindex.hh"
 #include "dict/loaddictionaries.hh"
+#include "dict/mdictparser.hh"
+#include "dict/slob.hh"
+#include "dictzip.hh"
 #include "preferences.hh"
 #include "about.hh"
 #include "mruqmenu.hh"
@@ -353,6 +358,10 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
   connect( &wordFinder, &WordFinder::updated, this, &MainWindow::prefixMatchUpdated );
   connect( &wordFinder, &WordFinder::finished, this, &MainWindow::prefixMatchFinished );
 
+  wordListModel = new WordListModel( this );
+  ui.wordList->setModel( wordListModel );
+  translateBox->setModel( wordListModel );
+
 
   groupList->setFocusPolicy( Qt::ClickFocus );
   ui.wordList->setFocusPolicy( Qt::ClickFocus );
@@ -676,9 +685,12 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
     translateInputFinished( true );
   } );
 
-  connect( ui.wordList, &QListWidget::itemSelectionChanged, this, &MainWindow::wordListSelectionChanged );
+  connect( ui.wordList->selectionModel(),
+           &QItemSelectionModel::selectionChanged,
+           this,
+           &MainWindow::wordListSelectionChanged );
 
-  connect( ui.wordList, &QListWidget::itemClicked, this, &MainWindow::wordListItemActivated );
+  connect( ui.wordList, &QListView::clicked, this, &MainWindow::wordListItemActivated );
 
   connect( ui.dictsList, &QListWidget::itemSelectionChanged, this, &MainWindow::dictsListSelectionChanged );
 
@@ -739,6 +751,7 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
            &MainWindow::proxyAuthentication );
 
   setupNetworkCache( cfg.preferences.maxNetworkCacheSize );
+  setupDictionaryCaches( cfg.preferences );
 
   makeDictionaries();
 
@@ -944,42 +957,18 @@ void MainWindow::updateMatchResults( bool finished )
 {
   WordFinder::SearchResults const & results = wordFinder.getResults();
 
-  if ( cfg.preferences.searchInDock ) {
-    ui.wordList->setUpdatesEnabled( false );
-    //clear all existed items
-    ui.wordList->clear();
-
-    for ( const auto & result : results ) {
-      auto i = new QListWidgetItem( result.first, ui.wordList );
-      i->setToolTip( result.first );
-
-      if ( result.second ) {
-        QFont f = i->font();
-        f.setItalic( true );
-        i->setFont( f );
-      }
+  // Both the word list and the translate box show the model, which only
+  // passes on the rows which have changed
+  wordListModel->setResults( results );
 
-      i->setTextAlignment( Qt::AlignLeft );
-    }
-
-    if ( ui.wordList->count() ) {
-      ui.wordList->scrollToItem( ui.wordList->item( 0 ), QAbstractItemView::PositionAtTop );
-      ui.wordList->setCurrentItem( nullptr, QItemSelectionModel::Clear );
+  if ( cfg.preferences.searchInDock ) {
+    if ( wordListModel->rowCount() ) {
+      ui.wordList->scrollToTop();
+      ui.wordList->selectionModel()->setCurrentIndex( QModelIndex(), QItemSelectionModel::Clear );
     }
 
-    ui.wordList->setUpdatesEnabled( true );
     ui.wordList->unsetCursor();
   }
-  else {
-
-    QStringList _results;
-    _results.clear();
-
-    for ( const auto & result : results ) {
-      _results << result.first;
-    }
-    translateBox->setModel( _results );
-  }
 
   if ( finished ) {
 
@@ -1150,6 +1139,7 @@ MainWindow::~MainWindow()
   closeHeadwordsDialog();
 
   ftsIndexing.stopIndexing();
+  GroupIndex::Indices::instance().clear();
 #ifndef Q_OS_MACOS
   ui.centralWidget->ungrabGesture( Gestures::GDPinchGestureType );
   ui.centralWidget->ungrabGesture( Gestures::GDSwipeGestureType );
@@ -1174,6 +1164,8 @@ MainWindow::~MainWindow()
 #ifndef NO_EPWING_SUPPORT
   Epwing::finalize();
 #endif
+
+  BtreeIndexing::NodeCache::instance().logStatistics();
 }
 
 void MainWindow::addGlobalAction( QAction * action, const std::function< void() > & slotFunc )
@@ -1233,7 +1225,8 @@ void MainWindow::commitData()
     for ( auto & file : entries ) {
       QString const fileName = file.fileName();
 
-      if ( dictMap.contains( fileName.toStdString() ) ) {
+      if ( dictMap.contains( fileName.toStdString() )
+           || GroupIndex::Indices::instance().isIndexFile( fileName.toStdString() ) ) {
         continue;
       }
       //remove both normal index and fts index.
@@ -1575,6 +1568,14 @@ void MainWindow::setupNetworkCache( int maxSize )
   articleNetMgr.setCache( diskCache );
 }
 
+void MainWindow::setupDictionaryCaches( Config::Preferences const & p )
+{
+  BtreeIndexing::NodeCache::instance().setMaxSize( std::max( p.maxBtreeNodeCacheSize, 0 ) * size_t( 1024 * 1024 ) );
+  Mdict::RecordBlockCache::instance().setMaxSize( std::max( p.maxMdictBlockCacheSize, 0 ) * size_t( 1024 * 1024 ) );
+  dict_data_set_cache_size( std::max( p.maxDictzipCacheSize, 0 ) * 1024UL * 1024UL );
+  Slob::setItemCacheSize( std::max( p.maxSlobItemCacheSize, 0 ) * size_t( 1024 * 1024 ) );
+}
+
 void MainWindow::makeDictionaries()
 {
 
@@ -1585,10 +1586,15 @@ void MainWindow::makeDictionaries()
   ftsIndexing.stopIndexing();
   ftsIndexing.clearDictionaries();
 
+  // The merged indices are read from the dictionaries' own ones, which may
+  // get rebuilt now
+  GroupIndex::Indices::instance().clear();
+
   loadDictionaries( this, isVisible(), cfg, dictionaries, dictNetMgr, false );
 
   //create map
   dictMap = Dictionary::dictToMap( dictionaries );
+  articleNetMgr.dictionariesChanged();
 
   for ( unsigned x = 0; x < dictionaries.size(); x++ ) {
     dictionaries[ x ]->setFTSParameters( cfg.preferences.fts );
@@ -1659,6 +1665,8 @@ void MainWindow::updateGroupList( bool reload )
   groupList->fill( groupInstances );
   groupList->setCurrentGroup( cfg.lastMainGroupId );
 
+  updateGroupIndices();
+
   updateDictionaryBar();
 
   if ( reload ) {
@@ -1674,6 +1682,22 @@ void MainWindow::updateGroupList( bool reload )
   connect( groupList, &GroupComboBox::currentIndexChanged, this, &MainWindow::currentGroupChanged );
 }
 
+void MainWindow::updateGroupIndices()
+{
+  if ( !cfg.preferences.enableGroupHeadwordIndex ) {
+    return;
+  }
+
+  vector< vector< sptr< Dictionary::Class > > > groups;
+  groups.reserve( groupInstances.size() );
+
+  for ( auto const & group : groupInstances ) {
+    groups.push_back( group.dictionaries );
+  }
+
+  GroupIndex::Indices::instance().setGroups( groups );
+}
+
 void MainWindow::updateDictionaryBar()
 {
   if ( !dictionaryBar.toggleViewAction()->isChecked() ) {
@@ -2196,6 +2220,9 @@ void MainWindow::editDictionaries( unsigned editDictionaryGroup )
   wordFinder.clear();
   dictionariesUnmuted.clear();
 
+  // The dialog may rescan the dictionaries
+  GroupIndex::Indices::instance().clear();
+
   { // Limit existence of newCfg
 
     Config::Class newCfg = cfg;
@@ -2213,6 +2240,9 @@ void MainWindow::editDictionaries( unsigned editDictionaryGroup )
     dicts.exec();
     cfg.dictionariesDialogGeometry = newCfg.dictionariesDialogGeometry = dicts.saveGeometry();
 
+    // The dialog may have rescanned the dictionaries
+    articleNetMgr.dictionariesChanged();
+
     if ( dicts.areDictionariesChanged() || dicts.areGroupsChanged() ) {
       ftsIndexing.stopIndexing();
       ftsIndexing.clearDictionaries();
@@ -2244,6 +2274,9 @@ void MainWindow::editDictionaries( unsigned editDictionaryGroup )
       ftsIndexing.setDictionaries( dictionaries );
       ftsIndexing.doIndexing();
     }
+    else {
+      updateGroupIndices();
+    }
   }
 
   scanPopup->refresh();
@@ -2286,6 +2319,8 @@ void MainWindow::editPreferences()
 
     p.fts.searchMode = cfg.preferences.fts.searchMode;
 
+    p.enableGroupHeadwordIndex = cfg.preferences.enableGroupHeadwordIndex;
+
     // See if we need to update Appearances
     if ( cfg.preferences.displayStyle != p.displayStyle || cfg.preferences.darkMode != p.darkMode
 #if !defined( Q_OS_WIN )
@@ -2315,6 +2350,8 @@ void MainWindow::editPreferences()
       setupNetworkCache( p.maxNetworkCacheSize );
     }
 
+    setupDictionaryCaches( p );
+
     bool needReload =
       ( cfg.preferences.displayStyle != p.displayStyle || cfg.preferences.addonStyle != p.addonStyle
         || cfg.preferences.darkReaderMode != p.darkReaderMode
@@ -2443,7 +2480,7 @@ void MainWindow::updateSuggestionList( QString const & newValue )
   // triggering a set of spurious activation signals when the list changes.
 
   if ( ui.wordList->selectionModel()->hasSelection() ) {
-    ui.wordList->setCurrentItem( nullptr, QItemSelectionModel::Clear );
+    ui.wordList->selectionModel()->setCurrentIndex( QModelIndex(), QItemSelectionModel::Clear );
   }
 
   QString req = newValue.trimmed();
@@ -2451,7 +2488,7 @@ void MainWindow::updateSuggestionList( QString const & newValue )
   if ( !req.size() ) {
     // An empty request always results in an empty result
     wordFinder.cancel();
-    ui.wordList->clear();
+    wordListModel->clear();
     ui.wordList->unsetCursor();
 
     // Reset the noResults mark if it's on right now
@@ -2647,9 +2684,10 @@ bool MainWindow::eventFilter( QObject * obj, QEvent * ev )
       QKeyEvent * keyEvent = dynamic_cast< QKeyEvent * >( ev );
 
       if ( cfg.preferences.searchInDock ) {
-        if ( keyEvent->matches( QKeySequence::MoveToNextLine ) && ui.wordList->count() ) {
+        if ( keyEvent->matches( QKeySequence::MoveToNextLine ) && wordListModel->rowCount() ) {
           ui.wordList->setFocus( Qt::ShortcutFocusReason );
-          ui.wordList->setCurrentRow( 0, QItemSelectionModel::ClearAndSelect );
+          ui.wordList->selectionModel()->setCurrentIndex( wordListModel->index( 0 ),
+                                                          QItemSelectionModel::ClearAndSelect );
           return true;
         }
       }
@@ -2668,13 +2706,14 @@ bool MainWindow::eventFilter( QObject * obj, QEvent * ev )
     if ( ev->type() == QEvent::KeyPress ) {
       QKeyEvent * keyEvent = dynamic_cast< QKeyEvent * >( ev );
 
-      if ( keyEvent->matches( QKeySequence::MoveToPreviousLine ) && !ui.wordList->currentRow() ) {
-        ui.wordList->setCurrentRow( 0, QItemSelectionModel::Clear );
+      if ( keyEvent->matches( QKeySequence::MoveToPreviousLine ) && !ui.wordList->currentIndex().row() ) {
+        ui.wordList->selectionModel()->setCurrentIndex( wordListModel->index( 0 ), QItemSelectionModel::Clear );
         translateLine->setFocus( Qt::ShortcutFocusReason );
         return true;
       }
 
-      if ( keyEvent->matches( QKeySequence::InsertParagraphSeparator ) && ui.wordList->selectedItems().size() ) {
+      if ( keyEvent->matches( QKeySequence::InsertParagraphSeparator )
+           && ui.wordList->selectionModel()->hasSelection() ) {
         if ( cfg.preferences.searchInDock ) {
           if ( ui.searchPane->isFloating() ) {
             activateWindow();
@@ -2708,23 +2747,23 @@ bool MainWindow::eventFilter( QObject * obj, QEvent * ev )
   return QMainWindow::eventFilter( obj, ev );
 }
 
-void MainWindow::wordListItemActivated( QListWidgetItem * item )
+void MainWindow::wordListItemActivated( QModelIndex const & index )
 {
   if ( wordListSelChanged ) {
     wordListSelChanged = false;
   }
   else {
-    respondToTranslationRequest( item->text(), true );
+    respondToTranslationRequest( wordListModel->word( index.row() ), true );
   }
 }
 
 void MainWindow::wordListSelectionChanged()
 {
-  QList< QListWidgetItem * > selected = ui.wordList->selectedItems();
+  QModelIndexList const selected = ui.wordList->selectionModel()->selectedRows();
 
   if ( !selected.empty() ) {
     wordListSelChanged = true;
-    showTranslationFor( selected.front()->text() );
+    showTranslationFor( wordListModel->word( selected.front().row() ) );
   }
 }
 
@@ -3473,6 +3512,8 @@ void MainWindow::on_rescanFiles_triggered()
   ftsIndexing.stopIndexing();
   ftsIndexing.clearDictionaries();
 
+  GroupIndex::Indices::instance().clear();
+
   groupInstances.clear(); // Release all the dictionaries they hold
   dictionaries.clear();
   dictionariesUnmuted.clear();
@@ -3480,6 +3521,7 @@ void MainWindow::on_rescanFiles_triggered()
 
   loadDictionaries( this, true, cfg, dictionaries, dictNetMgr );
   dictMap = Dictionary::dictToMap( dictionaries );
+  articleNetMgr.dictionariesChanged();
 
   for ( const auto & dictionarie : dictionaries ) {
     dictionarie->setFTSParameters( cfg.preferences.fts );
@@ -4082,7 +4124,7 @@ void MainWindow::on_importFavorites_triggered()
 
 void MainWindow::focusWordList()
 {
-  if ( ui.wordList->count() > 0 ) {
+  if ( wordListModel->rowCount() > 0 ) {
     ui.wordList->setFocus();
   }
 }
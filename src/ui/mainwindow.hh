@@ -21,6 +21,7 @@
 #include "scanpopup.hh"
 #include "ui/articleview.hh"
 #include "wordfinder.hh"
+#include "wordlistmodel.hh"
 #include "dictionarybar.hh"
 #include "history.hh"
 #include "mainstatusbar.hh"
@@ -147,6 +148,9 @@ private:
 
   WordFinder wordFinder;
 
+  /// The search results, shown by both the word list and the translate box
+  WordListModel * wordListModel;
+
   ScanPopup * scanPopup = nullptr;
 
   //only used once, when used ,reset to empty.
@@ -202,9 +206,13 @@ private:
 
   void applyProxySettings();
   void setupNetworkCache( int maxSize );
+  /// Applies the memory limits of the in-process dictionary data caches
+  void setupDictionaryCaches( Config::Preferences const & );
   void makeDictionaries();
   void updateStatusLine();
   void updateGroupList( bool reload = true );
+  /// Brings the merged headword indices in line with the groups, if enabled
+  void updateGroupIndices();
   void updateDictionaryBar();
 
   void updatePronounceAvailability();
@@ -357,7 +365,7 @@ private slots:
   /// it has.
   void focusTranslateLine();
 
-  void wordListItemActivated( QListWidgetItem * );
+  void wordListItemActivated( QModelIndex const & );
   void wordListSelectionChanged();
 
   void dictsListItemActivated( QListWidgetItem * );
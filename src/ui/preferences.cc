@@ -166,6 +166,10 @@ Preferences::Preferences( QWidget * parent, Config::Class & cfg_ ):
 #ifdef Q_OS_WIN32
   // 1 MB stands for 2^20 bytes on Windows. "MiB" is never used by this OS.
   ui.maxNetworkCacheSize->setSuffix( tr( " MB" ) );
+  ui.maxBtreeNodeCacheSize->setSuffix( tr( " MB" ) );
+  ui.maxMdictBlockCacheSize->setSuffix( tr( " MB" ) );
+  ui.maxDictzipCacheSize->setSuffix( tr( " MB" ) );
+  ui.maxSlobItemCacheSize->setSuffix( tr( " MB" ) );
 #endif
   ui.maxNetworkCacheSize->setToolTip( ui.maxNetworkCacheSize->toolTip().arg( Config::getCacheDir() ) );
 
@@ -334,6 +338,12 @@ Preferences::Preferences( QWidget * parent, Config::Class & cfg_ ):
   ui.maxNetworkCacheSize->setValue( p.maxNetworkCacheSize );
   ui.clearNetworkCacheOnExit->setChecked( p.clearNetworkCacheOnExit );
 
+  // Dictionary caches
+  ui.maxBtreeNodeCacheSize->setValue( p.maxBtreeNodeCacheSize );
+  ui.maxMdictBlockCacheSize->setValue( p.maxMdictBlockCacheSize );
+  ui.maxDictzipCacheSize->setValue( p.maxDictzipCacheSize );
+  ui.maxSlobItemCacheSize->setValue( p.maxSlobItemCacheSize );
+
   //Misc
   ui.removeInvalidIndexOnExit->setChecked( p.removeInvalidIndexOnExit );
 
@@ -367,6 +377,10 @@ Preferences::Preferences( QWidget * parent, Config::Class & cfg_ ):
 
   ui.parallelThreads->setMaximum( QThread::idealThreadCount() );
   ui.parallelThreads->setValue( p.fts.parallelThreads );
+
+  ui.indexingThreads->setMaximum( QThread::idealThreadCount() );
+  ui.indexingThreads->setValue( p.fts.indexingThreads );
+  ui.commitInterval->setValue( p.fts.commitInterval );
 }
 
 void Preferences::buildDisabledTypes( QString & disabledTypes, bool is_checked, QString name )
@@ -493,6 +507,11 @@ Config::Preferences Preferences::getPreferences()
   p.maxNetworkCacheSize           = ui.maxNetworkCacheSize->value();
   p.clearNetworkCacheOnExit       = ui.clearNetworkCacheOnExit->isChecked();
 
+  p.maxBtreeNodeCacheSize  = ui.maxBtreeNodeCacheSize->value();
+  p.maxMdictBlockCacheSize = ui.maxMdictBlockCacheSize->value();
+  p.maxDictzipCacheSize    = ui.maxDictzipCacheSize->value();
+  p.maxSlobItemCacheSize   = ui.maxSlobItemCacheSize->value();
+
   p.removeInvalidIndexOnExit = ui.removeInvalidIndexOnExit->isChecked();
 
   p.addonStyle = ui.addonStyles->getCurrentStyle();
@@ -500,6 +519,8 @@ Config::Preferences Preferences::getPreferences()
   p.fts.enabled           = ui.ftsGroupBox->isChecked();
   p.fts.maxDictionarySize = ui.maxDictionarySize->value();
   p.fts.parallelThreads   = ui.parallelThreads->value();
+  p.fts.indexingThreads   = ui.indexingThreads->value();
+  p.fts.commitInterval    = ui.commitInterval->value();
 
   buildDisabledTypes( p.fts.disabledTypes, ui.allowAard->isChecked(), "AARD" );
   buildDisabledTypes( p.fts.disabledTypes, ui.allowBGL->isChecked(), "BGL" );
@@ -94,6 +94,20 @@ void TranslateBox::setModel( QStringList & _words )
            } );
 }
 
+void TranslateBox::setModel( QAbstractItemModel * model )
+{
+  completer->setModel( model );
+
+  disconnect( completer, QOverload< const QString & >::of( &QCompleter::activated ), translate_line, nullptr );
+  connect( completer,
+           QOverload< const QString & >::of( &QCompleter::activated ),
+           translate_line,
+           [ this ]( const QString & text ) {
+             translate_line->setText( text );
+             emit returnPressed();
+           } );
+}
+
 void TranslateBox::showPopup()
 {
   if ( m_popupEnabled ) {
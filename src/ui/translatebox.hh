@@ -24,6 +24,10 @@ public:
 
   void setModel( QStringList & _words );
 
+  /// Makes the completer show the given model instead of its own string list.
+  /// The model stays owned by the caller.
+  void setModel( QAbstractItemModel * model );
+
 public slots:
   void setPopupEnabled( bool enable );
 
@@ -3,6 +3,7 @@
 
 #include "wordfinder.hh"
 #include "folding.hh"
+#include "dict/groupindex.hh"
 #include "wstring_qt.hh"
 #include <map>
 #include "gddebug.hh"
@@ -139,13 +140,48 @@ void WordFinder::startSearch()
     allWordWritings.insert( allWordWritings.end(), writings.begin(), writings.end() );
   }
 
-  // Query each dictionary for all word writings
+  vector< sptr< Dictionary::Class > > searchedDicts;
 
   for ( const auto & inputDict : *inputDicts ) {
-    if ( ( inputDict->getFeatures() & requestedFeatures ) != requestedFeatures ) {
+    if ( ( inputDict->getFeatures() & requestedFeatures ) == requestedFeatures ) {
+      searchedDicts.push_back( inputDict );
+    }
+  }
+
+  // The dictionaries merged in a group index are all searched at once
+
+  GroupIndex::Lookup const lookup = GroupIndex::Indices::instance().find( searchedDicts );
+
+  if ( lookup.index ) {
+    for ( const auto & allWordWriting : allWordWritings ) {
+      try {
+        sptr< Dictionary::WordSearchRequest > sr = ( searchType == PrefixMatch || searchType == ExpressionMatch ) ?
+          GroupIndex::prefixMatch( lookup, allWordWriting, requestedMaxResults ) :
+          GroupIndex::stemmedMatch( lookup,
+                                    allWordWriting,
+                                    stemmedMinLength,
+                                    stemmedMaxSuffixVariation,
+                                    requestedMaxResults );
+
+        connect( sr.get(), &Dictionary::Request::finished, this, &WordFinder::requestFinished, Qt::QueuedConnection );
+
+        queuedRequests.push_back( sr );
+      }
+      catch ( std::exception & e ) {
+        gdWarning( "Word \"%s\" search error (%s) in the group index\n", inputWord.toUtf8().data(), e.what() );
+      }
+    }
+  }
+
+  // Query each of the other dictionaries for all word writings
+
+  for ( size_t x = 0; x < searchedDicts.size(); ++x ) {
+    if ( lookup.index && lookup.covered[ x ] ) {
       continue;
     }
 
+    const auto & inputDict = searchedDicts[ x ];
+
     for ( const auto & allWordWriting : allWordWritings ) {
       try {
         sptr< Dictionary::WordSearchRequest > sr = ( searchType == PrefixMatch || searchType == ExpressionMatch ) ?
@@ -293,53 +329,55 @@ void WordFinder::updateResults()
   wstring original = Folding::applySimpleCaseOnly( allWordWritings[ 0 ] );
 
   for ( auto i = finishedRequests.begin(); i != finishedRequests.end(); ) {
-    for ( size_t count = ( *i )->matchesCount(), x = 0; x < count; ++x ) {
-      wstring match      = ( **i )[ x ].word;
-      int weight         = ( **i )[ x ].weight;
-      wstring lowerCased = Folding::applySimpleCaseOnly( match );
-
-      if ( searchType == ExpressionMatch ) {
-        unsigned ws;
-
-        for ( ws = 0; ws < allWordWritings.size(); ws++ ) {
-          if ( ws == 0 ) {
-            // Check for prefix match with original expression
-            if ( lowerCased.compare( 0, original.size(), original ) == 0 ) {
+    for ( auto const & span : ( *i )->matchesFrom( 0 ) ) {
+      for ( auto const & found : span ) {
+        wstring const & match = found.word;
+        int weight            = found.weight;
+        wstring lowerCased    = Folding::applySimpleCaseOnly( match );
+
+        if ( searchType == ExpressionMatch ) {
+          unsigned ws;
+
+          for ( ws = 0; ws < allWordWritings.size(); ws++ ) {
+            if ( ws == 0 ) {
+              // Check for prefix match with original expression
+              if ( lowerCased.compare( 0, original.size(), original ) == 0 ) {
+                break;
+              }
+            }
+            else if ( lowerCased == Folding::applySimpleCaseOnly( allWordWritings[ ws ] ) ) {
               break;
             }
           }
-          else if ( lowerCased == Folding::applySimpleCaseOnly( allWordWritings[ ws ] ) ) {
-            break;
-          }
-        }
 
-        if ( ws >= allWordWritings.size() ) {
-          // No exact matches found
-          continue;
-        }
-        weight = ws;
-      }
-      auto insertResult =
-        resultsIndex.insert( pair< wstring, ResultsArray::iterator >( lowerCased, resultsArray.end() ) );
-
-      if ( !insertResult.second ) {
-        // Wasn't inserted since there was already an item -- check the case
-        if ( insertResult.first->second->word != match ) {
-          // The case is different -- agree on a lowercase version
-          insertResult.first->second->word = lowerCased;
+          if ( ws >= allWordWritings.size() ) {
+            // No exact matches found
+            continue;
+          }
+          weight = ws;
         }
-        if ( !weight && insertResult.first->second->wasSuggested ) {
-          insertResult.first->second->wasSuggested = false;
+        auto insertResult =
+          resultsIndex.insert( pair< wstring, ResultsArray::iterator >( lowerCased, resultsArray.end() ) );
+
+        if ( !insertResult.second ) {
+          // Wasn't inserted since there was already an item -- check the case
+          if ( insertResult.first->second->word != match ) {
+            // The case is different -- agree on a lowercase version
+            insertResult.first->second->word = lowerCased;
+          }
+          if ( !weight && insertResult.first->second->wasSuggested ) {
+            insertResult.first->second->wasSuggested = false;
+          }
         }
-      }
-      else {
-        resultsArray.emplace_back();
+        else {
+          resultsArray.emplace_back();
 
-        resultsArray.back().word         = match;
-        resultsArray.back().rank         = INT_MAX;
-        resultsArray.back().wasSuggested = ( weight != 0 );
+          resultsArray.back().word         = match;
+          resultsArray.back().rank         = INT_MAX;
+          resultsArray.back().wasSuggested = ( weight != 0 );
 
-        insertResult.first->second = --resultsArray.end();
+          insertResult.first->second = --resultsArray.end();
+        }
       }
     }
     finishedRequests.erase( i++ );
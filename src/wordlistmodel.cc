@@ -0,0 +1,165 @@
+#include "wordlistmodel.hh"
+
+#include <QFont>
+#include <QSet>
+
+#include <algorithm>
+
+WordListModel::WordListModel( QObject * parent ):
+  QAbstractListModel( parent )
+{
+}
+
+int WordListModel::rowCount( const QModelIndex & parent ) const
+{
+  return parent.isValid() ? 0 : results.size();
+}
+
+QVariant WordListModel::data( const QModelIndex & index, int role ) const
+{
+  if ( !index.isValid() || index.row() >= (int)results.size() ) {
+    return {};
+  }
+
+  auto const & result = results[ index.row() ];
+
+  switch ( role ) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+    case Qt::ToolTipRole:
+      return result.first;
+
+    case Qt::FontRole:
+      if ( result.second ) {
+        // Only the italic bit is set, the rest comes from the view
+        QFont font;
+        font.setItalic( true );
+        return font;
+      }
+      return {};
+
+    case Qt::TextAlignmentRole:
+      return QVariant::fromValue( Qt::Alignment( Qt::AlignLeft | Qt::AlignVCenter ) );
+
+    default:
+      return {};
+  }
+}
+
+void WordListModel::clear()
+{
+  if ( results.empty() ) {
+    return;
+  }
+
+  beginRemoveRows( QModelIndex(), 0, results.size() - 1 );
+  results.clear();
+  endRemoveRows();
+}
+
+void WordListModel::setResults( WordFinder::SearchResults const & newResults )
+{
+  if ( newResults.empty() ) {
+    clear();
+    return;
+  }
+
+  if ( results.empty() ) {
+    beginInsertRows( QModelIndex(), 0, newResults.size() - 1 );
+    results = newResults;
+    endInsertRows();
+    return;
+  }
+
+  QSet< QString > wanted;
+  wanted.reserve( newResults.size() );
+  for ( auto const & result : newResults ) {
+    wanted.insert( result.first );
+  }
+
+  // Drop the words which are gone, a run at a time. Going from the end keeps
+  // the positions of the rows still to be checked.
+  for ( int row = results.size(); row-- > 0; ) {
+    if ( wanted.contains( results[ row ].first ) ) {
+      continue;
+    }
+
+    int first = row;
+    while ( first > 0 && !wanted.contains( results[ first - 1 ].first ) ) {
+      --first;
+    }
+
+    beginRemoveRows( QModelIndex(), first, row );
+    results.erase( results.begin() + first, results.begin() + row + 1 );
+    endRemoveRows();
+
+    row = first;
+  }
+
+  QSet< QString > present;
+  present.reserve( results.size() );
+  for ( auto const & result : results ) {
+    present.insert( result.first );
+  }
+
+  // Everything above 'row' already matches the new results
+  int moves = 0;
+
+  for ( int row = 0; row < (int)newResults.size(); ++row ) {
+    auto const & newResult = newResults[ row ];
+
+    if ( row < (int)results.size() && results[ row ].first == newResult.first ) {
+      if ( results[ row ].second != newResult.second ) {
+        results[ row ].second = newResult.second;
+        emit dataChanged( index( row ), index( row ), { Qt::FontRole } );
+      }
+      continue;
+    }
+
+    auto found = results.end();
+
+    if ( present.contains( newResult.first ) && row < (int)results.size() ) {
+      found = std::find_if( results.begin() + row + 1, results.end(), [ &newResult ]( auto const & result ) {
+        return result.first == newResult.first;
+      } );
+    }
+
+    if ( found == results.end() ) {
+      // A new word, insert it along with the new words following it
+      int last = row;
+      while ( last + 1 < (int)newResults.size() && !present.contains( newResults[ last + 1 ].first ) ) {
+        ++last;
+      }
+
+      beginInsertRows( QModelIndex(), row, last );
+      results.insert( results.begin() + row, newResults.begin() + row, newResults.begin() + last + 1 );
+      endInsertRows();
+
+      row = last;
+      continue;
+    }
+
+    if ( ++moves > MaxMoves ) {
+      beginResetModel();
+      results = newResults;
+      endResetModel();
+      return;
+    }
+
+    int const from = found - results.begin();
+
+    beginMoveRows( QModelIndex(), from, from, QModelIndex(), row );
+    auto moved   = std::move( *found );
+    moved.second = newResult.second;
+    results.erase( found );
+    results.insert( results.begin() + row, std::move( moved ) );
+    endMoveRows();
+  }
+
+  // Only the repeated words can be left over
+  if ( results.size() > newResults.size() ) {
+    beginRemoveRows( QModelIndex(), newResults.size(), results.size() - 1 );
+    results.resize( newResults.size() );
+    endRemoveRows();
+  }
+}
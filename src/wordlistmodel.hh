@@ -0,0 +1,40 @@
+#ifndef WORDLISTMODEL_HH
+#define WORDLISTMODEL_HH
+
+#include "wordfinder.hh"
+
+#include <QAbstractListModel>
+
+/// The results of the main window's word search. New results are merged into
+/// the existing rows, so the views only get the inserted, moved and removed
+/// rows instead of being rebuilt on each update. Suggested words are shown in
+/// italics.
+class WordListModel: public QAbstractListModel
+{
+  Q_OBJECT
+
+public:
+  explicit WordListModel( QObject * parent = nullptr );
+
+  int rowCount( const QModelIndex & parent = QModelIndex() ) const override;
+  QVariant data( const QModelIndex & index, int role = Qt::DisplayRole ) const override;
+
+  /// Returns the word at the given row
+  QString const & word( int row ) const
+  {
+    return results[ row ].first;
+  }
+
+  /// Brings the rows in line with the given results
+  void setResults( WordFinder::SearchResults const & );
+
+  void clear();
+
+private:
+  /// Past this many moves in a single update a reset is cheaper for the views
+  static constexpr int MaxMoves = 64;
+
+  WordFinder::SearchResults results;
+};
+
+#endif // WORDLISTMODEL_HH
@@ -10,9 +10,16 @@
 #include <stdio.h>
 #include <map>
 #include <string>
+#include <vector>
 
 using std::map;
 using std::u32string;
+using std::vector;
+
+enum {
+  FoldBlockBits = 7,
+  FoldBlockSize = 1 << FoldBlockBits
+};
 
 struct Node
 {
@@ -162,35 +169,146 @@ int main()
       return 1;
     }
 
-    fprintf( outf, "// This file was generated automatically. Do not edit directly.\n\n" );
+    // The foldings are stored in a two-level table. The code points are split
+    // into blocks of FoldBlockSize; the first level maps each block to one of
+    // the distinct blocks of the second level, which maps each code point to
+    // its entry in the entry table. Entry zero means there's no folding, and
+    // so does any code point past the last block.
 
-    fprintf( outf, "#pragma once\n\n" );
-    fprintf( outf, "enum { foldCaseMaxOut = 3 };\n\n" );
-    fprintf( outf, "inline size_t foldCase( char32_t in, char32_t * out )\n{\n  switch( in )\n  {\n" );
+    char32_t limit = foldTable.rbegin()->first;
 
-    for ( map< char32_t, u32string >::const_iterator i = foldTable.begin(); i != foldTable.end(); ++i ) {
-      if ( i->second.size() == 1 )
-        fprintf( outf, "    case 0x%x: *out = 0x%x; return 1;\n", i->first, i->second[ 0 ] );
-      else {
-        fprintf( outf, "    case 0x%x: ", i->first );
+    if ( simpleFoldTable.rbegin()->first > limit )
+      limit = simpleFoldTable.rbegin()->first;
+
+    limit = ( limit / FoldBlockSize + 1 ) * FoldBlockSize;
+
+    vector< u32string > fullEntries( 1 );
+    vector< char32_t > simpleEntries( 1, 0 );
+    map< char32_t, unsigned > entryIndices;
+
+    for ( char32_t ch = 0; ch < limit; ++ch ) {
+      map< char32_t, u32string >::const_iterator full  = foldTable.find( ch );
+      map< char32_t, char32_t >::const_iterator simple = simpleFoldTable.find( ch );
+
+      if ( full == foldTable.end() && simple == simpleFoldTable.end() )
+        continue;
+
+      entryIndices[ ch ] = fullEntries.size();
+      fullEntries.push_back( full == foldTable.end() ? u32string( 1, ch ) : full->second );
+      simpleEntries.push_back( simple == simpleFoldTable.end() ? ch : simple->second );
+    }
 
-        for ( unsigned x = 0; x < i->second.size(); ++x )
-          fprintf( outf, "out[ %u ] = 0x%x; ", x, i->second[ x ] );
+    if ( fullEntries.size() > 0xFFFF ) {
+      fprintf( stderr, "Too many foldings for 16-bit entry indices.\n" );
 
-        fprintf( outf, "return %u;\n", i->second.size() );
+      return 1;
+    }
+
+    vector< vector< unsigned > > blocks;
+    vector< unsigned > blockIndices;
+
+    for ( char32_t first = 0; first < limit; first += FoldBlockSize ) {
+      vector< unsigned > block( FoldBlockSize, 0 );
+
+      for ( unsigned x = 0; x < FoldBlockSize; ++x ) {
+        map< char32_t, unsigned >::const_iterator i = entryIndices.find( first + x );
+
+        if ( i != entryIndices.end() )
+          block[ x ] = i->second;
       }
+
+      unsigned index = 0;
+
+      while ( index < blocks.size() && blocks[ index ] != block )
+        ++index;
+
+      if ( index == blocks.size() )
+        blocks.push_back( block );
+
+      blockIndices.push_back( index );
+    }
+
+    if ( blocks.size() > 0xFF ) {
+      fprintf( stderr, "Too many distinct blocks for 8-bit block indices.\n" );
+
+      return 1;
     }
 
-    fprintf( outf, "    default: *out = in; return 1;\n" );
-    fprintf( outf, "  }\n}\n\n" );
+    fprintf( outf, "// This file was generated automatically. Do not edit directly.\n" );
+    fprintf( outf, "#pragma once\n\n" );
+    fprintf( outf, "#include <stddef.h>\n#include <stdint.h>\n\n" );
+    fprintf( outf, "enum {\n  foldCaseMaxOut = 3\n};\n\n" );
+    fprintf( outf, "namespace FoldCaseTable {\n\n" );
+    fprintf( outf, "enum : char32_t {\n  BlockBits = %u,\n  Limit     = 0x%x\n};\n\n", FoldBlockBits, limit );
+    fprintf( outf, "struct Entry\n{\n  char32_t full[ foldCaseMaxOut ];\n  uint8_t fullSize;\n  char32_t simple;\n};\n\n" );
+
+    fprintf( outf, "inline constexpr Entry entries[] = {\n" );
+
+    for ( size_t x = 0; x < fullEntries.size(); ++x ) {
+      u32string const & full = fullEntries[ x ];
 
-    fprintf( outf, "char32_t foldCaseSimple( char32_t in )\n{\n  switch( in )\n  {\n" );
+      fprintf( outf, "  { { " );
 
-    for ( map< char32_t, char32_t >::const_iterator i = simpleFoldTable.begin(); i != simpleFoldTable.end(); ++i )
-      fprintf( outf, "    case 0x%x: return 0x%x;\n", i->first, i->second );
+      for ( unsigned y = 0; y < 3; ++y )
+        fprintf( outf, y ? ", 0x%x" : "0x%x", y < full.size() ? full[ y ] : 0 );
+
+      fprintf( outf, " }, %u, 0x%x },\n", (unsigned)( x ? full.size() : 0 ), simpleEntries[ x ] );
+    }
+
+    fprintf( outf, "};\n\n" );
+
+    fprintf( outf, "inline constexpr uint8_t blockIndices[] = {" );
+
+    for ( size_t x = 0; x < blockIndices.size(); ++x )
+      fprintf( outf, x % 16 ? " %u," : "\n  %u,", blockIndices[ x ] );
+
+    fprintf( outf, "\n};\n\n" );
+
+    fprintf( outf, "inline constexpr uint16_t blocks[][ 1 << BlockBits ] = {\n" );
+
+    for ( size_t x = 0; x < blocks.size(); ++x ) {
+      fprintf( outf, "  {" );
+
+      for ( unsigned y = 0; y < FoldBlockSize; ++y )
+        fprintf( outf, y % 16 ? " %u," : "\n    %u,", blocks[ x ][ y ] );
+
+      fprintf( outf, "\n  },\n" );
+    }
 
-    fprintf( outf, "    default: return in;\n" );
-    fprintf( outf, "  }\n}\n" );
+    fprintf( outf, "};\n\n" );
+
+    fprintf( outf,
+             "/// Returns the folding entry for the given char, or null if there's none.\n"
+             "inline Entry const * find( char32_t in )\n"
+             "{\n"
+             "  if ( in >= Limit ) {\n"
+             "    return nullptr;\n"
+             "  }\n\n"
+             "  uint16_t index = blocks[ blockIndices[ in >> BlockBits ] ][ in & ( ( 1 << BlockBits ) - 1 ) ];\n\n"
+             "  return index ? entries + index : nullptr;\n"
+             "}\n\n"
+             "} // namespace FoldCaseTable\n\n" );
+
+    fprintf( outf,
+             "inline size_t foldCase( char32_t in, char32_t * out )\n"
+             "{\n"
+             "  FoldCaseTable::Entry const * entry = FoldCaseTable::find( in );\n\n"
+             "  if ( !entry ) {\n"
+             "    *out = in;\n"
+             "    return 1;\n"
+             "  }\n\n"
+             "  for ( unsigned x = 0; x < entry->fullSize; ++x ) {\n"
+             "    out[ x ] = entry->full[ x ];\n"
+             "  }\n\n"
+             "  return entry->fullSize;\n"
+             "}\n\n" );
+
+    fprintf( outf,
+             "inline char32_t foldCaseSimple( char32_t in )\n"
+             "{\n"
+             "  FoldCaseTable::Entry const * entry = FoldCaseTable::find( in );\n\n"
+             "  return entry ? entry->simple : in;\n"
+             "}\n" );
 
     fclose( outf );
   }